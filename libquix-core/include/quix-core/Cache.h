@@ -107,6 +107,16 @@ bool qcore_cache_bind(qcore_cache_has_t has, qcore_cache_read_t read, qcore_cach
  */
 void qcore_cache_unbind();
 
+/**
+ * @brief Check if a cache provider is bound.
+ *
+ * @return true if a provider is bound, false otherwise.
+ *
+ * @note This function is thread-safe.
+ * @warning The provider may be unbound concurrently right after this returns.
+ */
+bool qcore_cache_bound();
+
 /**
  * @brief Check if an object is currently cached.
  *
@@ -153,8 +163,46 @@ bool qcore_cache_read(const qcore_cache_key_t *key, void *payload, size_t payloa
  */
 bool qcore_cache_write(const qcore_cache_key_t *key, const void *payload, size_t payload_size);
 
+/**
+ * @brief Derive a cache key from a sequence of byte strings.
+ *
+ * @param parts The strings.
+ * @param sizes The length of each string in bytes.
+ * @param count The number of strings.
+ * @param key The key to fill in.
+ *
+ * @return true if the key was derived, false otherwise.
+ *
+ * @note The key is the SHA-1 of the strings, each preceded by its length, so
+ *       different sequences never hash the same bytes.
+ * @note This function is thread-safe.
+ * @note No cache provider needs to be bound.
+ */
+bool qcore_cache_key_digest(const void *const *parts, const size_t *sizes, size_t count,
+                            qcore_cache_key_t *key);
+
 #ifdef __cplusplus
 }
+
+/* This header may itself be included from within an extern "C" block */
+extern "C++" {
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+static inline bool qcore_cache_key_digest(std::initializer_list<std::string_view> parts,
+                                          qcore_cache_key_t *key) {
+  std::vector<const void *> data;
+  std::vector<size_t> sizes;
+
+  for (auto part : parts) {
+    data.push_back(part.data());
+    sizes.push_back(part.size());
+  }
+
+  return qcore_cache_key_digest(data.data(), sizes.data(), parts.size(), key);
+}
+}
 #endif
 
 #endif  // __QUIX_CORE_CACHE_H__
@@ -84,6 +84,17 @@ void qcore_env_set(const char *key, const char *value);
  */
 const char *qcore_env_get(const char *key);
 
+/**
+ * @brief Visit every environment variable whose key starts with a prefix.
+ * @param prefix The key prefix.
+ * @param callback Called with each key and value.
+ * @param userdata Passed to the callback.
+ * @note The environment stays locked meanwhile; the callback must not use it.
+ */
+void qcore_env_foreach(const char *prefix,
+                       void (*callback)(const char *key, const char *value, uintptr_t userdata),
+                       uintptr_t userdata);
+
 typedef enum {
   QCORE_DEBUG,
   QCORE_INFO,
@@ -30,6 +30,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <quix-core/Cache.h>
+#include <openssl/evp.h>
 #include <quix-core/Error.h>
 
 #include <mutex>
@@ -72,6 +73,12 @@ LIB_EXPORT void qcore_cache_unbind() {
   g_cache_provider.m_write = nullptr;
 }
 
+LIB_EXPORT bool qcore_cache_bound() {
+  std::lock_guard<std::mutex> lock(g_cache_provider.m_lock);
+
+  return g_cache_provider.m_has && g_cache_provider.m_read && g_cache_provider.m_write;
+}
+
 LIB_EXPORT int64_t qcore_cache_has(const qcore_cache_key_t *key) {
   std::lock_guard<std::mutex> lock(g_cache_provider.m_lock);
 
@@ -98,3 +105,26 @@ LIB_EXPORT bool qcore_cache_write(const qcore_cache_key_t *key, const void *data
 
   return g_cache_provider.m_write(key, data, datalen);
 }
+
+LIB_EXPORT bool qcore_cache_key_digest(const void *const *parts, const size_t *sizes,
+                                       size_t count, qcore_cache_key_t *key) {
+  qcore_assert(key && (count == 0 || (parts && sizes)),
+               "qcore_cache_key_digest: key, parts or sizes is null");
+
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  if (!ctx) {
+    return false;
+  }
+
+  bool ok = EVP_DigestInit(ctx, EVP_sha1()) == 1;
+  for (size_t i = 0; i < count; i++) {
+    uint64_t len = sizes[i];
+    ok = ok && EVP_DigestUpdate(ctx, &len, sizeof(len)) == 1 &&
+         EVP_DigestUpdate(ctx, parts[i], sizes[i]) == 1;
+  }
+  ok = ok && EVP_DigestFinal_ex(ctx, key->key, nullptr) == 1;
+
+  EVP_MD_CTX_free(ctx);
+
+  return ok;
+}
@@ -108,6 +108,21 @@ LIB_EXPORT const char *qcore_env_get(const char *key) {
   }
 }
 
+LIB_EXPORT void qcore_env_foreach(const char *prefix,
+                                  void (*callback)(const char *key, const char *value,
+                                                   uintptr_t userdata),
+                                  uintptr_t userdata) {
+  std::lock_guard<std::mutex> lock(g_envs_mutex);
+
+  qcore_assert(g_envs.count(g_current_env), "Current environment does not exist.");
+
+  for (const auto &[key, value] : g_envs[g_current_env].env) {
+    if (key.starts_with(prefix)) {
+      callback(key.c_str(), value.c_str(), userdata);
+    }
+  }
+}
+
 LIB_EXPORT void qcore_begin(qcore_log_t level) {
   std::lock_guard<std::mutex> lock(g_envs_mutex);
 
@@ -37,22 +37,59 @@
 #include <quix-lexer/Token.h>
 
 #include <array>
-#include <boost/bimap.hpp>
-#include <boost/unordered_map.hpp>
 #include <deque>
 #include <limits>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "quix-core/Env.h"
 
-#if MEMORY_OVER_SPEED == 1
-#include <unordered_map>
-#endif
-
 struct __attribute__((visibility("default"))) qlex_t {
+public:
+  /**
+   * Deduplicating string table shared by a lexer and its clones. String bytes
+   * are copied into arena blocks that never move, so the views handed out
+   * remain valid for the lifetime of the interner. Not thread-safe.
+   */
+  class Interner {
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Slot {
+      uint32_t hash;
+      uint32_t idx; /* Index + 1; zero marks an empty slot */
+    };
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char *m_block_cur = nullptr;
+    size_t m_block_avail = 0;
+
+    std::vector<std::string_view> m_strings;
+    std::vector<Slot> m_slots;
+
+    std::string_view store(std::string_view str);
+    void grow();
+
+  public:
+    qlex_size intern(std::string_view str);
+
+    std::string_view get(qlex_size idx) const {
+      return idx < m_strings.size() ? m_strings[idx] : std::string_view("", 0);
+    }
+
+    size_t size() const { return m_strings.size(); }
+  };
+
+  /* Line around a source position, as returned by `qlex_snippet` */
+  struct snippet_t {
+    bool used = false;
+    qlex_size pos = 0;
+    qlex_size col = 0;
+    std::string line;
+  };
+
 private:
   ///============================================================================///
   /// BEGIN: PERFORMANCE HYPER PARAMETERS
@@ -60,21 +97,19 @@ private:
   /// END:   PERFORMANCE HYPER PARAMETERS
   ///============================================================================///
 
-  struct clever_me_t {
-    uint32_t rc_fmt : 1; /* Holds the row-column format? */
-    uint32_t col : 10;   /* Column number (max 1024) */
-    uint32_t row : 21;   /* Row number (max 2097152) */
+  /* Largest location tag representable in `qlex_loc_t` */
+  static constexpr qlex_size MAX_LOC_TAG = (1 << 24) - 1;
 
-    bool operator<(const clever_me_t &other) const {
-      if (row != other.row) {
-        return row < other.row;
-      } else {
-        return col < other.col;
-      }
-    }
-  } __attribute__((packed));
+  struct explicit_loc_t {
+    qlex_size tag;
+    qlex_size row;
+    qlex_size col;
+  };
 
-  qlex_size m_getc_pos;
+  /* Read cursor over the current source window. For a mapped lexer the
+   * window is the whole source, otherwise it is `m_getc_buf`. */
+  const char *m_getc_cur;
+  const char *m_getc_end;
   std::array<char, GETC_BUFFER_SIZE> m_getc_buf;
 
   std::vector<qlex_tok_t> m_tok_buf;
@@ -87,23 +122,62 @@ private:
   qlex_size m_offset;
   char m_last_ch;
 
-#if MEMORY_OVER_SPEED == 1
-  typedef std::shared_ptr<std::pair<boost::bimap<qlex_size, std::string>, qlex_size>>
-      StringInterner;
-#else
-  typedef std::shared_ptr<std::pair<std::unordered_map<qlex_size, std::string>, qlex_size>>
-      StringInterner;
-#endif
+  typedef std::shared_ptr<Interner> StringInterner;
+
+  /* Location tag `t` refers to the source offset `m_loc_off[t - 1]`; tag 0 is
+   * never issued. Row and column are derived from the line index on demand,
+   * except for locations saved with an explicit row and column, which are
+   * kept in `m_loc_rc` ordered by tag. */
+  std::vector<qlex_size> m_loc_off;
+  std::vector<explicit_loc_t> m_loc_rc;
+
+  /* Tokens lexed ahead of time by `prelex_parallel`, served by `next_impl` */
+  std::vector<qlex_tok_t> m_prelexed;
+  size_t m_prelexed_pos;
+
+  /* Offsets of every '\n' within the first `m_lines_scanned` source bytes */
+  std::vector<qlex_size> m_lines;
+  size_t m_lines_scanned;
 
-  boost::bimap<qlex_size, clever_me_t> m_tag_to_loc;
-  boost::unordered_map<qlex_size, qlex_size> m_tag_to_off;
+  /* Bytes read from `m_file` so far, kept for random access */
+  std::string m_retained;
 
-  qlex_size m_locctr;
+  /* Recently requested snippets, replaced round-robin */
+  std::array<snippet_t, 8> m_snippets;
+  size_t m_snippets_next;
 
 private:
   qlex_tok_t step_buffer();
   void reset_automata();
-  char getc();
+  void refill_buffer();
+  void index_lines(const char *p, size_t n);
+  qlex_loc_t push_loc(qlex_size offset);
+  bool next_raw(qlex_tok_t &tok);
+
+  friend struct qlex_chunk_t;
+  friend struct qlex_replay_t;
+
+  /* Equivalent to `n` calls to getc() that stay within the current window */
+  void advance(size_t n);
+
+  inline char getc() {
+    if (m_getc_cur == m_getc_end) [[unlikely]] {
+      refill_buffer();
+    }
+
+    { /* Update source location */
+      if (m_last_ch == '\n') {
+        m_row++;
+        m_col = 1;
+      } else {
+        m_col++;
+      }
+
+      m_offset++;
+    }
+
+    return m_last_ch = *m_getc_cur++;
+  }
 
 public:
   StringInterner m_strings;
@@ -115,6 +189,12 @@ public:
   FILE *m_file;
   bool m_is_owned;
 
+  /* Contiguous read-only source. Non-null data means the lexer is mapped. */
+  std::string_view m_src;
+  bool m_src_padded;
+  void *m_map_base;
+  size_t m_map_size;
+
   ///============================================================================///
 
   virtual qlex_tok_t next_impl();
@@ -123,6 +203,21 @@ public:
   virtual std::optional<std::pair<qlex_size, qlex_size>> loc2rowcol(qlex_loc_t loc);
   virtual qlex_loc_t save_loc(qlex_size row, qlex_size col, qlex_size offset);
   qlex_loc_t cur_loc();
+  qlex_loc_t offset_loc(qlex_loc_t base, qlex_size offset);
+
+  std::optional<std::string_view> source_range(size_t begin, size_t end, std::string &scratch,
+                                               bool partial = false);
+  const snippet_t *snippet(qlex_size pos);
+
+  bool prelex_parallel(size_t threads, size_t chunk_size);
+
+  /* Restart an in-memory lexer over `src`, which must outlive the lexing.
+   * The interner and flags are kept, as is the capacity of the location
+   * tables, so a lexer can be reused for many short texts. Locations issued
+   * before are invalidated. Fails for file-backed and mapped lexers. */
+  bool rebind(std::string_view src);
+  qlex_t *relex(const qlex_tok_t *tokens, size_t count, std::string_view src, qlex_size offset,
+                qlex_size removed, qlex_size inserted, qlex_splice_t *splice);
 
   ///============================================================================///
 
@@ -133,39 +228,58 @@ public:
 
   qlex_tok_t next();
   qlex_tok_t peek();
+  size_t next_batch(qlex_tok_t *out, size_t max);
+  size_t next_stream(qlex_stream_t *stream);
 
   void push_impl(const qlex_tok_t *tok);
   void collect_impl(const qlex_tok_t *tok);
 
+  /* Tokens other than end-of-file that were peeked or pushed back and are
+   * yet to be returned by `next` */
+  size_t pending() const;
+
   ///============================================================================///
 
   qlex_t(FILE *file, const char *filename, bool is_owned, qcore_env_t env)
-      : m_getc_pos(GETC_BUFFER_SIZE),
+      : m_getc_cur(nullptr),
+        m_getc_end(nullptr),
         m_next_tok({}),
         m_row(1),
         m_col(0),
         m_offset(std::numeric_limits<qlex_size>::max()),
         m_last_ch(0),
-        m_tag_to_loc(),
-        m_tag_to_off({}),
-        m_locctr(1),
-        m_strings(std::make_shared<decltype(m_strings)::element_type>()),
+        m_loc_off(),
+        m_loc_rc(),
+        m_prelexed(),
+        m_prelexed_pos(0),
+        m_lines(),
+        m_lines_scanned(0),
+        m_retained(),
+        m_snippets(),
+        m_snippets_next(0),
+        m_strings(std::make_shared<Interner>()),
         m_env(env),
         m_flags(0),
         m_filename(filename),
         m_file(file),
-        m_is_owned(is_owned) {
+        m_is_owned(is_owned),
+        m_src(),
+        m_src_padded(false),
+        m_map_base(nullptr),
+        m_map_size(0) {
     if (!m_filename) {
       m_filename = "<unknown>";
     }
 
     m_next_tok.ty = qErro;
   }
-  virtual ~qlex_t() {
-    if (m_is_owned) {
-      fclose(m_file);
-    }
+  qlex_t(std::string_view src, const char *filename, qcore_env_t env)
+      : qlex_t(nullptr, filename, false, env) {
+    m_src = src.data() ? src : std::string_view("", 0);
+    m_getc_cur = m_src.data();
+    m_getc_end = m_src.data() + m_src.size();
   }
+  virtual ~qlex_t();
 };
 
 #endif  // __QUIX_LEXER_BASE_H__
@@ -32,6 +32,7 @@
 #ifndef __QUIX_LEXER_LEX_H__
 #define __QUIX_LEXER_LEX_H__
 
+#include <quix-core/Cache.h>
 #include <quix-core/Env.h>
 #include <quix-lexer/Token.h>
 #include <stdbool.h>
@@ -78,11 +79,25 @@ qlex_t *qlex_istream__libextra(qlex_cxx_std_istream_t istream, const char *filen
  *
  * @return New lexer context or NULL if an error occurred.
  * @note This function is thread-safe.
- * @note The lifetime of the file stream and environment must exceed the lifetime of the lexer.
+ * @note The source is scanned in place; no copy of the buffer is made.
+ * @note The lifetime of the environment must exceed the lifetime of the lexer.
  * @warning The source code pointer must be valid for the duration of the lexer context.
  */
 qlex_t *qlex_direct(const char *src, size_t len, const char *filename, qcore_env_t env);
 
+/**
+ * @brief Create a new lexer context over a memory-mapped source file.
+ *
+ * @param path Path to a regular file. Also used as the filename of the lexer.
+ * @param env Parent environment.
+ *
+ * @return New lexer context or NULL if the file could not be opened or mapped.
+ * @note This function is thread-safe.
+ * @note The mapping is owned by the lexer and released by `qlex_free`.
+ * @note The lifetime of the path string and environment must exceed the lifetime of the lexer.
+ */
+qlex_t *qlex_new_mapped(const char *path, qcore_env_t env);
+
 /**
  * @brief Destroy a lexer context.
  *
@@ -154,6 +169,186 @@ qlex_tok_t qlex_next(qlex_t *lexer);
  */
 qlex_tok_t qlex_peek(qlex_t *lexer);
 
+/**
+ * @brief Lex up to `max` tokens into a caller-provided array.
+ *
+ * @param lexer Lexer context.
+ * @param out Array of at least `max` tokens.
+ * @param max Maximum number of tokens to produce.
+ *
+ * @return Number of tokens written to `out`.
+ * @note This function is thread-safe.
+ * @note Equivalent to calling `qlex_next` up to `max` times. Stops early after writing the
+ * end-of-file token, which is included in the count.
+ */
+size_t qlex_next_batch(qlex_t *lexer, qlex_tok_t *out, size_t max);
+
+/**
+ * @brief Structure-of-arrays token stream.
+ *
+ * Token `i` has type `ty[i]`, spans `start[i]` to `end[i]` and carries the payload `v[i]`, which
+ * is the keyword, operator or punctuator enumerator for those token types and the string index
+ * otherwise.
+ */
+typedef struct qlex_stream_t {
+  qlex_ty_t *ty;
+  qlex_loc_t *start;
+  qlex_loc_t *end;
+  qlex_size *v;
+  size_t size;     /* Number of tokens currently held */
+  size_t capacity; /* Number of tokens each array can hold */
+} qlex_stream_t;
+
+/**
+ * @brief Allocate a token stream.
+ *
+ * @param capacity Number of tokens the stream can hold.
+ *
+ * @return New stream or NULL on allocation failure.
+ * @note This function is thread-safe.
+ */
+qlex_stream_t *qlex_stream_new(size_t capacity);
+
+/**
+ * @brief Destroy a token stream.
+ *
+ * @param stream Token stream or NULL.
+ * @note This function is thread-safe.
+ */
+void qlex_stream_free(qlex_stream_t *stream);
+
+/**
+ * @brief Replace the contents of a token stream with the next chunk of tokens.
+ *
+ * @param lexer Lexer context.
+ * @param stream Token stream.
+ *
+ * @return Number of tokens in the stream; 0 only if the capacity is 0.
+ * @note This function is thread-safe.
+ * @note As with `qlex_next_batch`, the chunk ends early after the end-of-file token.
+ */
+size_t qlex_stream_fill(qlex_t *lexer, qlex_stream_t *stream);
+
+/**
+ * @brief Lex the whole source of a lexer ahead of time on multiple threads.
+ *
+ * @param lexer Lexer context created by `qlex_direct` or `qlex_new_mapped` that has not produced
+ * any tokens yet.
+ * @param threads Number of worker threads or 0 for the hardware concurrency.
+ * @param chunk_size Approximate number of bytes per chunk or 0 for a default based on the source
+ * size and thread count.
+ *
+ * @return True if the source was lexed, false if the lexer does not qualify or an allocation
+ * failed. On failure the lexer is left untouched.
+ * @note This function is thread-safe.
+ * @note Subsequent calls to `qlex_next` and friends return the same tokens, strings and source
+ * positions as lexing the source serially would, up to the end of the file. Location tags remain
+ * opaque and are not guaranteed to be numbered identically.
+ */
+bool qlex_lex_parallel(qlex_t *lexer, size_t threads, size_t chunk_size);
+
+/**
+ * @brief Description of how to patch a token array after an edit.
+ *
+ * Replacing the `removed` tokens starting at index `first` of the old token array with the
+ * `count` tokens in `tokens` yields the token array of the edited source.
+ */
+typedef struct qlex_splice_t {
+  size_t first;       /* Index of the first old token to replace */
+  size_t removed;     /* Number of old tokens to replace */
+  qlex_tok_t *tokens; /* Replacement tokens; must be released with free() */
+  size_t count;       /* Number of replacement tokens */
+} qlex_splice_t;
+
+/**
+ * @brief Re-lex only the part of a source affected by an edit.
+ *
+ * @param lexer Lexer that produced `tokens` from the old source.
+ * @param tokens Complete token stream of the old source, optionally ending with the end-of-file
+ * token.
+ * @param count Number of tokens in `tokens`.
+ * @param src Edited source. It must remain valid for the lifetime of the returned lexer.
+ * @param len Length of the edited source.
+ * @param offset Byte offset of the edit within the old source.
+ * @param removed Number of bytes removed from the old source at `offset`.
+ * @param inserted Number of bytes inserted in their place, at `src + offset`.
+ * @param splice Filled with the changes to apply to `tokens`.
+ *
+ * @return Lexer over the edited source or NULL if the edit does not fit the old source or an
+ * allocation failed.
+ * @note This function is thread-safe.
+ * @note Lexing restarts at the last token boundary before the edit and stops as soon as the new
+ * tokens line up with the old ones again, so the work is proportional to the size of the edit.
+ * @note The returned lexer shares the string table of `lexer` and carries over its locations,
+ * so the retained old tokens and the replacement tokens are all valid in it. It has no further
+ * tokens to produce.
+ */
+qlex_t *qlex_relex(qlex_t *lexer, const qlex_tok_t *tokens, size_t count, const char *src,
+                   size_t len, qlex_size offset, qlex_size removed, qlex_size inserted,
+                   qlex_splice_t *splice);
+
+/**
+ * @brief Serialize the remaining tokens of a lexer into a token cache image.
+ *
+ * @param lexer Lexer context. It is drained up to and including the end-of-file token.
+ * @param digest 20-byte digest identifying the source, recorded in the image.
+ * @param size Set to the size of the image in bytes.
+ *
+ * @return Image allocated with malloc() or NULL if an allocation failed.
+ * @note This function is thread-safe.
+ * @note The image records the tokens, their source positions and the strings they refer to. It
+ * does not contain the source, so lexers replaying it cannot produce snippets or spans.
+ * @note Comments are recorded regardless of the flags of `lexer`.
+ */
+void *qlex_cache_dump(qlex_t *lexer, const uint8_t digest[20], size_t *size);
+
+/**
+ * @brief Create a lexer context that replays a token cache image.
+ *
+ * @param image Image produced by `qlex_cache_dump`.
+ * @param size Size of the image in bytes.
+ * @param is_owned If true, the lexer releases the image with free().
+ * @param digest Expected digest of the image or NULL to accept any.
+ * @param filename Name of the file or NULL for default.
+ * @param env Parent environment.
+ *
+ * @return New lexer context or NULL if the image is malformed, does not match `digest` or an
+ * allocation failed. On failure the image remains owned by the caller.
+ * @note This function is thread-safe.
+ * @note The lexer produces the same tokens, strings and source positions as the lexer the image
+ * was dumped from. Tokens are read from the image in place, so unless it is owned, the image must
+ * outlive the lexer.
+ */
+qlex_t *qlex_new_replay(const void *image, size_t size, bool is_owned, const uint8_t digest[20],
+                        const char *filename, qcore_env_t env);
+
+/**
+ * @brief Create a lexer context that replays a memory-mapped token cache image file.
+ *
+ * @param path Path to a regular file. Also used as the filename of the lexer.
+ * @param digest Expected digest of the image or NULL to accept any.
+ * @param env Parent environment.
+ *
+ * @return New lexer context or NULL if the file could not be mapped or does not hold a valid
+ * image matching `digest`.
+ * @note This function is thread-safe.
+ * @note The mapping is owned by the lexer and released by `qlex_free`.
+ */
+qlex_t *qlex_new_replay_mapped(const char *path, const uint8_t digest[20], qcore_env_t env);
+
+/**
+ * @brief Create a lexer context that replays a token cache image from the bound cache provider.
+ *
+ * @param key Cache key; also the digest the image must carry.
+ * @param filename Name of the file or NULL for default.
+ * @param env Parent environment.
+ *
+ * @return New lexer context or NULL if no provider is bound, the key is not cached or the cached
+ * object is not a valid image.
+ * @note This function is thread-safe.
+ */
+qlex_t *qlex_cache_load(const qcore_cache_key_t *key, const char *filename, qcore_env_t env);
+
 /**
  * @brief Push a token back into the lexer.
  *
@@ -201,6 +396,17 @@ qlex_size qlex_line(qlex_t *lexer, qlex_loc_t loc);
  */
 qlex_size qlex_col(qlex_t *lexer, qlex_loc_t loc);
 
+/**
+ * @brief Get the source line that contains a token.
+ *
+ * @param lexer Lexer context.
+ * @param loc Token whose start locates the line.
+ * @param offset Set to the column of the token within the line.
+ *
+ * @return The line, without its newline, to be freed with free(), or NULL if
+ * the line could not be found.
+ * @note On NULL, `*offset` is set to 0.
+ */
 char *qlex_snippet(qlex_t *lexer, qlex_tok_t loc, qlex_size *offset);
 
 /**
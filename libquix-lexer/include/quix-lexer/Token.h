@@ -186,6 +186,12 @@ typedef enum qlex_key_t {
 
 typedef uint32_t qlex_size;
 
+/* The payload of a `qIntL` token whose value is at most QLEX_INT_INLINE_MAX is
+ * the value itself with QLEX_INT_INLINE set, rather than a string index. The
+ * decimal text remains available through `qlex_str`. */
+#define QLEX_INT_INLINE 0x80000000u
+#define QLEX_INT_INLINE_MAX 0x7ffffffeu
+
 #if defined(__cplusplus) && defined(__QUIX_LEXER_IMPL__)
 }
 
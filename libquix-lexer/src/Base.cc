@@ -31,19 +31,27 @@
 
 #define __QUIX_LEXER_IMPL__
 
+#include <fcntl.h>
 #include <quix-core/Error.h>
 #include <quix-lexer/Lexer.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <boost/bimap.hpp>
-#include <boost/unordered_map.hpp>
+#include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cmath>
 #include <csetjmp>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
+#include <memory>
 #include <quix-lexer/Base.hh>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
 
 #include "LibMacro.h"
@@ -54,27 +62,55 @@
 
 LIB_EXPORT qlex_t *qlex_direct(const char *src, size_t len, const char *filename, qcore_env_t env) {
   try {
-    if (!filename) {
-      filename = "<unknown>";
-    }
+    return new qlex_t(std::string_view(src, len), filename, env);
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  } catch (...) {
+    return nullptr;
+  }
+}
 
-    FILE *file = fmemopen((void *)src, len, "r");
-    if (!file) {
+LIB_EXPORT qlex_t *qlex_new_mapped(const char *path, qcore_env_t env) {
+  void *base = nullptr;
+  size_t size = 0;
+
+  try {
+    int fd;
+    struct stat st;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
       return nullptr;
     }
 
-    qlex_t *obj = qlex_new(file, filename, env);
-    if (!obj) {
-      fclose(file);
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+      close(fd);
       return nullptr;
     }
 
-    obj->m_is_owned = true;
+    if (st.st_size > 0) {
+      base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (base == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+      }
+
+      size = st.st_size;
+      madvise(base, size, MADV_SEQUENTIAL);
+    }
+
+    close(fd);
+
+    qlex_t *obj = new qlex_t(std::string_view((const char *)base, size), path, env);
+    obj->m_map_base = base;
+    obj->m_map_size = size;
 
     return obj;
-  } catch (std::bad_alloc &) {
-    return nullptr;
   } catch (...) {
+    /* The lexer never took ownership of the mapping */
+    if (base) {
+      munmap(base, size);
+    }
+
     return nullptr;
   }
 }
@@ -123,71 +159,7 @@ LIB_EXPORT qlex_size qlex_col(qlex_t *obj, qlex_loc_t loc) {
 
 LIB_EXPORT qlex_loc_t qlex_offset(qlex_t *obj, qlex_loc_t base, qlex_size offset) {
   try {
-    long curpos;
-    std::optional<qlex_size> seek_base_pos;
-    uint8_t *buf = nullptr;
-    size_t bufsz;
-    qlex_loc_t res{.tag = 0};
-
-    if (!(seek_base_pos = obj->loc2offset(base))) {
-      return res;
-    }
-
-    if ((curpos = ftell(obj->m_file)) == -1) {
-      return res;
-    }
-
-    if (fseek(obj->m_file, *seek_base_pos + offset, SEEK_SET) != 0) {
-      return res;
-    }
-
-    bufsz = offset;
-
-    if ((buf = (uint8_t *)malloc(bufsz + 1)) == nullptr) {
-      if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-        qcore_panic("qlex_offset: failed to restore file position");
-      }
-      return res;
-    }
-
-    if (fread(buf, 1, bufsz, obj->m_file) != bufsz) {
-      free(buf);
-      if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-        qcore_panic("qlex_offset: failed to restore file position");
-      }
-      return res;
-    }
-
-    buf[bufsz] = '\0';
-    if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-      qcore_panic("qlex_offset: failed to restore file position");
-    }
-
-    //===== AUTOMATA TO CALCULATE THE NEW ROW AND COLUMN =====//
-    uint32_t row, col;
-
-    if ((row = qlex_line(obj, base)) == UINT32_MAX) {
-      free(buf);
-      return res;
-    }
-
-    if ((col = qlex_col(obj, base)) == UINT32_MAX) {
-      free(buf);
-      return res;
-    }
-
-    for (size_t i = 0; i < bufsz; i++) {
-      if (buf[i] == '\n') {
-        row++;
-        col = 1;
-      } else {
-        col++;
-      }
-    }
-
-    free(buf);
-
-    return obj->save_loc(row, col, *seek_base_pos + offset);
+    return obj->offset_loc(base, offset);
   } catch (...) {
     qcore_panic("qlex_offset: failed to calculate offset");
   }
@@ -235,43 +207,13 @@ LIB_EXPORT qlex_size qlex_spanx(qlex_t *obj, qlex_loc_t start, qlex_loc_t end,
 
     qlex_size span = *endoff - *begoff;
 
-    long curpos;
-    uint8_t *buf = nullptr;
-    size_t bufsz;
-
-    if ((curpos = ftell(obj->m_file)) == -1) {
-      return UINT32_MAX;
-    }
-
-    if (fseek(obj->m_file, *begoff, SEEK_SET) != 0) {
-      return UINT32_MAX;
-    }
-
-    bufsz = span;
-
-    if ((buf = (uint8_t *)malloc(bufsz + 1)) == nullptr) {
-      if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-        qcore_panic("qlex_spanx: failed to restore file position");
-      }
+    std::string scratch;
+    auto window = obj->source_range(*begoff, *endoff, scratch);
+    if (!window) {
       return UINT32_MAX;
     }
 
-    if (fread(buf, 1, bufsz, obj->m_file) != bufsz) {
-      free(buf);
-      if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-        qcore_panic("qlex_spanx: failed to restore file position");
-      }
-      return UINT32_MAX;
-    }
-
-    buf[bufsz] = '\0';
-    if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-      qcore_panic("qlex_spanx: failed to restore file position");
-    }
-
-    callback((const char *)buf, bufsz, userdata);
-
-    free(buf);
+    callback(window->data(), span, userdata);
     return span;
   } catch (...) {
     qcore_panic("qlex_spanx: failed to calculate span");
@@ -321,82 +263,28 @@ LIB_EXPORT void qlex_rect(qlex_t *obj, qlex_size x_0, qlex_size y_0, qlex_size x
 }
 
 LIB_EXPORT char *qlex_snippet(qlex_t *obj, qlex_tok_t tok, qlex_size *offset) {
-  try {
-#define SNIPPET_SIZE 100
-
-    qlex_size tok_beg_offset;
-    char snippet_buf[SNIPPET_SIZE];
-    size_t curpos, seek_base_pos, read;
-
-    { /* Convert the location to an offset into the source */
-      auto src_offset_opt = obj->loc2offset(tok.start);
-      if (!src_offset_opt) {
-        return nullptr; /* Return early if translation failed */
-      }
-
-      tok_beg_offset = *src_offset_opt - 1;
-    }
+  *offset = 0;
 
-    { /* Calculate offsets and seek to the correct position */
-      curpos = ftell(obj->m_file);
-      if ((long)curpos == -1) {
-        return nullptr;
-      }
-      seek_base_pos = tok_beg_offset < SNIPPET_SIZE / 2 ? 0 : tok_beg_offset - SNIPPET_SIZE / 2;
-
-      if (fseek(obj->m_file, seek_base_pos, SEEK_SET) != 0) {
-        if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-          qcore_panic("qlex_snippet: failed to restore file position");
-        }
-        return nullptr;
-      }
+  try {
+    auto src_offset_opt = obj->loc2offset(tok.start);
+    if (!src_offset_opt) {
+      return nullptr; /* Return early if translation failed */
     }
 
-    { /* Read the snippet and calculate token offset */
-      read = fread(snippet_buf, 1, SNIPPET_SIZE, obj->m_file);
-      memset(snippet_buf + read, 0, SNIPPET_SIZE - read);
-
-      if (tok_beg_offset < SNIPPET_SIZE / 2) {
-        *offset = tok_beg_offset;
-      } else {
-        *offset = SNIPPET_SIZE / 2;
-      }
+    const qlex_t::snippet_t *snippet = obj->snippet(*src_offset_opt - 1);
+    if (!snippet) {
+      return nullptr;
     }
 
-    // Extract the line that contains the token
-    qlex_size slice_start = 0;
-
-    for (size_t i = 0; i < read; i++) {
-      if (snippet_buf[i] == '\n') {
-        slice_start = i + 1;
-      } else if (i == *offset) { /* Danger ?? */
-        size_t slice_end;
-        for (slice_end = i; slice_end < read; slice_end++) {
-          char ch = snippet_buf[slice_end];
-          if (ch == '\n' || ch == 0) {
-            break;
-          }
-        }
-
-        qlex_size slice_size = slice_end - slice_start;
-        char *output = (char *)malloc(slice_size + 1);
-        if (!output) {
-          qcore_panic("qlex_snippet: failed to allocate memory");
-        }
-        memcpy(output, snippet_buf + slice_start, slice_size);
-        output[slice_size] = '\0';
-        *offset -= slice_start;
-        if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-          qcore_panic("qlex_snippet: failed to restore file position");
-        }
-        return output;
-      }
+    char *output = (char *)malloc(snippet->line.size() + 1);
+    if (!output) {
+      qcore_panic("qlex_snippet: failed to allocate memory");
     }
+    memcpy(output, snippet->line.data(), snippet->line.size());
+    output[snippet->line.size()] = '\0';
+    *offset = snippet->col;
 
-    if (fseek(obj->m_file, curpos, SEEK_SET) != 0) {
-      qcore_panic("qlex_snippet: failed to restore file position");
-    }
-    return nullptr;
+    return output;
   } catch (std::bad_alloc &) {
     return nullptr;
   } catch (...) {
@@ -434,133 +322,438 @@ LIB_EXPORT qlex_tok_t qlex_peek(qlex_t *self) {
   }
 }
 
+LIB_EXPORT size_t qlex_next_batch(qlex_t *self, qlex_tok_t *out, size_t max) {
+  try {
+    qcore_env_t old = qcore_env_current();
+    qcore_env_set_current(self->m_env);
+
+    size_t n = self->next_batch(out, max);
+
+    qcore_env_set_current(old);
+
+    return n;
+  } catch (...) {
+    qcore_panic("qlex_next_batch: failed to get next tokens");
+  }
+}
+
+LIB_EXPORT qlex_stream_t *qlex_stream_new(size_t capacity) {
+  qlex_stream_t *stream = (qlex_stream_t *)calloc(1, sizeof(qlex_stream_t));
+  if (!stream) {
+    return nullptr;
+  }
+
+  stream->ty = (qlex_ty_t *)malloc(capacity * sizeof(qlex_ty_t));
+  stream->start = (qlex_loc_t *)malloc(capacity * sizeof(qlex_loc_t));
+  stream->end = (qlex_loc_t *)malloc(capacity * sizeof(qlex_loc_t));
+  stream->v = (qlex_size *)malloc(capacity * sizeof(qlex_size));
+  stream->capacity = capacity;
+
+  if (capacity && (!stream->ty || !stream->start || !stream->end || !stream->v)) {
+    qlex_stream_free(stream);
+    return nullptr;
+  }
+
+  return stream;
+}
+
+LIB_EXPORT void qlex_stream_free(qlex_stream_t *stream) {
+  if (!stream) {
+    return;
+  }
+
+  free(stream->ty);
+  free(stream->start);
+  free(stream->end);
+  free(stream->v);
+  free(stream);
+}
+
+LIB_EXPORT size_t qlex_stream_fill(qlex_t *self, qlex_stream_t *stream) {
+  try {
+    qcore_env_t old = qcore_env_current();
+    qcore_env_set_current(self->m_env);
+
+    size_t n = self->next_stream(stream);
+
+    qcore_env_set_current(old);
+
+    return n;
+  } catch (...) {
+    qcore_panic("qlex_stream_fill: failed to get next tokens");
+  }
+}
+
 ///============================================================================///
 
+CPP_EXPORT qlex_t::~qlex_t() {
+  if (m_is_owned && m_file) {
+    fclose(m_file);
+  }
+
+  if (m_map_base) {
+    munmap(m_map_base, m_map_size);
+  }
+}
+
 CPP_EXPORT std::optional<qlex_size> qlex_t::loc2offset(qlex_loc_t loc) {
-  if (m_tag_to_off.find(loc.tag) == m_tag_to_off.end()) [[unlikely]] {
+  if (loc.tag == 0 || loc.tag > m_loc_off.size()) [[unlikely]] {
     return std::nullopt;
   }
 
-  return m_tag_to_off[loc.tag];
+  return m_loc_off[loc.tag - 1];
 }
 
 CPP_EXPORT std::optional<std::pair<qlex_size, qlex_size>> qlex_t::loc2rowcol(qlex_loc_t loc) {
-  if (m_tag_to_loc.left.find(loc.tag) == m_tag_to_loc.left.end()) [[unlikely]] {
+  if (loc.tag == 0 || loc.tag > m_loc_off.size()) [[unlikely]] {
     return std::nullopt;
   }
 
-  clever_me_t it = m_tag_to_loc.left.at(loc.tag);
+  if (!m_loc_rc.empty()) {
+    auto it = std::lower_bound(m_loc_rc.begin(), m_loc_rc.end(), loc.tag,
+                               [](const explicit_loc_t &e, qlex_size tag) { return e.tag < tag; });
+    if (it != m_loc_rc.end() && it->tag == loc.tag) {
+      return std::make_pair(it->row, it->col);
+    }
+  }
 
-  if (!it.rc_fmt) [[unlikely]] {
-    return std::nullopt;
+  qlex_size offset = m_loc_off[loc.tag - 1];
+
+  /* Nothing has been read yet */
+  if (offset == std::numeric_limits<qlex_size>::max()) {
+    return std::make_pair(1, 0);
   }
 
-  qlex_size row = it.row;
-  qlex_size col = it.col;
+  if (m_src.data() && m_lines_scanned < m_src.size()) {
+    index_lines(m_src.data() + m_lines_scanned, m_src.size() - m_lines_scanned);
+  }
+
+  /* The row is one past the number of newlines before the offset and the
+   * column counts from the last of them. */
+  size_t lines = std::lower_bound(m_lines.begin(), m_lines.end(), offset) - m_lines.begin();
+
+  qlex_size row = lines + 1;
+  qlex_size col = lines ? offset - m_lines[lines - 1] : offset + 1;
 
   return std::make_pair(row, col);
 }
 
 CPP_EXPORT qlex_loc_t qlex_t::save_loc(qlex_size row, qlex_size col, qlex_size offset) {
-  if (row <= 2097152 || col <= 1024) [[likely]] {
-    clever_me_t bits;
-    static_assert(sizeof(bits) == sizeof(qlex_size));
+  if (m_loc_off.size() >= MAX_LOC_TAG) [[unlikely]] {
+    return {0};
+  }
 
-    bits.rc_fmt = 1;
-    bits.col = col;
-    bits.row = row;
+  m_loc_off.push_back(offset);
+  m_loc_rc.push_back({(qlex_size)m_loc_off.size(), row, col});
 
-    if (m_tag_to_loc.right.find(bits) != m_tag_to_loc.right.end()) {
-      return {m_tag_to_loc.right.at(bits)};
-    }
+  return {(qlex_size)m_loc_off.size()};
+}
+
+CPP_EXPORT qlex_loc_t qlex_t::cur_loc() { return push_loc(m_offset); }
 
-    qlex_size tag = m_locctr++;
-    m_tag_to_loc.insert({tag, bits});
-    m_tag_to_off[tag] = offset;
+qlex_loc_t qlex_t::push_loc(qlex_size offset) {
+  qlex_size tag = m_loc_off.size();
 
+  /* Token boundaries often coincide; reuse the last tag if it is equivalent */
+  if (tag != 0 && m_loc_off.back() == offset &&
+      (m_loc_rc.empty() || m_loc_rc.back().tag != tag)) {
     return {tag};
+  }
+
+  if (tag >= MAX_LOC_TAG) [[unlikely]] {
+    return {0};
+  }
+
+  m_loc_off.push_back(offset);
+
+  return {tag + 1};
+}
+
+CPP_EXPORT qlex_loc_t qlex_t::offset_loc(qlex_loc_t base, qlex_size offset) {
+  std::optional<qlex_size> base_pos;
+  if (!(base_pos = loc2offset(base))) {
+    return {0};
+  }
+
+  size_t begin = *base_pos, end = begin + offset;
+
+  std::string scratch;
+  auto window = source_range(begin, end, scratch);
+  if (!window) {
+    return {0};
+  }
+
+  auto it = std::lower_bound(m_loc_rc.begin(), m_loc_rc.end(), base.tag,
+                             [](const explicit_loc_t &e, qlex_size tag) { return e.tag < tag; });
+  bool explicit_base = it != m_loc_rc.end() && it->tag == base.tag;
+
+  /* Within the indexed source the line index yields the same row and column
+   * that walking from the base would */
+  if (!explicit_base && (m_src.data() || end <= m_lines_scanned)) {
+    return push_loc(end);
+  }
+
+  uint32_t row, col;
+  if (auto rc = loc2rowcol(base)) {
+    std::tie(row, col) = *rc;
   } else {
     return {0};
   }
+
+  for (char ch : *window) {
+    if (ch == '\n') {
+      row++;
+      col = 1;
+    } else {
+      col++;
+    }
+  }
+
+  return save_loc(row, col, end);
 }
 
-CPP_EXPORT qlex_loc_t qlex_t::cur_loc() { return save_loc(m_row, m_col, m_offset); }
+CPP_EXPORT std::optional<std::string_view> qlex_t::source_range(size_t begin, size_t end,
+                                                                std::string &scratch,
+                                                                bool partial) {
+  std::string_view src = m_src.data() ? m_src : std::string_view(m_retained);
 
-///============================================================================///
+  if (begin <= end && end <= src.size()) {
+    return src.substr(begin, end - begin);
+  }
 
-CPP_EXPORT std::string_view qlex_t::get_string(qlex_size idx) {
-#if MEMORY_OVER_SPEED == 1
-  if (auto it = m_strings->first.left.find(idx); it != m_strings->first.left.end()) [[likely]] {
-    return it->second;
+  if (m_src.data() || !m_file || begin > end) {
+    if (partial && begin <= src.size()) {
+      return src.substr(begin);
+    }
+    return std::nullopt;
   }
-#else
-  if (auto it = m_strings->first.find(idx); it != m_strings->first.end()) [[likely]] {
-    return it->second;
+
+  /* Not read yet; fetch it without disturbing the read position */
+  long curpos;
+  if ((curpos = ftell(m_file)) == -1) {
+    return std::nullopt;
   }
-#endif
 
-  return "";
+  if (fseek(m_file, begin, SEEK_SET) != 0) {
+    return std::nullopt;
+  }
+
+  scratch.resize(end - begin);
+  size_t read = fread(scratch.data(), 1, scratch.size(), m_file);
+
+  if (fseek(m_file, curpos, SEEK_SET) != 0) {
+    qcore_panic("qlex_t::source_range: failed to restore file position");
+  }
+
+  if (read != scratch.size() && !partial) {
+    return std::nullopt;
+  }
+
+  scratch.resize(read);
+
+  return scratch;
 }
 
-CPP_EXPORT qlex_size qlex_t::put_string(std::string_view str) {
-#if MEMORY_OVER_SPEED == 1
-  if (auto it = m_strings->first.right.find(str); it != m_strings->first.right.end()) {
-    return it->second;
+CPP_EXPORT const qlex_t::snippet_t *qlex_t::snippet(qlex_size pos) {
+  static constexpr size_t SNIPPET_SIZE = 100;
+
+  for (const snippet_t &entry : m_snippets) {
+    if (entry.used && entry.pos == pos) {
+      return &entry;
+    }
+  }
+
+  /* The snippet is cut from a window centered on `pos` */
+  size_t base = pos < SNIPPET_SIZE / 2 ? 0 : pos - SNIPPET_SIZE / 2;
+  size_t at = pos < SNIPPET_SIZE / 2 ? pos : SNIPPET_SIZE / 2;
+
+  std::string scratch;
+  auto window = source_range(base, base + SNIPPET_SIZE, scratch, true);
+  if (!window || at >= window->size() || (*window)[at] == '\n') {
+    return nullptr;
   }
 
-  m_strings->first.insert({m_strings->second, std::string(str)});
-  return m_strings->second++;
-#else
+  const char *w = window->data();
+  const char *nl = (const char *)memrchr(w, '\n', at);
+  size_t slice_start = nl ? nl - w + 1 : 0;
+
+  size_t slice_end = at;
+  while (slice_end < window->size() && w[slice_end] != '\n' && w[slice_end] != '\0') {
+    slice_end++;
+  }
+
+  snippet_t &entry = m_snippets[m_snippets_next++ % m_snippets.size()];
+  entry.used = true;
+  entry.pos = pos;
+  entry.col = at - slice_start;
+  entry.line.assign(w + slice_start, slice_end - slice_start);
+
+  return &entry;
+}
+
+void qlex_t::index_lines(const char *p, size_t n) {
+  const char *end = p + n;
+
+  for (const char *it = p; (it = (const char *)memchr(it, '\n', end - it)); it++) {
+    m_lines.push_back(m_lines_scanned + (it - p));
+  }
+
+  m_lines_scanned += n;
+}
+
+///============================================================================///
+
+CPP_EXPORT std::string_view qlex_t::get_string(qlex_size idx) {
+  if (idx != UINT32_MAX && (idx & QLEX_INT_INLINE)) [[unlikely]] {
+    /* An integer carried by value; its text is interned once asked for */
+    char buf[16];
+    auto r = std::to_chars(buf, buf + sizeof(buf), idx & ~QLEX_INT_INLINE);
+    return m_strings->get(m_strings->intern(std::string_view(buf, r.ptr - buf)));
+  }
+
+  return m_strings->get(idx);
+}
+
+CPP_EXPORT qlex_size qlex_t::put_string(std::string_view str) {
   if (str.empty()) [[unlikely]] {
     return UINT32_MAX;
   }
 
-  (*m_strings).first[m_strings->second] = std::string(str);
-  return m_strings->second++;
-#endif
+  return m_strings->intern(str);
+}
+
+CPP_EXPORT void qlex_t::release_string(qlex_size) {
+  /* Interned strings are deduplicated and may be referenced by other tokens
+   * or by clones sharing the interner, so they live as long as it does. */
+}
+
+CPP_EXPORT void qlex_t::replace_interner(StringInterner new_interner) { m_strings = new_interner; }
+
+///============================================================================///
+
+std::string_view qlex_t::Interner::store(std::string_view str) {
+  /* Strings are stored NUL-terminated because qlex_str() promises that */
+  size_t size = str.size() + 1;
+
+  if (size > BLOCK_SIZE / 4) { /* Large strings get a block of their own */
+    auto &block = m_blocks.emplace_back(std::make_unique<char[]>(size));
+    memcpy(block.get(), str.data(), str.size());
+    block[str.size()] = '\0';
+    return std::string_view(block.get(), str.size());
+  }
+
+  if (size > m_block_avail) {
+    m_block_cur = m_blocks.emplace_back(std::make_unique<char[]>(BLOCK_SIZE)).get();
+    m_block_avail = BLOCK_SIZE;
+  }
+
+  char *dst = m_block_cur;
+  memcpy(dst, str.data(), str.size());
+  dst[str.size()] = '\0';
+  m_block_cur += size;
+  m_block_avail -= size;
+
+  return std::string_view(dst, str.size());
 }
 
-CPP_EXPORT void qlex_t::release_string(qlex_size idx) {
-#if MEMORY_OVER_SPEED == 1
+void qlex_t::Interner::grow() {
+  std::vector<Slot> slots(m_slots.empty() ? 1024 : m_slots.size() * 2);
+  size_t mask = slots.size() - 1;
 
-#else
-  if (auto it = m_strings->first.find(idx); it != m_strings->first.end()) [[likely]] {
-    m_strings->first.erase(it);
+  for (const Slot &slot : m_slots) {
+    if (slot.idx == 0) {
+      continue;
+    }
+
+    size_t i = slot.hash & mask;
+    while (slots[i].idx != 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
   }
-#endif
+
+  m_slots = std::move(slots);
 }
 
-CPP_EXPORT void qlex_t::replace_interner(StringInterner new_interner) { m_strings = new_interner; }
+qlex_size qlex_t::Interner::intern(std::string_view str) {
+  if (m_slots.empty()) [[unlikely]] {
+    grow();
+  }
+
+  uint32_t hash = std::hash<std::string_view>{}(str);
+  size_t mask = m_slots.size() - 1;
+
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Slot &slot = m_slots[i];
+
+    if (slot.idx == 0) {
+      /* Keep the load factor at or below 1/2. Only insertions grow the table,
+       * so finding a string that is already interned modifies nothing. */
+      if ((m_strings.size() + 1) * 2 > m_slots.size()) {
+        grow();
+        return intern(str);
+      }
+
+      if (m_strings.size() >= QLEX_INT_INLINE - 1) [[unlikely]] {
+        throw std::length_error("qlex_t::Interner: too many strings");
+      }
+
+      slot.hash = hash;
+      slot.idx = m_strings.size() + 1;
+      m_strings.push_back(store(str));
+      return slot.idx - 1;
+    }
+
+    if (slot.hash == hash && m_strings[slot.idx - 1] == str) {
+      return slot.idx - 1;
+    }
+  }
+}
 
 ///============================================================================///
 
 class GetCExcept {};
 
-char qlex_t::getc() {
-  /* Refill the buffer if necessary */
-  if (m_getc_pos == GETC_BUFFER_SIZE) [[unlikely]] {
-    size_t read = fread(m_getc_buf.data(), 1, GETC_BUFFER_SIZE, m_file);
+void qlex_t::refill_buffer() {
+  if (m_src.data()) { /* Mapped source: emulate the padding of a short read */
+    static const std::array<char, GETC_BUFFER_SIZE> padding = []() {
+      std::array<char, GETC_BUFFER_SIZE> buf;
+      buf.fill('#');
+      return buf;
+    }();
 
-    if (read == 0) [[unlikely]] {
+    size_t rem = m_src.size() % GETC_BUFFER_SIZE;
+    if (m_src_padded || rem == 0) [[unlikely]] {
       throw GetCExcept();
     }
 
-    memset(m_getc_buf.data() + read, '#', GETC_BUFFER_SIZE - read);
-    m_getc_pos = 0;
+    m_src_padded = true;
+    m_getc_cur = padding.data();
+    m_getc_end = padding.data() + (GETC_BUFFER_SIZE - rem);
+    return;
   }
 
-  { /* Update source location */
-    if (m_last_ch == '\n') {
-      m_row++;
-      m_col = 1;
-    } else {
-      m_col++;
-    }
+  size_t read = fread(m_getc_buf.data(), 1, GETC_BUFFER_SIZE, m_file);
 
-    m_offset++;
+  if (read == 0) [[unlikely]] {
+    throw GetCExcept();
   }
 
-  return m_last_ch = m_getc_buf[m_getc_pos++];
+  index_lines(m_getc_buf.data(), read);
+  m_retained.append(m_getc_buf.data(), read);
+
+  memset(m_getc_buf.data() + read, '#', GETC_BUFFER_SIZE - read);
+  m_getc_cur = m_getc_buf.data();
+  m_getc_end = m_getc_buf.data() + GETC_BUFFER_SIZE;
+}
+
+bool qlex_t::next_raw(qlex_tok_t &tok) {
+  try {
+    tok = qlex_t::next_impl();
+    return true;
+  } catch (GetCExcept &) {
+    return false;
+  }
 }
 
 qlex_tok_t qlex_t::step_buffer() {
@@ -582,6 +775,41 @@ qlex_tok_t qlex_t::step_buffer() {
   return tok;
 }
 
+CPP_EXPORT bool qlex_t::rebind(std::string_view src) {
+  if (m_file || m_map_base) {
+    return false;
+  }
+
+  m_src = src.data() ? src : std::string_view("", 0);
+  m_src_padded = false;
+  m_getc_cur = m_src.data();
+  m_getc_end = m_src.data() + m_src.size();
+
+  m_tok_buf.clear();
+  m_pushback.clear();
+  m_next_tok.ty = qErro;
+
+  m_row = 1;
+  m_col = 0;
+  m_offset = std::numeric_limits<qlex_size>::max();
+  m_last_ch = 0;
+
+  m_loc_off.clear();
+  m_loc_rc.clear();
+  m_prelexed.clear();
+  m_prelexed_pos = 0;
+  m_lines.clear();
+  m_lines_scanned = 0;
+  m_retained.clear();
+
+  for (auto &snippet : m_snippets) {
+    snippet.used = false;
+  }
+  m_snippets_next = 0;
+
+  return true;
+}
+
 CPP_EXPORT qlex_tok_t qlex_t::next() {
   qlex_tok_t tok;
 
@@ -606,6 +834,56 @@ CPP_EXPORT qlex_tok_t qlex_t::peek() {
   return m_next_tok = next();
 }
 
+CPP_EXPORT size_t qlex_t::next_batch(qlex_tok_t *out, size_t max) {
+  size_t n = 0;
+
+  while (n < max) {
+    qlex_tok_t tok = next();
+    out[n++] = tok;
+
+    if (tok.ty == qEofF) {
+      break;
+    }
+  }
+
+  return n;
+}
+
+CPP_EXPORT size_t qlex_t::next_stream(qlex_stream_t *stream) {
+  size_t n = 0;
+
+  while (n < stream->capacity) {
+    qlex_tok_t tok = next();
+
+    stream->ty[n] = tok.ty;
+    stream->start[n] = tok.start;
+    stream->end[n] = tok.end;
+
+    switch (tok.ty) {
+      case qKeyW:
+        stream->v[n] = tok.v.key;
+        break;
+      case qOper:
+        stream->v[n] = tok.v.op;
+        break;
+      case qPunc:
+        stream->v[n] = tok.v.punc;
+        break;
+      default:
+        stream->v[n] = tok.v.str_idx;
+        break;
+    }
+
+    n++;
+
+    if (tok.ty == qEofF) {
+      break;
+    }
+  }
+
+  return stream->size = n;
+}
+
 ///============================================================================///
 
 CPP_EXPORT void qlex_t::push_impl(const qlex_tok_t *tok) {
@@ -613,6 +891,15 @@ CPP_EXPORT void qlex_t::push_impl(const qlex_tok_t *tok) {
   m_next_tok.ty = qErro;
 }
 
+CPP_EXPORT size_t qlex_t::pending() const {
+  size_t n = m_next_tok.ty != qErro && m_next_tok.ty != qEofF;
+  for (const auto &tok : m_tok_buf) {
+    n += tok.ty != qEofF;
+  }
+
+  return n;
+}
+
 CPP_EXPORT void qlex_t::collect_impl(const qlex_tok_t *tok) {
   switch (tok->ty) {
     case qEofF:
@@ -36,23 +36,25 @@
 #include <string.h>
 
 #include <array>
-#include <boost/bimap.hpp>
-#include <boost/unordered_map.hpp>
+#include <boost/container/small_vector.hpp>
 #include <cctype>
 #include <charconv>
 #include <cmath>
 #include <csetjmp>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <deque>
-#include <iomanip>
+#include <optional>
 #include <quix-lexer/Base.hh>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
 #include "LibMacro.h"
+#include "Scan.h"
 
 ///============================================================================///
 /// BEGIN: LEXICAL GRAMMAR CONSTRAINTS
@@ -63,156 +65,245 @@
 namespace qlex {
   ///============================================================================///
   /// BEGIN: LEXER LOOKUP TABLES
-  template <typename L, typename R>
-  boost::bimap<L, R> make_bimap(
-      std::initializer_list<typename boost::bimap<L, R>::value_type> list) {
-    return boost::bimap<L, R>(list.begin(), list.end());
-  }
+  /**
+   * Keyword and operator tables are resolved at compile time. Forward lookups
+   * go through a perfect hash over the length and the first, middle and last
+   * characters, with a seed searched for during constant evaluation, so
+   * classifying a word costs one hash, one table load and one compare.
+   * Reverse lookups are flat arrays indexed by the enumerator.
+   */
+  template <typename T>
+  using lex_entry_t = std::pair<std::string_view, T>;
+
+  template <typename T, size_t N, size_t Slots = 512>
+  class PerfectHash {
+    static_assert(N < 256, "Slot indices are stored as uint8_t");
+    static_assert((Slots & (Slots - 1)) == 0, "Slot count must be a power of two");
+
+    std::array<lex_entry_t<T>, N> m_entries;
+    std::array<uint8_t, Slots> m_slots{};
+    uint32_t m_seed = 0;
+
+    static constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+      uint32_t h = seed ^ static_cast<uint32_t>(s.size());
+      h = h * 0x9e3779b1 + static_cast<uint8_t>(s.front());
+      h = h * 0x9e3779b1 + static_cast<uint8_t>(s[s.size() / 2]);
+      h = h * 0x9e3779b1 + static_cast<uint8_t>(s.back());
+      return (h ^ (h >> 15)) & (Slots - 1);
+    }
+
+    constexpr bool try_seed(uint32_t seed) {
+      m_slots.fill(0);
+      for (size_t i = 0; i < N; i++) {
+        uint8_t &slot = m_slots[hash(m_entries[i].first, seed)];
+        if (slot != 0) {
+          return false;
+        }
+        slot = i + 1;
+      }
+      m_seed = seed;
+      return true;
+    }
+
+  public:
+    constexpr PerfectHash(const std::array<lex_entry_t<T>, N> &entries) : m_entries(entries) {
+      uint32_t seed = 1;
+      while (!try_seed(seed)) {
+        if (++seed == 1 << 16) {
+          throw std::logic_error("PerfectHash: no collision-free seed");
+        }
+      }
+    }
+
+    constexpr std::optional<T> find(std::string_view s) const {
+      if (s.empty()) {
+        return std::nullopt;
+      }
+
+      uint8_t slot = m_slots[hash(s, m_seed)];
+      if (slot == 0 || m_entries[slot - 1].first != s) {
+        return std::nullopt;
+      }
+
+      return m_entries[slot - 1].second;
+    }
+
+    template <size_t M>
+    constexpr std::array<std::string_view, M> reverse() const {
+      std::array<std::string_view, M> names{};
+      for (const auto &[str, val] : m_entries) {
+        names[static_cast<size_t>(val)] = str;
+      }
+      return names;
+    }
+  };
+
+  static constexpr PerfectHash keywords = std::array<lex_entry_t<qlex_key_t>, 58>{{
+      {"subsystem", qKSubsystem},
+      {"import", qKImport},
+      {"pub", qKPub},
+      {"sec", qKSec},
+      {"pro", qKPro},
+      {"type", qKType},
+      {"let", qKLet},
+      {"var", qKVar},
+      {"const", qKConst},
+      {"static", qKStatic},
+      {"struct", qKStruct},
+      {"region", qKRegion},
+      {"group", qKGroup},
+      {"class", qKClass},
+      {"union", qKUnion},
+      {"opaque", qKOpaque},
+      {"enum", qKEnum},
+      {"fstring", qKFString},
+      {"with", qKWith},
+      {"fn", qKFn},
+      {"noexcept", qKNoexcept},
+      {"foreign", qKForeign},
+      {"impure", qKImpure},
+      {"tsafe", qKTsafe},
+      {"pure", qKPure},
+      {"quasipure", qKQuasipure},
+      {"retropure", qKRetropure},
+      {"crashpoint", qKCrashpoint},
+      {"inline", qKInline},
+      {"unsafe", qKUnsafe},
+      {"safe", qKSafe},
+      {"volatile", qKVolatile},
+      {"promise", qKPromise},
+      {"if", qKIf},
+      {"else", qKElse},
+      {"for", qKFor},
+      {"while", qKWhile},
+      {"do", qKDo},
+      {"switch", qKSwitch},
+      {"case", qKCase},
+      {"default", qKDefault},
+      {"break", qKBreak},
+      {"continue", qKContinue},
+      {"ret", qKReturn},
+      {"retif", qKRetif},
+      {"retz", qKRetz},
+      {"retv", qKRetv},
+      {"form", qKForm},
+      {"foreach", qKForeach},
+      {"try", qKTry},
+      {"catch", qKCatch},
+      {"throw", qKThrow},
+      {"__asm__", qK__Asm__},
+      {"void", qKVoid},
+      {"undef", qKUndef},
+      {"null", qKNull},
+      {"true", qKTrue},
+      {"false", qKFalse},
+  }};
+
+  static constexpr PerfectHash operators = std::array<lex_entry_t<qlex_op_t>, 54>{{
+      {"+", qOpPlus},
+      {"-", qOpMinus},
+      {"*", qOpTimes},
+      {"/", qOpSlash},
+      {"%", qOpPercent},
+      {"&", qOpBitAnd},
+      {"|", qOpBitOr},
+      {"^", qOpBitXor},
+      {"~", qOpBitNot},
+      {"<<", qOpLShift},
+      {">>", qOpRShift},
+      {"<<<", qOpROTL},
+      {">>>", qOpROTR},
+      {"&&", qOpLogicAnd},
+      {"||", qOpLogicOr},
+      {"^^", qOpLogicXor},
+      {"!", qOpLogicNot},
+      {"<", qOpLT},
+      {">", qOpGT},
+      {"<=", qOpLE},
+      {">=", qOpGE},
+      {"==", qOpEq},
+      {"!=", qOpNE},
+      {"=", qOpSet},
+      {"+=", qOpPlusSet},
+      {"-=", qOpMinusSet},
+      {"*=", qOpTimesSet},
+      {"/=", qOpSlashSet},
+      {"%=", qOpPercentSet},
+      {"&=", qOpBitAndSet},
+      {"|=", qOpBitOrSet},
+      {"^=", qOpBitXorSet},
+      {"&&=", qOpLogicAndSet},
+      {"||=", qOpLogicOrSet},
+      {"^^=", qOpLogicXorSet},
+      {"<<=", qOpLShiftSet},
+      {">>=", qOpRShiftSet},
+      {"<<<=", qOpROTLSet},
+      {">>>=", qOpROTRSet},
+      {"++", qOpInc},
+      {"--", qOpDec},
+      {"as", qOpAs},
+      {"bitcast_as", qOpBitcastAs},
+      {"in", qOpIn},
+      {"out", qOpOut},
+      {"sizeof", qOpSizeof},
+      {"bitsizeof", qOpBitsizeof},
+      {"alignof", qOpAlignof},
+      {"typeof", qOpTypeof},
+      {".", qOpDot},
+      {"..", qOpRange},
+      {"...", qOpEllipsis},
+      {"=>", qOpArrow},
+      {"?", qOpTernary},
+  }};
+
+  static constexpr PerfectHash word_operators = std::array<lex_entry_t<qlex_op_t>, 8>{{
+      {"as", qOpAs},
+      {"in", qOpIn},
+      {"sizeof", qOpSizeof},
+      {"alignof", qOpAlignof},
+      {"typeof", qOpTypeof},
+      {"bitcast_as", qOpBitcastAs},
+      {"bitsizeof", qOpBitsizeof},
+      {"out", qOpOut},
+  }};
+
+  static constexpr std::array<lex_entry_t<qlex_punc_t>, 9> punctuation_list = {{
+      {"(", qPuncLPar},
+      {")", qPuncRPar},
+      {"[", qPuncLBrk},
+      {"]", qPuncRBrk},
+      {"{", qPuncLCur},
+      {"}", qPuncRCur},
+      {",", qPuncComa},
+      {":", qPuncColn},
+      {";", qPuncSemi},
+  }};
+
+  /* Punctuators are single characters, so they are indexed directly */
+  static constexpr std::array<std::optional<qlex_punc_t>, 256> punctuation = []() {
+    std::array<std::optional<qlex_punc_t>, 256> tab{};
+    for (const auto &[str, val] : punctuation_list) {
+      tab[static_cast<uint8_t>(str[0])] = val;
+    }
+    return tab;
+  }();
+
+  static constexpr auto keyword_names = keywords.reverse<qKFalse + 1>();
+  static constexpr auto operator_names = operators.reverse<qOpTernary + 1>();
+  static constexpr auto punctuation_names = []() {
+    std::array<std::string_view, qPuncSemi + 1> names{};
+    for (const auto &[str, val] : punctuation_list) {
+      names[val] = str;
+    }
+    return names;
+  }();
 
-  static const boost::bimap<std::string_view, qlex_key_t> keywords =
-      make_bimap<std::string_view, qlex_key_t>({
-          {"subsystem", qKSubsystem},
-          {"import", qKImport},
-          {"pub", qKPub},
-          {"sec", qKSec},
-          {"pro", qKPro},
-          {"type", qKType},
-          {"let", qKLet},
-          {"var", qKVar},
-          {"const", qKConst},
-          {"static", qKStatic},
-          {"struct", qKStruct},
-          {"region", qKRegion},
-          {"group", qKGroup},
-          {"class", qKClass},
-          {"union", qKUnion},
-          {"opaque", qKOpaque},
-          {"enum", qKEnum},
-          {"fstring", qKFString},
-          {"with", qKWith},
-          {"fn", qKFn},
-          {"noexcept", qKNoexcept},
-          {"foreign", qKForeign},
-          {"impure", qKImpure},
-          {"tsafe", qKTsafe},
-          {"pure", qKPure},
-          {"quasipure", qKQuasipure},
-          {"retropure", qKRetropure},
-          {"crashpoint", qKCrashpoint},
-          {"inline", qKInline},
-          {"unsafe", qKUnsafe},
-          {"safe", qKSafe},
-          {"volatile", qKVolatile},
-          {"promise", qKPromise},
-          {"if", qKIf},
-          {"else", qKElse},
-          {"for", qKFor},
-          {"while", qKWhile},
-          {"do", qKDo},
-          {"switch", qKSwitch},
-          {"case", qKCase},
-          {"default", qKDefault},
-          {"break", qKBreak},
-          {"continue", qKContinue},
-          {"ret", qKReturn},
-          {"retif", qKRetif},
-          {"retz", qKRetz},
-          {"retv", qKRetv},
-          {"form", qKForm},
-          {"foreach", qKForeach},
-          {"try", qKTry},
-          {"catch", qKCatch},
-          {"throw", qKThrow},
-          {"__asm__", qK__Asm__},
-          {"void", qKVoid},
-          {"undef", qKUndef},
-          {"null", qKNull},
-          {"true", qKTrue},
-          {"false", qKFalse},
-      });
-
-  static const boost::bimap<std::string_view, qlex_op_t> operators =
-      make_bimap<std::string_view, qlex_op_t>({
-          {"+", qOpPlus},
-          {"-", qOpMinus},
-          {"*", qOpTimes},
-          {"/", qOpSlash},
-          {"%", qOpPercent},
-          {"&", qOpBitAnd},
-          {"|", qOpBitOr},
-          {"^", qOpBitXor},
-          {"~", qOpBitNot},
-          {"<<", qOpLShift},
-          {">>", qOpRShift},
-          {"<<<", qOpROTL},
-          {">>>", qOpROTR},
-          {"&&", qOpLogicAnd},
-          {"||", qOpLogicOr},
-          {"^^", qOpLogicXor},
-          {"!", qOpLogicNot},
-          {"<", qOpLT},
-          {">", qOpGT},
-          {"<=", qOpLE},
-          {">=", qOpGE},
-          {"==", qOpEq},
-          {"!=", qOpNE},
-          {"=", qOpSet},
-          {"+=", qOpPlusSet},
-          {"-=", qOpMinusSet},
-          {"*=", qOpTimesSet},
-          {"/=", qOpSlashSet},
-          {"%=", qOpPercentSet},
-          {"&=", qOpBitAndSet},
-          {"|=", qOpBitOrSet},
-          {"^=", qOpBitXorSet},
-          {"&&=", qOpLogicAndSet},
-          {"||=", qOpLogicOrSet},
-          {"^^=", qOpLogicXorSet},
-          {"<<=", qOpLShiftSet},
-          {">>=", qOpRShiftSet},
-          {"<<<=", qOpROTLSet},
-          {">>>=", qOpROTRSet},
-          {"++", qOpInc},
-          {"--", qOpDec},
-          {"as", qOpAs},
-          {"bitcast_as", qOpBitcastAs},
-          {"in", qOpIn},
-          {"out", qOpOut},
-          {"sizeof", qOpSizeof},
-          {"bitsizeof", qOpBitsizeof},
-          {"alignof", qOpAlignof},
-          {"typeof", qOpTypeof},
-          {".", qOpDot},
-          {"..", qOpRange},
-          {"...", qOpEllipsis},
-          {"=>", qOpArrow},
-          {"?", qOpTernary},
-      });
-
-  static const boost::bimap<std::string_view, qlex_op_t> word_operators =
-      make_bimap<std::string_view, qlex_op_t>({
-          {"as", qOpAs},
-          {"in", qOpIn},
-          {"sizeof", qOpSizeof},
-          {"alignof", qOpAlignof},
-          {"typeof", qOpTypeof},
-          {"bitcast_as", qOpBitcastAs},
-          {"bitsizeof", qOpBitsizeof},
-          {"out", qOpOut},
-      });
-
-  static const boost::bimap<std::string_view, qlex_punc_t> punctuation =
-      make_bimap<std::string_view, qlex_punc_t>({
-          {"(", qPuncLPar},
-          {")", qPuncRPar},
-          {"[", qPuncLBrk},
-          {"]", qPuncRBrk},
-          {"{", qPuncLCur},
-          {"}", qPuncRCur},
-          {",", qPuncComa},
-          {":", qPuncColn},
-          {";", qPuncSemi},
-      });
+  /* Flat reverse lookup; returns an empty view for out of range values */
+  template <size_t N>
+  static constexpr std::string_view name_of(const std::array<std::string_view, N> &names,
+                                            size_t val) {
+    return val < N ? names[val] : std::string_view();
+  }
 
   // Precomputed lookup table for hex char to byte conversion
   static constexpr std::array<uint8_t, 256> hextable = []() {
@@ -260,7 +351,7 @@ namespace qlex {
   ///============================================================================///
   /// BEGIN: LEXER INTERNAL TYPES
   typedef std::string ident_buf_t;
-  typedef std::string num_buf_t;
+  typedef boost::container::small_vector<char, 64> num_buf_t;
   /// END:   LEXER INTERNAL TYPES
   ///============================================================================///
 
@@ -278,8 +369,7 @@ enum class NumType {
   Floating,
 };
 
-static thread_local boost::unordered_map<qlex::num_buf_t, NumType> num_cache;
-static thread_local boost::unordered_map<qlex::num_buf_t, qlex::num_buf_t> can_cache;
+typedef unsigned int uint128_t __attribute__((mode(TI)));
 
 ///============================================================================///
 
@@ -324,118 +414,108 @@ static bool validate_identifier(std::string_view id) {
   return state == 0;
 }
 
-static NumType check_number_literal_type(qlex::num_buf_t &input) {
-  if (num_cache.size() > 4096) {
-    num_cache = {};
-  } else if (num_cache.find(input) != num_cache.end()) {
-    return num_cache[input];
-  }
-
-  if (input.empty()) return num_cache[input] = NumType::Invalid;
+static NumType check_number_literal_type(std::string_view input) {
+  if (input.empty()) return NumType::Invalid;
 
   /* Check if it's a single digit */
   if (input.size() < 3) {
     if (std::isdigit(input[0]))
-      return num_cache[input] = NumType::Decimal;
+      return NumType::Decimal;
     else
-      return num_cache[input] = NumType::Invalid;
+      return NumType::Invalid;
   }
 
-  std::transform(input.begin(), input.end(), input.begin(), ::tolower);
-  std::erase(input, '_');
-
-  std::string prefix;
-  prefix.push_back(input[0]);
-  prefix.push_back(input[1]);
+  std::string_view prefix = input.substr(0, 2);
 
   size_t i;
 
   if (prefix == "0x") {
     for (i = 2; i < input.size(); i++)
       if (!((input[i] >= '0' && input[i] <= '9') || (input[i] >= 'a' && input[i] <= 'f')))
-        return num_cache[input] = NumType::Invalid;
+        return NumType::Invalid;
 
-    return num_cache[input] = NumType::Hexadecimal;
+    return NumType::Hexadecimal;
   } else if (prefix == "0b") {
     for (i = 2; i < input.size(); i++)
-      if (!(input[i] == '0' || input[i] == '1')) return num_cache[input] = NumType::Invalid;
+      if (!(input[i] == '0' || input[i] == '1')) return NumType::Invalid;
 
-    return num_cache[input] = NumType::Binary;
+    return NumType::Binary;
   } else if (prefix == "0o") {
     for (i = 2; i < input.size(); i++)
-      if (!(input[i] >= '0' && input[i] <= '7')) return num_cache[input] = NumType::Invalid;
+      if (!(input[i] >= '0' && input[i] <= '7')) return NumType::Invalid;
 
-    return num_cache[input] = NumType::Octal;
+    return NumType::Octal;
   } else if (prefix == "0d") {
     for (i = 2; i < input.size(); i++)
-      if (!(input[i] >= '0' && input[i] <= '9')) return num_cache[input] = NumType::Invalid;
+      if (!(input[i] >= '0' && input[i] <= '9')) return NumType::Invalid;
 
-    return num_cache[input] = NumType::DecimalExplicit;
+    return NumType::DecimalExplicit;
   } else {
     for (i = 0; i < input.size(); i++) {
       if (!(input[i] >= '0' && input[i] <= '9')) {
-        try {
-          double x;
-          auto r = std::from_chars(input.data(), input.data() + input.size(), x);
-
-          if (r.ec == std::errc::invalid_argument || r.ec == std::errc::result_out_of_range) {
-            return num_cache[input] = NumType::Invalid;
-          }
+        double x;
+        auto r = std::from_chars(input.data(), input.data() + input.size(), x);
 
-          return num_cache[input] = NumType::Floating;
-        } catch (...) {
-          return num_cache[input] = NumType::Invalid;
+        if (r.ec == std::errc::invalid_argument || r.ec == std::errc::result_out_of_range) {
+          return NumType::Invalid;
         }
+
+        return NumType::Floating;
       }
     }
 
-    return num_cache[input] = NumType::Decimal;
+    return NumType::Decimal;
   }
 }
 
-static bool canonicalize_float(std::string_view input, std::string &norm) {
+/* Equivalent of std::stod() on the input range, without copying it */
+static bool parse_double(std::string_view input, double &x) {
+  const char *begin = input.data(), *end = begin + input.size();
+
+  /* std::from_chars() takes no explicit plus sign, as in "1e+5" */
+  if (begin != end && *begin == '+') {
+    begin++;
+  }
+
+  auto r = std::from_chars(begin, end, x);
+
+  return r.ec == std::errc() && r.ptr != begin;
+}
+
+/* Returns the text of a floating point literal in canonical form. The view
+ * refers either to `input` or to `out`. */
+static std::optional<std::string_view> canonicalize_float(std::string_view input,
+                                                          std::array<char, 512> &out) {
   double mantissa = 0, exponent = 0, x = 0;
   size_t e_pos = 0;
 
-  if ((e_pos = input.find('e')) == std::string::npos) {
-    norm = input.data();
-    return true;
+  if ((e_pos = input.find('e')) == std::string_view::npos) {
+    return input;
   }
 
-  try {
-    mantissa = std::stod(std::string(input.substr(0, e_pos)));
-    exponent = std::stod(input.substr(e_pos + 1).data());
-    x = mantissa * std::pow(10.0, exponent);
-  } catch (...) {
-    return false;
+  if (!parse_double(input.substr(0, e_pos), mantissa) ||
+      !parse_double(input.substr(e_pos + 1), exponent)) {
+    return std::nullopt;
   }
 
-  std::stringstream ss;
-  ss << std::fixed << std::setprecision(FLOATING_POINT_PRECISION) << x;
-  norm = ss.str();
+  x = mantissa * std::pow(10.0, exponent);
 
-  return true;
-}
-
-static bool canonicalize_number(qlex::num_buf_t &number, std::string &norm, NumType type) {
-  if (can_cache.size() > 4096) {
-    can_cache = {};
-  } else if (can_cache.find(number) != can_cache.end()) {
-    return norm = can_cache[number], true;
+  auto r = std::to_chars(out.data(), out.data() + out.size(), x, std::chars_format::fixed,
+                         FLOATING_POINT_PRECISION);
+  if (r.ec != std::errc()) {
+    return std::nullopt;
   }
 
-  typedef unsigned int uint128_t __attribute__((mode(TI)));
-
-  uint128_t x = 0, i = 0;
+  return std::string_view(out.data(), r.ptr - out.data());
+}
 
-  std::transform(number.begin(), number.end(), number.begin(), ::tolower);
-  std::erase(number, '_');
+static bool parse_integer(std::string_view number, NumType type, uint128_t &x) {
+  x = 0;
 
   switch (type) {
     case NumType::Hexadecimal: {
-      for (i = 2; i < number.size(); ++i) {
-        // Check for overflow
-        if ((x >> 64) & 0xF000000000000000) {
+      for (size_t i = 2; i < number.size(); ++i) {
+        if (x >> 124) { /* Overflow */
           return false;
         }
 
@@ -450,9 +530,8 @@ static bool canonicalize_number(qlex::num_buf_t &number, std::string &norm, NumT
       break;
     }
     case NumType::Binary: {
-      for (i = 2; i < number.size(); ++i) {
-        // Check for overflow
-        if ((x >> 64) & 0x8000000000000000) {
+      for (size_t i = 2; i < number.size(); ++i) {
+        if (x >> 127) { /* Overflow */
           return false;
         }
         if (number[i] != '0' && number[i] != '1') {
@@ -464,9 +543,8 @@ static bool canonicalize_number(qlex::num_buf_t &number, std::string &norm, NumT
       break;
     }
     case NumType::Octal: {
-      for (i = 2; i < number.size(); ++i) {
-        // Check for overflow
-        if ((x >> 64) & 0xE000000000000000) {
+      for (size_t i = 2; i < number.size(); ++i) {
+        if (x >> 125) { /* Overflow */
           return false;
         }
         if (number[i] < '0' || number[i] > '7') {
@@ -477,32 +555,14 @@ static bool canonicalize_number(qlex::num_buf_t &number, std::string &norm, NumT
       }
       break;
     }
-    case NumType::DecimalExplicit: {
-      for (i = 2; i < number.size(); ++i) {
-        if (number[i] < '0' || number[i] > '9') {
-          return false;
-        }
-
-        // check for overflow
-        auto tmp = x;
-        x = (x * 10) + (number[i] - '0');
-
-        if (x < tmp) {
-          return false;
-        }
-      }
-      break;
-    }
+    case NumType::DecimalExplicit:
     case NumType::Decimal: {
-      for (i = 0; i < number.size(); ++i) {
+      for (size_t i = type == NumType::Decimal ? 0 : 2; i < number.size(); ++i) {
         if (number[i] < '0' || number[i] > '9') {
           return false;
         }
 
-        // check for overflow
-        auto tmp = x;
-        x = (x * 10) + (number[i] - '0');
-        if (x < tmp) {
+        if (__builtin_mul_overflow(x, 10, &x) || __builtin_add_overflow(x, number[i] - '0', &x)) {
           return false;
         }
       }
@@ -512,23 +572,56 @@ static bool canonicalize_number(qlex::num_buf_t &number, std::string &norm, NumT
       break;
   }
 
-  std::stringstream ss;
-  if (x == 0) {
-    ss << '0';
-  }
+  return true;
+}
 
-  for (i = x; i; i /= 10) {
-    ss << (char)('0' + i % 10);
+/* Integer literals below QLEX_INT_INLINE_MAX are carried in the payload by
+ * value; larger ones are interned in canonical decimal form */
+static qlex_size int_payload(qlex_t *lexer, uint128_t x) {
+  if (x <= QLEX_INT_INLINE_MAX) {
+    return QLEX_INT_INLINE | (qlex_size)x;
   }
 
-  std::string s = ss.str();
-  std::reverse(s.begin(), s.end());
+  char buf[40];
+  char *p = buf + sizeof(buf);
 
-  return can_cache[number] = (norm = s), true;
+  do {
+    *--p = '0' + (char)(x % 10);
+    x /= 10;
+  } while (x);
+
+  return lexer->put_string(std::string_view(p, buf + sizeof(buf) - p));
 }
 
 void qlex_t::reset_automata() { m_pushback.clear(); }
 
+void qlex_t::advance(size_t n) {
+  if (n == 0) {
+    return;
+  }
+
+  /* Replay the row/column bookkeeping of getc() over the whole run at once.
+   * Each step looks at the previous character, so the run's last byte is
+   * only relevant to the next read. */
+  const char *p = m_getc_cur;
+  size_t lines = qlex::scan::count_lf(p, n - 1);
+
+  if (lines > 0) {
+    const char *last = static_cast<const char *>(memrchr(p, '\n', n - 1));
+    m_row += lines + (m_last_ch == '\n');
+    m_col = n - 1 - (last - p);
+  } else if (m_last_ch == '\n') {
+    m_row++;
+    m_col = n;
+  } else {
+    m_col += n;
+  }
+
+  m_offset += n;
+  m_last_ch = p[n - 1];
+  m_getc_cur += n;
+}
+
 CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
   /**
    * **WARNING**: Do not just start editing this function without
@@ -554,6 +647,10 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
     Other,
   };
 
+  if (m_prelexed_pos < m_prelexed.size()) {
+    return m_prelexed[m_prelexed_pos++];
+  }
+
   std::string buf;
 
   LexState state = LexState::Start;
@@ -583,6 +680,9 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
       switch (state) {
         case LexState::Start: {
           if (lex_is_space(c)) {
+            if (m_pushback.empty()) { /* Skip the rest of the run in bulk */
+              advance(qlex::scan::skip_ws(m_getc_cur, m_getc_end - m_getc_cur));
+            }
             continue;
           } else if (std::isalpha(c) || c == '_') {
             /* Identifier or keyword or operator */
@@ -634,6 +734,13 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
               }
 
               ibuf += c;
+
+              if (c != ':') { /* Plain identifier characters need no colon tracking */
+                size_t n = qlex::scan::skip_ident(m_getc_cur, m_getc_end - m_getc_cur);
+                ibuf.append(m_getc_cur, n);
+                advance(n);
+              }
+
               c = getc();
             }
           }
@@ -653,16 +760,14 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
           m_pushback.push_back(c);
 
           { /* Determine if it's a keyword or an identifier */
-            auto it = qlex::keywords.left.find(ibuf);
-            if (it != qlex::keywords.left.end()) {
-              return qlex_tok_t(qKeyW, it->second, start_pos, cur_loc());
+            if (auto key = qlex::keywords.find(ibuf)) {
+              return qlex_tok_t(qKeyW, *key, start_pos, cur_loc());
             }
           }
 
           { /* Check if it's an operator */
-            auto it = qlex::word_operators.left.find(ibuf);
-            if (it != qlex::word_operators.left.end()) {
-              return qlex_tok_t(qOper, it->second, start_pos, cur_loc());
+            if (auto op = qlex::word_operators.find(ibuf)) {
+              return qlex_tok_t(qOper, *op, start_pos, cur_loc());
             }
           }
 
@@ -677,7 +782,7 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
         case LexState::Integer: {
           qlex::num_buf_t nbuf;
 
-          nbuf += buf[0];
+          nbuf.push_back(buf[0]);
           { /* Read in what is hopefully an integer */
             while (true) {
               if (!(std::isxdigit(c) || c == '_' || c == '-' || c == '.' || c == 'x' || c == 'b' ||
@@ -691,48 +796,40 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
                 } while (lex_is_space(c) || c == '_' || c == '\\');
               }
 
-              nbuf += c;
+              nbuf.push_back(c);
               c = getc();
             }
           }
 
           { /* Handle lexical ambiguity */
-            std::vector<char> items;
-
-            bool cutting = true;
-            while (cutting) {
-              if (nbuf.empty()) {
-                break;
-              }
-
-              char last = nbuf.back();
-
-              switch (last) {
-                case '_':
-                case '.':
-                case '-':
-                  items.push_back(last);
-                  nbuf.pop_back();
-                  break;
-                default:
-                  cutting = false;
-                  break;
-              }
+            /* Trailing '_', '.' and '-' are not part of the number; they are
+             * read again, in order, after it */
+            size_t keep = nbuf.size();
+            while (keep > 0 && (nbuf[keep - 1] == '_' || nbuf[keep - 1] == '.' ||
+                                nbuf[keep - 1] == '-')) {
+              keep--;
             }
 
-            for (auto it = items.rbegin(); it != items.rend(); ++it) {
-              m_pushback.push_back(*it);
+            for (size_t i = keep; i < nbuf.size(); i++) {
+              m_pushback.push_back(nbuf[i]);
             }
+            nbuf.resize(keep);
             m_pushback.push_back(c);
           }
 
+          for (char &ch : nbuf) {
+            ch = std::tolower(ch);
+          }
+
+          std::string_view number(nbuf.data(), nbuf.size());
+
           /* Check if it's a floating point number */
           NumType type;
 
-          std::string norm;
-          if ((type = check_number_literal_type(nbuf)) == NumType::Floating) {
-            if (canonicalize_float(nbuf, norm)) {
-              return qlex_tok_t(qNumL, put_string(std::move(norm)), start_pos, cur_loc());
+          if ((type = check_number_literal_type(number)) == NumType::Floating) {
+            std::array<char, 512> fbuf;
+            if (auto norm = canonicalize_float(number, fbuf)) {
+              return qlex_tok_t(qNumL, put_string(*norm), start_pos, cur_loc());
             } else {
               goto error_0;
             }
@@ -744,8 +841,8 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
           }
 
           /* Canonicalize the number */
-          if (canonicalize_number(nbuf, norm, type)) {
-            return qlex_tok_t(qIntL, put_string(std::move(norm)), start_pos, cur_loc());
+          if (uint128_t x; parse_integer(number, type, x)) {
+            return qlex_tok_t(qIntL, int_payload(this, x), start_pos, cur_loc());
           }
 
           /* Invalid number */
@@ -766,6 +863,13 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
         case LexState::CommentSingleLine: {
           while (c != '\n') {
             buf += c;
+
+            const char *end = static_cast<const char *>(
+                memchr(m_getc_cur, '\n', m_getc_end - m_getc_cur));
+            size_t n = (end ? end : m_getc_end) - m_getc_cur;
+            buf.append(m_getc_cur, n);
+            advance(n);
+
             c = getc();
           }
 
@@ -803,6 +907,11 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
               c = getc();
             } else {
               buf += c;
+
+              size_t n = qlex::scan::skip_comment(m_getc_cur, m_getc_end - m_getc_cur);
+              buf.append(m_getc_cur, n);
+              advance(n);
+
               c = getc();
             }
           }
@@ -814,6 +923,12 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
             /* Normal character */
             if (c != '\\') {
               buf += c;
+
+              if (m_pushback.empty()) { /* Consume the plain run in bulk */
+                size_t n = qlex::scan::skip_string(m_getc_cur, m_getc_end - m_getc_cur, buf[0]);
+                buf.append(m_getc_cur, n);
+                advance(n);
+              }
               continue;
             }
 
@@ -1045,10 +1160,9 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
         case LexState::Other: {
           /* Check if it's a punctor */
           if (buf.size() == 1) {
-            auto it = qlex::punctuation.left.find(buf);
-            if (it != qlex::punctuation.left.end()) {
+            if (auto punc = qlex::punctuation[static_cast<uint8_t>(buf[0])]) {
               m_pushback.push_back(c);
-              return qlex_tok_t(qPunc, it->second, start_pos, cur_loc());
+              return qlex_tok_t(qPunc, *punc, start_pos, cur_loc());
             }
           }
 
@@ -1067,16 +1181,12 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
             continue;
           }
 
-          bool found = false;
+          std::optional<qlex_op_t> found;
           while (true) {
-            bool contains = false;
-            if (std::any_of(qlex::operators.begin(), qlex::operators.end(),
-                            [&](const auto &pair) { return pair.left == buf; })) {
-              contains = true;
-              found = true;
-            }
+            auto op = qlex::operators.find(buf);
 
-            if (contains) {
+            if (op) {
+              found = op;
               buf += c;
               if (buf.size() > 4) { /* Handle infinite error case */
                 goto error_0;
@@ -1093,8 +1203,7 @@ CPP_EXPORT qlex_tok_t qlex_t::next_impl() {
 
           m_pushback.push_back(buf.back());
           m_pushback.push_back(c);
-          return qlex_tok_t(qOper, qlex::operators.left.at(buf.substr(0, buf.size() - 1)),
-                            start_pos, cur_loc());
+          return qlex_tok_t(qOper, *found, start_pos, cur_loc());
         }
       }
     }
@@ -1119,11 +1228,11 @@ LIB_EXPORT qlex_size qlex_tok_size(qlex_t *lexer, const qlex_tok_t *tok) {
       case qErro:
         return 0;
       case qKeyW:
-        return qlex::keywords.right.at(tok->v.key).size();
+        return qlex::name_of(qlex::keyword_names, tok->v.key).size();
       case qOper:
-        return qlex::operators.right.at(tok->v.op).size();
+        return qlex::name_of(qlex::operator_names, tok->v.op).size();
       case qPunc:
-        return qlex::punctuation.right.at(tok->v.punc).size();
+        return qlex::name_of(qlex::punctuation_names, tok->v.punc).size();
       case qName:
       case qIntL:
       case qNumL:
@@ -1148,7 +1257,7 @@ LIB_EXPORT qlex_size qlex_tok_size(qlex_t *lexer, const qlex_tok_t *tok) {
 LIB_EXPORT qlex_size qlex_tok_write(qlex_t *lexer, const qlex_tok_t *tok, char *buf,
                                     qlex_size size) {
   try {
-    size_t ret;
+    size_t ret = 0;
 
     switch (tok->ty) {
       case qEofF:
@@ -1156,24 +1265,27 @@ LIB_EXPORT qlex_size qlex_tok_write(qlex_t *lexer, const qlex_tok_t *tok, char *
         ret = 0;
         break;
       case qKeyW: {
-        if ((ret = qlex::keywords.right.at(tok->v.key).size()) <= size) {
-          memcpy(buf, qlex::keywords.right.at(tok->v.key).data(), ret);
+        auto sv = qlex::name_of(qlex::keyword_names, tok->v.key);
+        if ((ret = sv.size()) <= size) {
+          memcpy(buf, sv.data(), ret);
         } else {
           ret = 0;
         }
         break;
       }
       case qOper: {
-        if ((ret = qlex::operators.right.at(tok->v.op).size()) <= size) {
-          memcpy(buf, qlex::operators.right.at(tok->v.op).data(), ret);
+        auto sv = qlex::name_of(qlex::operator_names, tok->v.op);
+        if ((ret = sv.size()) <= size) {
+          memcpy(buf, sv.data(), ret);
         } else {
           ret = 0;
         }
         break;
       }
       case qPunc: {
-        if ((ret = qlex::punctuation.right.at(tok->v.punc).size()) <= size) {
-          memcpy(buf, qlex::punctuation.right.at(tok->v.punc).data(), ret);
+        auto sv = qlex::name_of(qlex::punctuation_names, tok->v.punc);
+        if ((ret = sv.size()) <= size) {
+          memcpy(buf, sv.data(), ret);
         } else {
           ret = 0;
         }
@@ -1195,6 +1307,10 @@ LIB_EXPORT qlex_size qlex_tok_write(qlex_t *lexer, const qlex_tok_t *tok, char *
         }
         break;
       }
+      default:
+        /* Not a token type; there is no text to write */
+        ret = 0;
+        break;
     }
 
     return ret;
@@ -1343,27 +1459,30 @@ LIB_EXPORT const char *qlex_str(qlex_t *lexer, qlex_tok_t *tok, size_t *len) {
 }
 
 LIB_EXPORT const char *qlex_opstr(qlex_op_t op) {
-  try {
-    return qlex::operators.right.at(op).data();
-  } catch (...) {
+  auto sv = qlex::name_of(qlex::operator_names, op);
+  if (sv.empty()) [[unlikely]] {
     qcore_panic("qlex_opstr: invalid operator");
   }
+
+  return sv.data();
 }
 
 LIB_EXPORT const char *qlex_kwstr(qlex_key_t kw) {
-  try {
-    return qlex::keywords.right.at(kw).data();
-  } catch (...) {
+  auto sv = qlex::name_of(qlex::keyword_names, kw);
+  if (sv.empty()) [[unlikely]] {
     qcore_panic("qlex_kwstr: invalid keyword");
   }
+
+  return sv.data();
 }
 
 LIB_EXPORT const char *qlex_punctstr(qlex_punc_t punct) {
-  try {
-    return qlex::punctuation.right.at(punct).data();
-  } catch (...) {
+  auto sv = qlex::name_of(qlex::punctuation_names, punct);
+  if (sv.empty()) [[unlikely]] {
     qcore_panic("qlex_punctstr: invalid punctuation");
   }
+
+  return sv.data();
 }
 
 LIB_EXPORT void qlex_tok_fromstr(qlex_t *lexer, qlex_ty_t ty, const char *str, qlex_tok_t *out) {
@@ -1381,31 +1500,32 @@ LIB_EXPORT void qlex_tok_fromstr(qlex_t *lexer, qlex_ty_t ty, const char *str, q
       }
 
       case qKeyW: {
-        auto find = qlex::keywords.left.find(str);
-        if (find == qlex::keywords.left.end()) [[unlikely]] {
+        auto find = qlex::keywords.find(str);
+        if (!find) [[unlikely]] {
           out->ty = qErro;
         } else {
-          out->v.key = find->second;
+          out->v.key = *find;
         }
         break;
       }
 
       case qOper: {
-        auto find = qlex::operators.left.find(str);
-        if (find == qlex::operators.left.end()) [[unlikely]] {
+        auto find = qlex::operators.find(str);
+        if (!find) [[unlikely]] {
           out->ty = qErro;
         } else {
-          out->v.op = find->second;
+          out->v.op = *find;
         }
         break;
       }
 
       case qPunc: {
-        auto find = qlex::punctuation.left.find(str);
-        if (find == qlex::punctuation.left.end()) [[unlikely]] {
+        auto find = str[0] && !str[1] ? qlex::punctuation[static_cast<uint8_t>(str[0])]
+                                       : std::nullopt;
+        if (!find) [[unlikely]] {
           out->ty = qErro;
         } else {
-          out->v.punc = find->second;
+          out->v.punc = *find;
         }
         break;
       }
@@ -1416,7 +1536,17 @@ LIB_EXPORT void qlex_tok_fromstr(qlex_t *lexer, qlex_ty_t ty, const char *str, q
       }
 
       case qIntL: {
-        out->v.str_idx = lexer->put_string(str);
+        /* Use the same payload that lexing the literal would produce */
+        std::string_view text(str);
+        qlex_size x;
+        auto r = std::from_chars(text.data(), text.data() + text.size(), x);
+
+        if (r.ec == std::errc() && r.ptr == text.data() + text.size() &&
+            x <= QLEX_INT_INLINE_MAX && (text.size() == 1 || text[0] != '0')) {
+          out->v.str_idx = QLEX_INT_INLINE | x;
+        } else {
+          out->v.str_idx = lexer->put_string(str);
+        }
         break;
       }
 
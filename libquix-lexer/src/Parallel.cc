@@ -0,0 +1,307 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#define __QUIX_LEXER_IMPL__
+
+#include <quix-core/Pool.hh>
+#include <quix-lexer/Lexer.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <quix-lexer/Base.hh>
+#include <thread>
+#include <vector>
+
+#include "LibMacro.h"
+
+///============================================================================///
+/// BEGIN: PARALLEL LEXING
+///
+/// The source is split at line starts and every chunk is lexed speculatively
+/// by its own lexer, as if the chunk began in the initial lexer state. Each
+/// chunk then keeps lexing past its end until it reaches a state that the
+/// next chunk also passed through. From that point on both lexers produce the
+/// same tokens, so the streams can be joined there. Between two tokens, the
+/// lexer's future output depends only on the read offset and the pushback
+/// queue, and that pair is what gets compared. A split that lands inside a
+/// string, comment or macro block never matches and is skipped over.
+
+namespace {
+  struct ResumeState {
+    qlex_size pos;   /* Offset of the next byte to read */
+    uint8_t len;     /* Length of the pushback queue; UINT8_MAX if untracked */
+    char pushback[7];
+
+    bool operator==(const ResumeState &o) const {
+      return pos == o.pos && len == o.len && len != UINT8_MAX &&
+             memcmp(pushback, o.pushback, len) == 0;
+    }
+  };
+}  // namespace
+
+struct qlex_chunk_t {
+  std::unique_ptr<qlex_t> lexer;
+  qlex_size begin, end;
+
+  std::vector<qlex_tok_t> tokens;
+  std::vector<ResumeState> states;  /* `states[k]` is the state before `tokens[k]` */
+  std::vector<ResumeState> anchors; /* `states` as of the end of the first pass */
+  bool eof = false;
+
+  /* Tokens before `sync_tok` are followed by the tokens of chunk `sync_chunk`
+   * starting at its state `sync_state`. Unset if the chunk ran to the end. */
+  size_t sync_tok = SIZE_MAX, sync_chunk = 0, sync_state = 0;
+
+  qlex_chunk_t(std::string_view src, qlex_size begin, qlex_size end, qcore_env_t env)
+      : lexer(std::make_unique<qlex_t>(src, nullptr, env)), begin(begin), end(end) {
+    lexer->m_getc_cur = src.data() + begin;
+    lexer->m_offset = begin - 1;
+    lexer->m_last_ch = begin ? src[begin - 1] : 0;
+  }
+
+  ResumeState state() const {
+    ResumeState st{};
+
+    st.pos = lexer->m_offset + 1;
+
+    if (lexer->m_pushback.size() > sizeof(st.pushback)) {
+      st.len = UINT8_MAX;
+    } else {
+      st.len = lexer->m_pushback.size();
+      std::copy(lexer->m_pushback.begin(), lexer->m_pushback.end(), st.pushback);
+    }
+
+    return st;
+  }
+
+  bool step() {
+    qlex_tok_t tok;
+
+    if (eof || !lexer->next_raw(tok)) {
+      eof = true;
+      return false;
+    }
+
+    tokens.push_back(tok);
+    states.push_back(state());
+
+    return true;
+  }
+
+  void first_pass() {
+    states.push_back(state());
+    while (states.back().pos < end && step()) {
+    }
+    anchors = states;
+  }
+
+  /* Find a state at or after `from` that some later chunk also reached */
+  bool find_sync(const std::vector<qlex_chunk_t> &chunks, size_t self, size_t from) {
+    sync_tok = SIZE_MAX;
+
+    if (self + 1 >= chunks.size()) {
+      while (step()) {
+      }
+      return false;
+    }
+
+    size_t m = self + 1;
+
+    for (size_t k = from;; k++) {
+      if (k >= states.size() && !step()) {
+        return false;
+      }
+
+      const ResumeState &st = states[k];
+      if (st.pos < chunks[self + 1].begin) {
+        continue;
+      }
+
+      while (m < chunks.size() && st.pos > chunks[m].anchors.back().pos) {
+        m++;
+      }
+
+      if (m == chunks.size() || st.pos < chunks[m].begin) {
+        continue;
+      }
+
+      const auto &a = chunks[m].anchors;
+      auto it = std::lower_bound(a.begin(), a.end(), st.pos,
+                                 [](const ResumeState &x, qlex_size pos) { return x.pos < pos; });
+      for (; it != a.end() && it->pos == st.pos; ++it) {
+        if (*it == st) {
+          sync_tok = k;
+          sync_chunk = m;
+          sync_state = it - a.begin();
+          return true;
+        }
+      }
+    }
+  }
+
+  /* Move tokens [from, to) into `L`, rebasing locations and strings */
+  void adopt(qlex_t *L, size_t from, size_t to) const {
+    auto rebase = [&](qlex_loc_t loc) -> qlex_loc_t {
+      if (loc.tag == 0 || loc.tag > lexer->m_loc_off.size()) {
+        return {0};
+      }
+      return L->push_loc(lexer->m_loc_off[loc.tag - 1]);
+    };
+
+    for (size_t i = from; i < to; i++) {
+      qlex_tok_t tok = tokens[i];
+
+      tok.start = rebase(tok.start);
+      tok.end = rebase(tok.end);
+
+      switch (tok.ty) {
+        case qName:
+        case qIntL:
+        case qNumL:
+        case qText:
+        case qChar:
+        case qMacB:
+        case qMacr:
+        case qNote:
+          if (!(tok.v.str_idx & QLEX_INT_INLINE)) {
+            tok.v.str_idx = L->put_string(lexer->get_string(tok.v.str_idx));
+          }
+          break;
+        default:
+          break;
+      }
+
+      L->m_prelexed.push_back(tok);
+    }
+  }
+};
+
+CPP_EXPORT bool qlex_t::prelex_parallel(size_t threads, size_t chunk_size) {
+  static constexpr size_t MIN_CHUNK_SIZE = 4096;
+
+  /* Only untouched lexers over an in-memory source qualify */
+  if (!m_src.data() || m_getc_cur != m_src.data() || !m_pushback.empty() ||
+      !m_prelexed.empty() || !m_loc_off.empty()) {
+    return false;
+  }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  if (chunk_size == 0) {
+    chunk_size = std::max<size_t>(m_src.size() / (threads * 4), 256 * 1024);
+  }
+  chunk_size = std::max(chunk_size, MIN_CHUNK_SIZE);
+
+  std::vector<qlex_size> splits = {0};
+  while (splits.back() + chunk_size < m_src.size()) {
+    const char *p = m_src.data() + splits.back() + chunk_size;
+    const char *lf = (const char *)memchr(p, '\n', m_src.data() + m_src.size() - p);
+    if (!lf || lf + 1 == m_src.data() + m_src.size()) {
+      break;
+    }
+    splits.push_back(lf + 1 - m_src.data());
+  }
+
+  try {
+    std::vector<qlex_chunk_t> chunks;
+    chunks.reserve(splits.size());
+    for (size_t i = 0; i < splits.size(); i++) {
+      qlex_size end = i + 1 < splits.size() ? splits[i + 1] : UINT32_MAX;
+      chunks.emplace_back(m_src, splits[i], end, m_env);
+    }
+
+    std::atomic<bool> failed = false;
+    auto guarded = [&](auto fn) {
+      return [&, fn](size_t i) {
+        try {
+          fn(i);
+        } catch (...) {
+          failed = true;
+        }
+      };
+    };
+
+    /* Short of threads, the serial lexer does the work instead */
+    if (!qcore_run_pool(threads, chunks.size(),
+                        guarded([&](size_t i) { chunks[i].first_pass(); })) ||
+        !qcore_run_pool(threads, chunks.size(), guarded([&](size_t i) {
+                          chunks[i].find_sync(chunks, i, chunks[i].states.size() - 1);
+                        })) ||
+        failed) {
+      return false;
+    }
+
+    /* Walk the chain of synchronization points; a chunk entered past its
+     * precomputed point is resynchronized serially */
+    for (size_t c = 0, from = 0;;) {
+      qlex_chunk_t &chunk = chunks[c];
+
+      if (chunk.sync_tok == SIZE_MAX || chunk.sync_tok < from) {
+        chunk.find_sync(chunks, c, from);
+      }
+
+      if (chunk.sync_tok == SIZE_MAX) {
+        chunk.adopt(this, from, chunk.tokens.size());
+        break;
+      }
+
+      chunk.adopt(this, from, chunk.sync_tok);
+      from = chunk.sync_state;
+      c = chunk.sync_chunk;
+    }
+  } catch (std::bad_alloc &) {
+    m_prelexed.clear();
+    m_loc_off.clear();
+    return false;
+  }
+
+  /* The whole source has been consumed */
+  m_getc_cur = m_getc_end;
+  m_src_padded = true;
+
+  return true;
+}
+
+LIB_EXPORT bool qlex_lex_parallel(qlex_t *lexer, size_t threads, size_t chunk_size) {
+  try {
+    return lexer->prelex_parallel(threads, chunk_size);
+  } catch (...) {
+    qcore_panic("qlex_lex_parallel: failed to lex in parallel");
+  }
+}
+
+/// END:   PARALLEL LEXING
+///============================================================================///
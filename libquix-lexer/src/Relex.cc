@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#define __QUIX_LEXER_IMPL__
+
+#include <quix-lexer/Lexer.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <quix-lexer/Base.hh>
+#include <vector>
+
+#include "LibMacro.h"
+
+///============================================================================///
+/// BEGIN: INCREMENTAL RELEXING
+///
+/// Between two tokens the lexer holds no state besides its position, so
+/// lexing can restart at the start of any old token before the edit. The
+/// first relexed token is checked against the old one to confirm that, and a
+/// restart further back is tried otherwise. Once a relexed token starts at the
+/// same (shifted) position as an old token past the edit, both lexers see the
+/// same text from the same state and all remaining old tokens are reused.
+///
+/// The new lexer copies the old location table with offsets past the edit
+/// shifted, and shares the old string table, so that the retained old tokens
+/// remain valid without being touched.
+
+namespace {
+  bool same_value(const qlex_tok_t &a, const qlex_tok_t &b) {
+    if (a.ty != b.ty) {
+      return false;
+    }
+
+    switch (a.ty) {
+      case qEofF:
+      case qErro:
+        return true;
+      case qKeyW:
+        return a.v.key == b.v.key;
+      case qOper:
+        return a.v.op == b.v.op;
+      case qPunc:
+        return a.v.punc == b.v.punc;
+      default:
+        return a.v.str_idx == b.v.str_idx;
+    }
+  }
+}  // namespace
+
+CPP_EXPORT qlex_t *qlex_t::relex(const qlex_tok_t *tokens, size_t count, std::string_view src,
+                                 qlex_size offset, qlex_size removed, qlex_size inserted,
+                                 qlex_splice_t *splice) {
+  static constexpr qlex_size NONE = std::numeric_limits<qlex_size>::max();
+
+  qlex_size old_len = m_src.data() ? m_src.size() : m_lines_scanned;
+  if (offset > src.size() || (m_src.data() && offset + removed > old_len) ||
+      (m_src.data() && src.size() != old_len - removed + inserted) ||
+      offset + inserted > src.size()) {
+    return nullptr;
+  }
+
+  const qlex_size edit_end = offset + removed; /* In old coordinates */
+  const int64_t delta = (int64_t)inserted - (int64_t)removed;
+
+  auto start_of = [&](size_t i) { return loc2offset(tokens[i].start).value_or(NONE); };
+  auto end_of = [&](size_t i) { return loc2offset(tokens[i].end).value_or(NONE); };
+
+  /* The trailing end-of-file token carries no location */
+  size_t n = count;
+  if (n && tokens[n - 1].ty == qEofF) {
+    n--;
+  }
+
+  auto L = std::make_unique<qlex_t>(src, m_filename, m_env);
+  L->m_flags = m_flags;
+  L->m_strings = m_strings;
+
+  /* Carry over the locations, moving those past the edit along with their
+   * text and clamping those inside it to the edit. Explicit rows and columns
+   * are only known to remain correct before the edit. */
+  L->m_loc_off.resize(m_loc_off.size());
+  std::transform(m_loc_off.begin(), m_loc_off.end(), L->m_loc_off.begin(), [&](qlex_size off) {
+    if (off == NONE || off < offset) {
+      return off;
+    }
+    return off >= edit_end ? (qlex_size)(off + delta) : offset;
+  });
+
+  for (const auto &e : m_loc_rc) {
+    if (m_loc_off[e.tag - 1] < offset) {
+      L->m_loc_rc.push_back(e);
+    }
+  }
+
+  const size_t base_locs = L->m_loc_off.size();
+  const size_t base_rc = L->m_loc_rc.size();
+
+  /* Index of the first old token wholly past the edit */
+  size_t tail = std::partition_point(tokens, tokens + n,
+                                     [&](const qlex_tok_t &t) {
+                                       auto s = loc2offset(t.start);
+                                       return !s || *s < edit_end;
+                                     }) -
+                tokens;
+
+  /* The first old token that may be affected is the first one that ends at
+   * or after the edit; a lookahead may have reached slightly past its end. */
+  size_t hit = std::partition_point(tokens, tokens + n,
+                                    [&](const qlex_tok_t &t) {
+                                      auto e = loc2offset(t.end);
+                                      return !e || *e + 1 < offset;
+                                    }) -
+               tokens;
+
+  std::vector<qlex_tok_t> fresh;
+
+  for (size_t back = 1;; back *= 8) {
+    size_t first = hit > back ? hit - back : 0;
+    qlex_size restart = first ? start_of(first) : 0;
+
+    if (restart == NONE || restart > offset) {
+      continue;
+    }
+
+    fresh.clear();
+    L->m_loc_off.resize(base_locs);
+    L->m_loc_rc.resize(base_rc);
+    L->m_pushback.clear();
+    L->m_src_padded = false;
+    L->m_getc_cur = src.data() + restart;
+    L->m_getc_end = src.data() + src.size();
+    L->m_offset = restart - 1;
+    L->m_last_ch = restart ? src[restart - 1] : 0;
+
+    bool checked = first == 0;
+    bool synced = false;
+    size_t j = tail;
+    qlex_tok_t tok;
+
+    while (L->next_raw(tok)) {
+      if (m_flags & QLEX_NO_COMMENTS && tok.ty == qNote) {
+        continue;
+      }
+
+      qlex_size s = L->loc2offset(tok.start).value_or(NONE);
+      qlex_size e = L->loc2offset(tok.end).value_or(NONE);
+
+      if (!checked) { /* The restart point must reproduce the old token */
+        if (!same_value(tok, tokens[first]) || s != restart || e != end_of(first)) {
+          break;
+        }
+        checked = true;
+      }
+
+      if (s != NONE && s >= offset + inserted) {
+        qlex_size s_old = s - delta;
+        while (j < n && start_of(j) < s_old) {
+          j++;
+        }
+
+        if (j < n && start_of(j) == s_old && same_value(tok, tokens[j]) &&
+            e == L->loc2offset(tokens[j].end).value_or(NONE)) {
+          synced = true;
+          break;
+        }
+      }
+
+      fresh.push_back(tok);
+    }
+
+    if (!checked) {
+      continue;
+    }
+
+    if (!synced) {
+      j = n;
+    }
+
+    qlex_tok_t *out = nullptr;
+    if (!fresh.empty()) {
+      if (!(out = (qlex_tok_t *)malloc(fresh.size() * sizeof(qlex_tok_t)))) {
+        return nullptr;
+      }
+      memcpy(out, fresh.data(), fresh.size() * sizeof(qlex_tok_t));
+    }
+
+    splice->first = first;
+    splice->removed = j - first;
+    splice->tokens = out;
+    splice->count = fresh.size();
+
+    break;
+  }
+
+  /* Everything the new lexer has to offer is accounted for by the splice */
+  L->m_pushback.clear();
+  L->m_getc_cur = L->m_getc_end;
+  L->m_src_padded = true;
+
+  return L.release();
+}
+
+LIB_EXPORT qlex_t *qlex_relex(qlex_t *lexer, const qlex_tok_t *tokens, size_t count,
+                              const char *src, size_t len, qlex_size offset, qlex_size removed,
+                              qlex_size inserted, qlex_splice_t *splice) {
+  try {
+    return lexer->relex(tokens, count, std::string_view(src, len), offset, removed, inserted,
+                        splice);
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  } catch (...) {
+    qcore_panic("qlex_relex: failed to relex");
+  }
+}
+
+/// END:   INCREMENTAL RELEXING
+///============================================================================///
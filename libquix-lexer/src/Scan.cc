@@ -0,0 +1,304 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#define __QUIX_LEXER_IMPL__
+
+#include <array>
+#include <cstdint>
+
+#include "Scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QLEX_SCAN_X86 1
+#else
+#define QLEX_SCAN_X86 0
+#endif
+
+namespace qlex::scan {
+  static constexpr std::array<uint8_t, 256> ws_tab = []() {
+    std::array<uint8_t, 256> tab = {};
+    tab[' '] = 1;
+    tab['\f'] = 1;
+    tab['\n'] = 1;
+    tab['\r'] = 1;
+    tab['\t'] = 1;
+    tab['\v'] = 1;
+    tab['\0'] = 1;
+    return tab;
+  }();
+
+  static constexpr std::array<uint8_t, 256> ident_tab = []() {
+    std::array<uint8_t, 256> tab = {};
+    for (int c = 'a'; c <= 'z'; c++) tab[c] = 1;
+    for (int c = 'A'; c <= 'Z'; c++) tab[c] = 1;
+    for (int c = '0'; c <= '9'; c++) tab[c] = 1;
+    tab['_'] = 1;
+    return tab;
+  }();
+
+  ///============================================================================///
+  /// BEGIN: SCALAR KERNELS
+  namespace scalar {
+    static size_t skip_ws(const char *p, size_t n) {
+      size_t i = 0;
+      while (i < n && ws_tab[(uint8_t)p[i]]) i++;
+      return i;
+    }
+
+    static size_t skip_ident(const char *p, size_t n) {
+      size_t i = 0;
+      while (i < n && ident_tab[(uint8_t)p[i]]) i++;
+      return i;
+    }
+
+    static size_t skip_comment(const char *p, size_t n) {
+      size_t i = 0;
+      while (i < n && p[i] != '*' && p[i] != '/') i++;
+      return i;
+    }
+
+    static size_t skip_string(const char *p, size_t n, char quote) {
+      size_t i = 0;
+      while (i < n && p[i] != quote && p[i] != '\\' && p[i] != '\xff') i++;
+      return i;
+    }
+
+    static size_t count_lf(const char *p, size_t n) {
+      size_t count = 0;
+      for (size_t i = 0; i < n; i++) {
+        count += p[i] == '\n';
+      }
+      return count;
+    }
+  }  // namespace scalar
+  /// END:   SCALAR KERNELS
+  ///============================================================================///
+
+#if QLEX_SCAN_X86
+  ///============================================================================///
+  /// BEGIN: SSE4.2 KERNELS
+  namespace sse42 {
+#define SSE42 __attribute__((target("sse4.2,popcnt")))
+
+    static constexpr int SET_ANY = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT;
+    static constexpr int RANGES = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT;
+
+    SSE42 static size_t skip_ws(const char *p, size_t n) {
+      const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', 0, 0, 0, 0, 0, 0, 0, 0,
+                                        0, 0);
+      size_t i = 0;
+      for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        int idx = _mm_cmpestri(set, 7, v, 16, SET_ANY | _SIDD_NEGATIVE_POLARITY);
+        if (idx != 16) {
+          return i + idx;
+        }
+      }
+      return i + scalar::skip_ws(p + i, n - i);
+    }
+
+    SSE42 static size_t skip_ident(const char *p, size_t n) {
+      const __m128i set = _mm_setr_epi8('a', 'z', 'A', 'Z', '0', '9', '_', '_', 0, 0, 0, 0, 0, 0,
+                                        0, 0);
+      size_t i = 0;
+      for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        int idx = _mm_cmpestri(set, 8, v, 16, RANGES | _SIDD_NEGATIVE_POLARITY);
+        if (idx != 16) {
+          return i + idx;
+        }
+      }
+      return i + scalar::skip_ident(p + i, n - i);
+    }
+
+    SSE42 static size_t skip_comment(const char *p, size_t n) {
+      const __m128i set = _mm_setr_epi8('*', '/', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      size_t i = 0;
+      for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        int idx = _mm_cmpestri(set, 2, v, 16, SET_ANY);
+        if (idx != 16) {
+          return i + idx;
+        }
+      }
+      return i + scalar::skip_comment(p + i, n - i);
+    }
+
+    SSE42 static size_t skip_string(const char *p, size_t n, char quote) {
+      const __m128i set = _mm_setr_epi8(quote, '\\', '\xff', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      size_t i = 0;
+      for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        int idx = _mm_cmpestri(set, 3, v, 16, SET_ANY);
+        if (idx != 16) {
+          return i + idx;
+        }
+      }
+      return i + scalar::skip_string(p + i, n - i, quote);
+    }
+
+    SSE42 static size_t count_lf(const char *p, size_t n) {
+      const __m128i lf = _mm_set1_epi8('\n');
+      size_t i = 0, count = 0;
+      for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+      }
+      return count + scalar::count_lf(p + i, n - i);
+    }
+
+#undef SSE42
+  }  // namespace sse42
+  /// END:   SSE4.2 KERNELS
+  ///============================================================================///
+
+  ///============================================================================///
+  /// BEGIN: AVX2 KERNELS
+  namespace avx2 {
+#define AVX2 __attribute__((target("avx2,bmi,popcnt")))
+
+    /* Bytes of `v` in the inclusive range [lo, lo + len] */
+    AVX2 static inline __m256i in_range(__m256i v, char lo, char len) {
+      __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+      return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(len)), t);
+    }
+
+    AVX2 static size_t skip_ws(const char *p, size_t n) {
+      size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                     _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+        ws = _mm256_or_si256(ws, in_range(v, '\t', '\r' - '\t'));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+        if (mask) {
+          return i + _tzcnt_u32(mask);
+        }
+      }
+      return i + scalar::skip_ws(p + i, n - i);
+    }
+
+    AVX2 static size_t skip_ident(const char *p, size_t n) {
+      size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i id = _mm256_or_si256(in_range(lower, 'a', 'z' - 'a'), in_range(v, '0', '9' - '0'));
+        id = _mm256_or_si256(id, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(id);
+        if (mask) {
+          return i + _tzcnt_u32(mask);
+        }
+      }
+      return i + scalar::skip_ident(p + i, n - i);
+    }
+
+    AVX2 static size_t skip_comment(const char *p, size_t n) {
+      size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')),
+                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+        uint32_t mask = _mm256_movemask_epi8(hit);
+        if (mask) {
+          return i + _tzcnt_u32(mask);
+        }
+      }
+      return i + scalar::skip_comment(p + i, n - i);
+    }
+
+    AVX2 static size_t skip_string(const char *p, size_t n, char quote) {
+      size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)),
+                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\xff')));
+        uint32_t mask = _mm256_movemask_epi8(hit);
+        if (mask) {
+          return i + _tzcnt_u32(mask);
+        }
+      }
+      return i + scalar::skip_string(p + i, n - i, quote);
+    }
+
+    AVX2 static size_t count_lf(const char *p, size_t n) {
+      const __m256i lf = _mm256_set1_epi8('\n');
+      size_t i = 0, count = 0;
+      for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf)));
+      }
+      return count + scalar::count_lf(p + i, n - i);
+    }
+
+#undef AVX2
+  }  // namespace avx2
+  /// END:   AVX2 KERNELS
+  ///============================================================================///
+#endif
+
+  struct Kernels {
+    size_t (*skip_ws)(const char *, size_t);
+    size_t (*skip_ident)(const char *, size_t);
+    size_t (*skip_comment)(const char *, size_t);
+    size_t (*skip_string)(const char *, size_t, char);
+    size_t (*count_lf)(const char *, size_t);
+    const char *name;
+  };
+
+  static const Kernels g_kernels = []() -> Kernels {
+#if QLEX_SCAN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+      return {avx2::skip_ws,     avx2::skip_ident, avx2::skip_comment,
+              avx2::skip_string, avx2::count_lf,   "avx2"};
+    }
+
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+      return {sse42::skip_ws,     sse42::skip_ident, sse42::skip_comment,
+              sse42::skip_string, sse42::count_lf,   "sse4.2"};
+    }
+#endif
+
+    return {scalar::skip_ws,     scalar::skip_ident, scalar::skip_comment,
+            scalar::skip_string, scalar::count_lf,   "scalar"};
+  }();
+
+  size_t skip_ws(const char *p, size_t n) { return g_kernels.skip_ws(p, n); }
+  size_t skip_ident(const char *p, size_t n) { return g_kernels.skip_ident(p, n); }
+  size_t skip_comment(const char *p, size_t n) { return g_kernels.skip_comment(p, n); }
+  size_t skip_string(const char *p, size_t n, char q) { return g_kernels.skip_string(p, n, q); }
+  size_t count_lf(const char *p, size_t n) { return g_kernels.count_lf(p, n); }
+  const char *isa() { return g_kernels.name; }
+}  // namespace qlex::scan
@@ -0,0 +1,538 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#define __QUIX_LEXER_IMPL__
+
+#include <fcntl.h>
+#include <quix-core/Cache.h>
+#include <quix-core/Error.h>
+#include <quix-lexer/Lexer.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <quix-lexer/Base.hh>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LibMacro.h"
+
+///============================================================================///
+/// BEGIN: TOKEN CACHE IMAGES
+///
+/// An image holds everything needed to hand out the tokens of a source again
+/// without lexing it: the tokens, the lexer's location tables and the strings
+/// the tokens refer to. All fields are native-endian; the byte order mark
+/// rejects images from a foreign machine. The sections follow the header in
+/// this order, each a flat array of 32-bit words:
+///
+///   tokens   `tok_count` records of {type, value, start tag, end tag}
+///   locs     source offset of each location tag, starting at tag 1
+///   rcs      {tag, row, col} for the locations whose row and column differ
+///            from what the line table gives, ordered by tag
+///   lines    offset of every '\n' in the source
+///   strings  length of each string, followed by the concatenated bytes
+///
+/// String payloads are indices into the image's string table, which holds
+/// distinct, non-empty strings. Interning them in order into a fresh table
+/// reproduces the same indices, so tokens are served without translation.
+/// Payloads that are not indices (inline integers, the empty string) are
+/// stored as they are.
+
+namespace {
+  constexpr char IMAGE_MAGIC[8] = {'Q', 'L', 'E', 'X', 'T', 'O', 'K', '\0'};
+  constexpr uint32_t IMAGE_VERSION = 1;
+  constexpr uint32_t IMAGE_BYTE_ORDER = 0x01020304;
+
+  struct image_hdr_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint8_t digest[20];
+    uint32_t reserved;
+    uint64_t source_size;
+    uint64_t tok_count;
+    uint64_t loc_count;
+    uint64_t rc_count;
+    uint64_t line_count;
+    uint64_t str_count;
+    uint64_t str_bytes;
+  };
+
+  struct image_tok_t {
+    uint32_t ty;
+    uint32_t v;
+    uint32_t start;
+    uint32_t end;
+  };
+
+  struct image_rc_t {
+    uint32_t tag;
+    uint32_t row;
+    uint32_t col;
+  };
+
+  static_assert(sizeof(image_hdr_t) % 8 == 0);
+
+  bool has_string(qlex_ty_t ty) {
+    switch (ty) {
+      case qEofF:
+      case qErro:
+      case qKeyW:
+      case qOper:
+      case qPunc:
+        return false;
+      default:
+        return true;
+    }
+  }
+
+  bool is_string_index(qlex_size idx) { return idx != UINT32_MAX && !(idx & QLEX_INT_INLINE); }
+
+  /* Reads a `T` at `*pos` and advances past it */
+  template <typename T>
+  T take(const uint8_t *&pos) {
+    T x;
+    memcpy(&x, pos, sizeof(T));
+    pos += sizeof(T);
+    return x;
+  }
+}  // namespace
+
+struct qlex_replay_t final : public qlex_t {
+  const uint8_t *m_image;
+  bool m_image_owned;
+
+  const uint8_t *m_tok_cur;
+  const uint8_t *m_tok_end;
+  qlex_tok_t m_eof;
+
+  static bool dump(qlex_t *L, const uint8_t digest[20], std::string &out);
+
+  bool load(const void *image, size_t size, const uint8_t digest[20]);
+
+  virtual qlex_tok_t next_impl() override {
+    if (m_tok_cur == m_tok_end) [[unlikely]] {
+      return m_eof;
+    }
+
+    image_tok_t r = take<image_tok_t>(m_tok_cur);
+    return qlex_tok_t((qlex_ty_t)r.ty, r.v, {r.start}, {r.end});
+  }
+
+  qlex_replay_t(const char *filename, qcore_env_t env)
+      : qlex_t(nullptr, filename, false, env),
+        m_image(nullptr),
+        m_image_owned(false),
+        m_tok_cur(nullptr),
+        m_tok_end(nullptr) {}
+
+  virtual ~qlex_replay_t() {
+    if (m_image_owned) {
+      free((void *)m_image);
+    }
+  }
+};
+
+bool qlex_replay_t::dump(qlex_t *L, const uint8_t digest[20], std::string &out) {
+  struct loc_t {
+    qlex_size off;
+    qlex_size row;
+    qlex_size col;
+  };
+
+  std::vector<image_tok_t> toks;
+  std::vector<loc_t> locs;
+  std::unordered_map<qlex_size, qlex_size> loc_map, str_map;
+  std::vector<std::string_view> strs;
+  size_t str_bytes = 0;
+
+  /* Consecutive tokens mostly share their boundary tag */
+  qlex_size last_tag = 0, last_mapped = 0;
+
+  auto map_loc = [&](qlex_loc_t loc) -> qlex_size {
+    if (loc.tag == 0) {
+      return 0;
+    } else if (loc.tag == last_tag) {
+      return last_mapped;
+    }
+
+    auto [it, inserted] = loc_map.try_emplace(loc.tag, 0);
+    if (inserted) {
+      auto rc = L->loc2rowcol(loc);
+      if (rc && locs.size() < MAX_LOC_TAG) {
+        locs.push_back({L->loc2offset(loc).value_or(UINT32_MAX), rc->first, rc->second});
+        it->second = locs.size();
+      }
+    }
+
+    last_tag = loc.tag;
+    return last_mapped = it->second;
+  };
+
+  /* The image keeps comments; the replaying lexer applies its own flags */
+  qlex_flags_t flags = L->m_flags;
+  L->m_flags &= ~QLEX_NO_COMMENTS;
+
+  qlex_tok_t tok;
+  do {
+    tok = L->next();
+
+    image_tok_t r{(uint32_t)tok.ty, 0, map_loc(tok.start), map_loc(tok.end)};
+
+    switch (tok.ty) {
+      case qKeyW:
+        r.v = tok.v.key;
+        break;
+      case qOper:
+        r.v = tok.v.op;
+        break;
+      case qPunc:
+        r.v = tok.v.punc;
+        break;
+      default:
+        if (has_string(tok.ty)) {
+          r.v = tok.v.str_idx;
+        }
+        break;
+    }
+
+    if (has_string(tok.ty) && is_string_index(r.v)) {
+      auto [it, inserted] = str_map.try_emplace(r.v, UINT32_MAX);
+      if (inserted) {
+        std::string_view str = L->get_string(r.v);
+        if (!str.empty()) {
+          it->second = strs.size();
+          strs.push_back(str);
+          str_bytes += str.size();
+        }
+      }
+
+      r.v = it->second;
+    }
+
+    toks.push_back(r);
+  } while (tok.ty != qEofF);
+
+  L->m_flags = flags;
+
+  /* Only now is the line table known to cover every location */
+  if (L->m_src.data() && L->m_lines_scanned < L->m_src.size()) {
+    L->index_lines(L->m_src.data() + L->m_lines_scanned, L->m_src.size() - L->m_lines_scanned);
+  }
+
+  const auto &lines = L->m_lines;
+  std::vector<image_rc_t> rcs;
+
+  for (size_t i = 0; i < locs.size(); i++) {
+    const loc_t &l = locs[i];
+    qlex_size row = 1, col = 0;
+
+    /* Same derivation as `qlex_t::loc2rowcol` */
+    if (l.off != UINT32_MAX) {
+      size_t n = std::lower_bound(lines.begin(), lines.end(), l.off) - lines.begin();
+      row = n + 1;
+      col = n ? l.off - lines[n - 1] : l.off + 1;
+    }
+
+    if (row != l.row || col != l.col) {
+      rcs.push_back({(uint32_t)(i + 1), l.row, l.col});
+    }
+  }
+
+  image_hdr_t hdr{};
+  memcpy(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic));
+  hdr.version = IMAGE_VERSION;
+  hdr.byte_order = IMAGE_BYTE_ORDER;
+  memcpy(hdr.digest, digest, sizeof(hdr.digest));
+  hdr.source_size = L->m_lines_scanned;
+  hdr.tok_count = toks.size();
+  hdr.loc_count = locs.size();
+  hdr.rc_count = rcs.size();
+  hdr.line_count = lines.size();
+  hdr.str_count = strs.size();
+  hdr.str_bytes = str_bytes;
+
+  out.clear();
+  out.reserve(sizeof(hdr) + toks.size() * sizeof(image_tok_t) + locs.size() * 4 +
+              rcs.size() * sizeof(image_rc_t) + lines.size() * 4 + strs.size() * 4 + str_bytes);
+
+  auto put = [&out](const void *p, size_t n) { out.append((const char *)p, n); };
+
+  put(&hdr, sizeof(hdr));
+  put(toks.data(), toks.size() * sizeof(image_tok_t));
+  for (const auto &l : locs) {
+    put(&l.off, sizeof(l.off));
+  }
+  put(rcs.data(), rcs.size() * sizeof(image_rc_t));
+  put(lines.data(), lines.size() * sizeof(qlex_size));
+  for (auto str : strs) {
+    uint32_t len = str.size();
+    put(&len, sizeof(len));
+  }
+  for (auto str : strs) {
+    put(str.data(), str.size());
+  }
+
+  return true;
+}
+
+bool qlex_replay_t::load(const void *image, size_t size, const uint8_t digest[20]) {
+  const uint8_t *pos = (const uint8_t *)image, *end = pos + size;
+
+  if (size < sizeof(image_hdr_t)) {
+    return false;
+  }
+
+  image_hdr_t hdr = take<image_hdr_t>(pos);
+
+  if (memcmp(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != IMAGE_VERSION ||
+      hdr.byte_order != IMAGE_BYTE_ORDER) {
+    return false;
+  }
+
+  if (digest && memcmp(hdr.digest, digest, sizeof(hdr.digest)) != 0) {
+    return false;
+  }
+
+  /* Claims one section of `count` elements, checking it fits the image */
+  auto claim = [&](uint64_t count, size_t elem) -> const uint8_t * {
+    if (count > (uint64_t)(end - pos) / elem) {
+      return nullptr;
+    }
+
+    const uint8_t *p = pos;
+    pos += count * elem;
+    return p;
+  };
+
+  const uint8_t *toks = claim(hdr.tok_count, sizeof(image_tok_t));
+  const uint8_t *locs = toks ? claim(hdr.loc_count, sizeof(qlex_size)) : nullptr;
+  const uint8_t *rcs = locs ? claim(hdr.rc_count, sizeof(image_rc_t)) : nullptr;
+  const uint8_t *lines = rcs ? claim(hdr.line_count, sizeof(qlex_size)) : nullptr;
+  const uint8_t *lens = lines ? claim(hdr.str_count, sizeof(uint32_t)) : nullptr;
+  const uint8_t *strs = lens ? claim(hdr.str_bytes, 1) : nullptr;
+
+  if (!strs || pos != end || hdr.tok_count == 0 || hdr.loc_count > MAX_LOC_TAG ||
+      hdr.str_count > QLEX_INT_INLINE - 1) {
+    return false;
+  }
+
+  { /* Tokens must refer to existing locations and strings */
+    const uint8_t *p = toks;
+    image_tok_t r{};
+
+    for (uint64_t i = 0; i < hdr.tok_count; i++) {
+      r = take<image_tok_t>(p);
+
+      if (r.ty < qEofF || r.ty > qNote || r.start > hdr.loc_count || r.end > hdr.loc_count) {
+        return false;
+      }
+
+      if (has_string((qlex_ty_t)r.ty) && is_string_index(r.v) && r.v >= hdr.str_count) {
+        return false;
+      }
+    }
+
+    if (r.ty != qEofF) {
+      return false;
+    }
+
+    m_eof = qlex_tok_t::eof({r.start}, {r.end});
+  }
+
+  /* An empty vector's data() may be null, which memcpy() must not be given */
+  m_loc_off.resize(hdr.loc_count);
+  if (hdr.loc_count) {
+    memcpy(m_loc_off.data(), locs, hdr.loc_count * sizeof(qlex_size));
+  }
+
+  m_loc_rc.resize(hdr.rc_count);
+  for (uint64_t i = 0; i < hdr.rc_count; i++) {
+    image_rc_t rc = take<image_rc_t>(rcs);
+    if (rc.tag == 0 || rc.tag > hdr.loc_count || (i && rc.tag <= m_loc_rc[i - 1].tag)) {
+      return false;
+    }
+
+    m_loc_rc[i] = {rc.tag, rc.row, rc.col};
+  }
+
+  m_lines.resize(hdr.line_count);
+  if (hdr.line_count) {
+    memcpy(m_lines.data(), lines, hdr.line_count * sizeof(qlex_size));
+  }
+  m_lines_scanned = hdr.source_size;
+
+  { /* Rebuild the string table with the same indices */
+    const uint8_t *str_end = strs + hdr.str_bytes;
+
+    for (uint64_t i = 0; i < hdr.str_count; i++) {
+      uint32_t len = take<uint32_t>(lens);
+      if (len == 0 || len > (size_t)(str_end - strs)) {
+        return false;
+      }
+
+      if (m_strings->intern(std::string_view((const char *)strs, len)) != i) {
+        return false;
+      }
+
+      strs += len;
+    }
+
+    if (strs != str_end) {
+      return false;
+    }
+  }
+
+  m_image = (const uint8_t *)image;
+  m_tok_cur = toks;
+  m_tok_end = toks + hdr.tok_count * sizeof(image_tok_t);
+
+  return true;
+}
+
+LIB_EXPORT void *qlex_cache_dump(qlex_t *lexer, const uint8_t digest[20], size_t *size) {
+  try {
+    std::string image;
+    if (!qlex_replay_t::dump(lexer, digest, image)) {
+      return nullptr;
+    }
+
+    void *buf = malloc(image.size());
+    if (!buf) {
+      return nullptr;
+    }
+
+    memcpy(buf, image.data(), image.size());
+    *size = image.size();
+
+    return buf;
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  } catch (...) {
+    qcore_panic("qlex_cache_dump: failed to serialize tokens");
+  }
+}
+
+LIB_EXPORT qlex_t *qlex_new_replay(const void *image, size_t size, bool is_owned,
+                                   const uint8_t digest[20], const char *filename,
+                                   qcore_env_t env) {
+  try {
+    auto obj = std::make_unique<qlex_replay_t>(filename, env);
+    if (!obj->load(image, size, digest)) {
+      return nullptr;
+    }
+
+    obj->m_image_owned = is_owned;
+
+    return obj.release();
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+LIB_EXPORT qlex_t *qlex_new_replay_mapped(const char *path, const uint8_t digest[20],
+                                          qcore_env_t env) {
+  try {
+    int fd;
+    struct stat st;
+    void *base;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+      return nullptr;
+    }
+
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+
+    base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+      return nullptr;
+    }
+
+    auto obj = std::make_unique<qlex_replay_t>(path, env);
+    obj->m_map_base = base;
+    obj->m_map_size = st.st_size;
+
+    if (!obj->load(base, st.st_size, digest)) {
+      return nullptr;
+    }
+
+    return obj.release();
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+LIB_EXPORT qlex_t *qlex_cache_load(const qcore_cache_key_t *key, const char *filename,
+                                   qcore_env_t env) {
+  if (!qcore_cache_bound()) {
+    return nullptr;
+  }
+
+  int64_t size = qcore_cache_has(key);
+  if (size < (int64_t)sizeof(image_hdr_t)) {
+    return nullptr;
+  }
+
+  void *image = malloc(size);
+  if (!image) {
+    return nullptr;
+  }
+
+  qlex_t *obj = nullptr;
+  if (qcore_cache_read(key, image, size)) {
+    obj = qlex_new_replay(image, size, true, key->key, filename, env);
+  }
+
+  if (!obj) {
+    free(image);
+  }
+
+  return obj;
+}
+
+/// END:   TOKEN CACHE IMAGES
+///============================================================================///
@@ -0,0 +1,37 @@
+#ifndef __QUIX_LEXER_TESTS_COUNTED_ALLOC_HH__
+#define __QUIX_LEXER_TESTS_COUNTED_ALLOC_HH__
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+///============================================================================///
+/// Allocation accounting. Every operator new made while `g_counting` is set is
+/// tallied, including the ones made inside the libraries. Including this header
+/// replaces the global operator new, so only the file holding main() may.
+
+inline std::atomic<bool> g_counting{false};
+inline std::atomic<size_t> g_allocs{0};
+inline std::atomic<size_t> g_alloc_bytes{0};
+
+inline void *counted_alloc(size_t size) {
+  if (g_counting.load(std::memory_order_relaxed)) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+
+  if (void *p = malloc(size ? size : 1)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#endif  // __QUIX_LEXER_TESTS_COUNTED_ALLOC_HH__
@@ -0,0 +1,106 @@
+#ifndef __QUIX_LEXER_TESTS_FIXTURES_HH__
+#define __QUIX_LEXER_TESTS_FIXTURES_HH__
+
+#include <quix-core/Cache.h>
+#include <quix-lexer/Lexer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+///============================================================================///
+/// Token comparison. Location tags and string indices are opaque handles whose
+/// numbering depends on lexing order, so tokens are compared by content and
+/// resolved position.
+
+struct TokInfo {
+  qlex_ty_t ty;
+  uint32_t payload;
+  std::string str;
+  qlex_size sl, sc, el, ec;
+
+  bool operator==(const TokInfo &o) const {
+    return ty == o.ty && payload == o.payload && str == o.str && sl == o.sl && sc == o.sc &&
+           el == o.el && ec == o.ec;
+  }
+};
+
+inline TokInfo describe(qlex_t *lexer, qlex_tok_t tok) {
+  TokInfo info{};
+  info.ty = tok.ty;
+
+  switch (tok.ty) {
+    case qEofF:
+      return info;
+    case qKeyW:
+      info.payload = tok.v.key;
+      break;
+    case qOper:
+      info.payload = tok.v.op;
+      break;
+    case qPunc:
+      info.payload = tok.v.punc;
+      break;
+    case qErro:
+      break;
+    default: {
+      size_t len;
+      const char *s = qlex_str(lexer, &tok, &len);
+      info.str = std::string(s, len);
+      break;
+    }
+  }
+
+  info.sl = qlex_line(lexer, tok.start);
+  info.sc = qlex_col(lexer, tok.start);
+  info.el = qlex_line(lexer, tok.end);
+  info.ec = qlex_col(lexer, tok.end);
+
+  return info;
+}
+
+/* Every token up to the end of the input, not including the end marker */
+inline std::vector<TokInfo> collect(qlex_t *lexer) {
+  std::vector<TokInfo> toks;
+
+  qlex_tok_t tok;
+  while ((tok = qlex_next(lexer)).ty != qEofF) {
+    toks.push_back(describe(lexer, tok));
+  }
+
+  return toks;
+}
+
+///============================================================================///
+/// In-memory cache provider, for binding with `qcore_cache_bind()`. Entries
+/// live in `g_cache` by key, so tests can count or drop them.
+
+inline std::map<std::string, std::string> g_cache;
+
+inline std::string cache_name(const qcore_cache_key_t *key) {
+  return std::string((const char *)key->key, sizeof(key->key));
+}
+
+inline int64_t cache_has(const qcore_cache_key_t *key) {
+  auto it = g_cache.find(cache_name(key));
+  return it == g_cache.end() ? -1 : (int64_t)it->second.size();
+}
+
+inline bool cache_read(const qcore_cache_key_t *key, void *payload, size_t size) {
+  auto it = g_cache.find(cache_name(key));
+  if (it == g_cache.end()) {
+    return false;
+  }
+
+  memcpy(payload, it->second.data(), std::min(size, it->second.size()));
+  return true;
+}
+
+inline bool cache_write(const qcore_cache_key_t *key, const void *payload, size_t size) {
+  g_cache[cache_name(key)] = std::string((const char *)payload, size);
+  return true;
+}
+
+#endif  // __QUIX_LEXER_TESTS_FIXTURES_HH__
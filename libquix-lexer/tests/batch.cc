@@ -0,0 +1,117 @@
+#include <quix-lexer/Lib.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-lexer/Classes.hh>
+#include <string_view>
+#include <vector>
+
+using timepoint_t = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+static constexpr size_t BATCH_SIZE = 1024;
+
+enum class Mode { Single, Batch, Stream };
+
+/* Lex the whole file in the given mode. Returns the token count; `checksum`
+ * folds in every token so that no mode can skip work. */
+static size_t consume(qlex_t *lexer, Mode mode, uint64_t &checksum) {
+  size_t count = 0;
+
+  switch (mode) {
+    case Mode::Single: {
+      qlex_tok_t tok;
+      while ((tok = qlex_next(lexer)).ty != qEofF) {
+        checksum += tok.ty + tok.start.tag;
+        count++;
+      }
+      break;
+    }
+
+    case Mode::Batch: {
+      std::vector<qlex_tok_t> batch(BATCH_SIZE);
+      bool eof = false;
+      while (!eof) {
+        size_t n = qlex_next_batch(lexer, batch.data(), batch.size());
+        for (size_t i = 0; i < n; i++) {
+          if (batch[i].ty == qEofF) {
+            eof = true;
+            break;
+          }
+          checksum += batch[i].ty + batch[i].start.tag;
+          count++;
+        }
+      }
+      break;
+    }
+
+    case Mode::Stream: {
+      qlex_stream_t *stream = qlex_stream_new(BATCH_SIZE);
+      bool eof = false;
+      while (!eof) {
+        size_t n = qlex_stream_fill(lexer, stream);
+        for (size_t i = 0; i < n; i++) {
+          if (stream->ty[i] == qEofF) {
+            eof = true;
+            break;
+          }
+          checksum += stream->ty[i] + stream->start[i].tag;
+          count++;
+        }
+      }
+      qlex_stream_free(stream);
+      break;
+    }
+  }
+
+  return count;
+}
+
+static void do_benchmark(const char *path, Mode mode, const char *name) {
+  qcore_env env;
+  qlex_t *lexer = qlex_new_mapped(path, env.get());
+  if (!lexer) {
+    std::cerr << "Failed to create lexer" << std::endl;
+    return;
+  }
+
+  uint64_t checksum = 0;
+
+  timepoint_t start = std::chrono::high_resolution_clock::now();
+  size_t count = consume(lexer, mode, checksum);
+  timepoint_t end = std::chrono::high_resolution_clock::now();
+
+  qlex_free(lexer);
+
+  std::chrono::nanoseconds elapsed = end - start;
+  std::cout << name << ": " << count << " tokens, " << elapsed.count() << " ns, "
+            << elapsed.count() / (double)(count ? count : 1) << " ns/token (checksum "
+            << checksum << ")" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+
+  std::vector<std::string_view> args(argv, argv + argc);
+
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << args[0] << " <input-file> [rounds]" << std::endl;
+    return 1;
+  }
+
+  if (!std::filesystem::exists(args[1])) {
+    std::cerr << "File not found: " << args[1] << std::endl;
+    return 1;
+  }
+
+  int rounds = args.size() > 2 ? std::stoi(std::string(args[2])) : 3;
+
+  for (int i = 0; i < rounds; i++) {
+    do_benchmark(args[1].data(), Mode::Single, "qlex_next       ");
+    do_benchmark(args[1].data(), Mode::Batch, "qlex_next_batch ");
+    do_benchmark(args[1].data(), Mode::Stream, "qlex_stream_fill");
+  }
+
+  qlex_lib_deinit();
+}
@@ -1,88 +1,335 @@
 #include <quix-lexer/Lib.h>
 
+#include "CountedAlloc.hh"
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <quix-core/Classes.hh>
 #include <quix-lexer/Classes.hh>
+#include <sstream>
+#include <string>
 #include <vector>
 
 using timepoint_t = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
-void print_results(timepoint_t start, timepoint_t end, size_t size, size_t tok_count) {
-  std::chrono::nanoseconds elapsed = end - start;
-  std::cout << "Elapsed time: " << elapsed.count() << " ns" << std::endl;
-  std::cout << "File size: " << size << " bytes" << std::endl;
-  std::cout << "Token count: " << tok_count << std::endl;
+///============================================================================///
+/// Peak resident set size. Writing 5 to clear_refs resets the high water mark,
+/// so each file gets its own peak rather than the process-wide one.
+
+static void reset_peak_rss() { std::ofstream("/proc/self/clear_refs") << "5"; }
+
+static size_t peak_rss_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+
+  while (std::getline(status, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) {
+      return std::stoul(line.substr(6));
+    }
+  }
+
+  return 0;
+}
+
+///============================================================================///
+
+struct ClassStats {
+  size_t count = 0;
+  size_t bytes = 0;
+  double ns = 0;
+};
+
+struct Result {
+  std::string name;
+  size_t size = 0;
+  size_t tok_count = 0;
+  double best_ns = 0;
+  size_t peak_rss_kb = 0;
+  size_t allocs = 0;
+  size_t alloc_bytes = 0;
+  std::array<ClassStats, 16> classes;
+};
+
+static qlex_t *open_lexer(const std::string &path, FILE *file, bool mapped, qcore_env_t env) {
+  fseek(file, 0, SEEK_SET);
+  return mapped ? qlex_new_mapped(path.c_str(), env) : qlex_new(file, nullptr, env);
+}
+
+static bool lex_once(const std::string &path, FILE *file, bool mapped, size_t &tok_count) {
+  qcore_env env;
+  qlex_t *lexer = open_lexer(path, file, mapped, env.get());
+  if (!lexer) {
+    std::cerr << "Failed to create lexer" << std::endl;
+    return false;
+  }
+
+  tok_count = 0;
+
+  qlex_tok_t tok;
+  while ((tok = qlex_next(lexer)).ty != qEofF) {
+    ++tok_count;
+  }
+
+  qlex_free(lexer);
+
+  return true;
+}
+
+/* Cost of the two clock reads bracketing each token in the class breakdown */
+static double timer_overhead_ns() {
+  constexpr size_t N = 100000;
+
+  timepoint_t start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N; i++) {
+    (void)std::chrono::high_resolution_clock::now();
+  }
+  timepoint_t end = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration<double, std::nano>(end - start).count() / N;
+}
+
+static bool class_breakdown(const std::string &path, FILE *file, bool mapped, Result &r) {
+  double overhead = timer_overhead_ns();
+
+  qcore_env env;
+  qlex_t *lexer = open_lexer(path, file, mapped, env.get());
+  if (!lexer) {
+    std::cerr << "Failed to create lexer" << std::endl;
+    return false;
+  }
+
+  while (true) {
+    timepoint_t start = std::chrono::high_resolution_clock::now();
+    qlex_tok_t tok = qlex_next(lexer);
+    timepoint_t end = std::chrono::high_resolution_clock::now();
+
+    if (tok.ty == qEofF) {
+      break;
+    }
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    ClassStats &s = r.classes[tok.ty];
+    s.count++;
+    s.bytes += qlex_span(lexer, tok.start, tok.end);
+    s.ns += std::max(0.0, ns - overhead);
+  }
+
+  qlex_free(lexer);
 
-  if (tok_count == 0) {
+  return true;
+}
+
+static bool measure_memory(const std::string &path, FILE *file, bool mapped, Result &r) {
+  fseek(file, 0, SEEK_END);
+  r.name = std::filesystem::path(path).filename().string();
+  r.size = ftell(file);
+
+  reset_peak_rss();
+  g_allocs = g_alloc_bytes = 0;
+  g_counting = true;
+  bool ok = lex_once(path, file, mapped, r.tok_count);
+  g_counting = false;
+  r.allocs = g_allocs;
+  r.alloc_bytes = g_alloc_bytes;
+  r.peak_rss_kb = peak_rss_kb();
+
+  return ok;
+}
+
+static bool measure_time(const std::string &path, FILE *file, bool mapped, Result &r) {
+  size_t tok_count;
+
+  timepoint_t start = std::chrono::high_resolution_clock::now();
+  bool ok = lex_once(path, file, mapped, tok_count);
+  timepoint_t end = std::chrono::high_resolution_clock::now();
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  r.best_ns = r.best_ns == 0 ? ns : std::min(r.best_ns, ns);
+
+  return ok;
+}
+
+/* The timed runs cycle through all files rather than repeating one file back
+ * to back, so that the best time of each is taken over a longer stretch and
+ * short bursts of load on the machine skew fewer of them. */
+static bool do_benchmark(const std::vector<std::string> &paths, bool mapped, size_t iterations,
+                         std::vector<Result> &results) {
+  std::vector<FILE *> files;
+  bool ok = true;
+
+  for (const auto &path : paths) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file) {
+      std::cerr << "Failed to open file: " << path << std::endl;
+      ok = false;
+      break;
+    }
+
+    files.push_back(file);
+  }
+
+  results.resize(files.size());
+
+  /* Memory is measured on a run of its own, the first over each file */
+  for (size_t f = 0; ok && f < files.size(); f++) {
+    ok &= measure_memory(paths[f], files[f], mapped, results[f]);
+  }
+
+  for (size_t i = 0; ok && i < iterations; i++) {
+    for (size_t f = 0; ok && f < files.size(); f++) {
+      ok &= measure_time(paths[f], files[f], mapped, results[f]);
+    }
+  }
+
+  for (size_t f = 0; ok && f < files.size(); f++) {
+    ok &= class_breakdown(paths[f], files[f], mapped, results[f]);
+  }
+
+  for (FILE *file : files) {
+    fclose(file);
+  }
+
+  return ok;
+}
+
+static double per(double x, size_t n) { return n ? x / n : 0.0; }
+
+void print_results(const Result &r) {
+  std::cout << "File: " << r.name << std::endl;
+  std::cout << "Elapsed time: " << (size_t)r.best_ns << " ns" << std::endl;
+  std::cout << "File size: " << r.size << " bytes" << std::endl;
+  std::cout << "Token count: " << r.tok_count << std::endl;
+
+  if (r.tok_count == 0) {
     std::cout << "No tokens found" << std::endl;
     return;
   }
 
-  double tokens_per_sec = tok_count / (elapsed.count() / 1e9);
-  std::cout << "Tokens per second: " << tokens_per_sec << std::endl;
+  std::cout << "Tokens per second: " << r.tok_count / (r.best_ns / 1e9) << std::endl;
+  std::cout << "MB/s: " << r.size / (r.best_ns / 1e9) / 1e6 << std::endl;
+  std::cout << "ns per token: " << per(r.best_ns, r.tok_count) << std::endl;
+  std::cout << "Average token size: " << per(r.size, r.tok_count) << " bytes" << std::endl;
+  std::cout << "ns per byte: " << per(r.best_ns, r.size) << std::endl;
+  std::cout << "Peak RSS: " << r.peak_rss_kb << " KiB" << std::endl;
+  std::cout << "Allocations per token: " << per(r.allocs, r.tok_count) << " ("
+            << per(r.alloc_bytes, r.tok_count) << " bytes)" << std::endl;
 
-  double mbps = size / (elapsed.count() / 1e9) / 1e6;
-  std::cout << "MB/s: " << mbps << std::endl;
+  std::cout << std::endl << "Per token class:" << std::endl;
+  std::cout << std::left << std::setw(8) << "class" << std::right << std::setw(12) << "count"
+            << std::setw(14) << "bytes" << std::setw(12) << "ns/token" << std::setw(12)
+            << "ns/byte" << std::endl;
 
-  double ns_per_tok = elapsed.count() / (double)tok_count;
-  std::cout << "ns per token: " << ns_per_tok << std::endl;
+  for (size_t i = 0; i < r.classes.size(); i++) {
+    const ClassStats &s = r.classes[i];
+    if (s.count == 0) {
+      continue;
+    }
 
-  double avg_tok_size = size / (double)tok_count;
-  std::cout << "Average token size: " << avg_tok_size << " bytes" << std::endl;
+    std::cout << std::left << std::setw(8) << qlex_ty_str((qlex_ty_t)i) << std::right
+              << std::setw(12) << s.count << std::setw(14) << s.bytes << std::setw(12)
+              << std::fixed << std::setprecision(2) << per(s.ns, s.count) << std::setw(12)
+              << per(s.ns, s.bytes) << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
 
-  double ns_per_byte = elapsed.count() / (double)size;
-  std::cout << "ns per byte: " << ns_per_byte << std::endl;
+  std::cout << std::endl;
 }
 
-void do_benchmark(FILE *file) {
-  fseek(file, 0, SEEK_END);
-  size_t size = ftell(file);
-  fseek(file, 0, SEEK_SET);
+void print_json(const std::vector<Result> &results, bool mapped, size_t iterations) {
+  std::ostringstream o;
+  o << std::fixed << std::setprecision(3);
 
-  timepoint_t start, end;
-  size_t tok_count = 0;
+  o << "{\n  \"lexer\": \"" << qlex_lib_version() << "\",\n";
+  o << "  \"mode\": \"" << (mapped ? "mapped" : "stream") << "\",\n";
+  o << "  \"iterations\": " << iterations << ",\n";
+  o << "  \"results\": [";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
 
-  start = std::chrono::high_resolution_clock::now();
-  {
-    qcore_env env;
-    qlex lexer(file, nullptr, env.get());
+    o << (i ? "," : "") << "\n    {\n";
+    o << "      \"file\": \"" << r.name << "\",\n";
+    o << "      \"bytes\": " << r.size << ",\n";
+    o << "      \"tokens\": " << r.tok_count << ",\n";
+    o << "      \"ns_per_token\": " << per(r.best_ns, r.tok_count) << ",\n";
+    o << "      \"ns_per_byte\": " << per(r.best_ns, r.size) << ",\n";
+    o << "      \"peak_rss_kb\": " << r.peak_rss_kb << ",\n";
+    o << "      \"allocs_per_token\": " << per(r.allocs, r.tok_count) << ",\n";
+    o << "      \"alloc_bytes_per_token\": " << per(r.alloc_bytes, r.tok_count) << ",\n";
+    o << "      \"classes\": {";
 
-    qlex_tok_t tok;
-    while ((tok = qlex_next(lexer.get())).ty != qEofF) {
-      ++tok_count;
+    bool first = true;
+    for (size_t c = 0; c < r.classes.size(); c++) {
+      const ClassStats &s = r.classes[c];
+      if (s.count == 0) {
+        continue;
+      }
+
+      o << (first ? "" : ",") << "\n        \"" << qlex_ty_str((qlex_ty_t)c) << "\": {"
+        << "\"count\": " << s.count << ", \"bytes\": " << s.bytes
+        << ", \"ns_per_token\": " << per(s.ns, s.count) << "}";
+      first = false;
     }
+
+    o << "\n      }\n    }";
   }
-  end = std::chrono::high_resolution_clock::now();
 
-  print_results(start, end, size, tok_count);
+  o << "\n  ]\n}\n";
+
+  std::cout << o.str();
 }
 
 int main(int argc, char **argv) {
   qlex_lib_init();
 
   std::vector<std::string_view> args(argv, argv + argc);
+  std::vector<std::string> files;
+  bool mapped = false, json = false;
+  size_t iterations = 5;
 
-  if (args.size() < 2) {
-    std::cerr << "Usage: " << args[0] << " <input-file>" << std::endl;
-    return 1;
+  for (size_t i = 1; i < args.size(); i++) {
+    if (args[i] == "--mapped") {
+      mapped = true;
+    } else if (args[i] == "--json") {
+      json = true;
+    } else if (args[i] == "--iterations" && i + 1 < args.size()) {
+      iterations = std::max(1, atoi(args[++i].data()));
+    } else {
+      files.emplace_back(args[i]);
+    }
   }
 
-  if (!std::filesystem::exists(args[1])) {
-    std::cerr << "File not found: " << args[1] << std::endl;
+  if (files.empty()) {
+    std::cerr << "Usage: " << args[0] << " <input-file>... [--mapped] [--json] [--iterations N]"
+              << std::endl;
     return 1;
   }
 
-  FILE *file = fopen(args[1].data(), "r");
-  if (!file) {
-    std::cerr << "Failed to open file: " << args[1] << std::endl;
-    return 1;
+  for (const auto &path : files) {
+    if (!std::filesystem::exists(path)) {
+      std::cerr << "File not found: " << path << std::endl;
+      return 1;
+    }
   }
 
-  do_benchmark(file);
+  std::vector<Result> results;
+  if (!do_benchmark(files, mapped, iterations, results)) {
+    return 1;
+  }
 
-  fclose(file);
+  if (json) {
+    print_json(results, mapped, iterations);
+  } else {
+    for (const auto &r : results) {
+      print_results(r);
+    }
+  }
 
   qlex_lib_deinit();
-}
\ No newline at end of file
+}
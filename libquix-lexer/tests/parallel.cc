@@ -0,0 +1,157 @@
+#include <quix-lexer/Lib.h>
+
+#include "Fixtures.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-lexer/Classes.hh>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static bool compare(std::string_view name, std::string_view src, size_t threads,
+                    size_t chunk_size) {
+  qcore_env env;
+
+  qlex_t *serial = qlex_direct(src.data(), src.size(), nullptr, env.get());
+  auto expected = collect(serial);
+  qlex_free(serial);
+
+  qlex_t *parallel = qlex_direct(src.data(), src.size(), nullptr, env.get());
+  if (!qlex_lex_parallel(parallel, threads, chunk_size)) {
+    std::cerr << name << ": qlex_lex_parallel failed" << std::endl;
+    qlex_free(parallel);
+    return false;
+  }
+  auto actual = collect(parallel);
+  qlex_free(parallel);
+
+  if (expected.size() != actual.size()) {
+    std::cerr << name << " (threads=" << threads << ", chunk=" << chunk_size
+              << "): token count mismatch: " << expected.size() << " vs " << actual.size()
+              << std::endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (!(expected[i] == actual[i])) {
+      std::cerr << name << " (threads=" << threads << ", chunk=" << chunk_size
+                << "): token " << i << " differs (line " << expected[i].sl << ")" << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Source that puts strings, comments and macro blocks across chunk boundaries */
+static std::string adversarial_source(unsigned seed) {
+  std::mt19937 rng(seed);
+  std::stringstream ss;
+
+  auto line = [&]() {
+    switch (rng() % 12) {
+      case 0:
+        ss << "let x" << rng() % 100 << " = " << rng() << ";\n";
+        break;
+      case 1:
+        ss << "/* block comment\n";
+        for (unsigned i = 0, n = rng() % 400; i < n; i++) {
+          ss << "   let y = \"not a string; fn f() {}\n";
+        }
+        ss << "/* nested */ still comment */\n";
+        break;
+      case 2:
+        ss << "\"multi\nline\\n string ";
+        for (unsigned i = 0, n = rng() % 300; i < n; i++) {
+          ss << "// not a comment\n";
+        }
+        ss << "\" \"concat\"\n";
+        break;
+      case 3:
+        ss << "@(\n";
+        for (unsigned i = 0, n = rng() % 300; i < n; i++) {
+          ss << "  local v = (1 + (2)) -- \"x\n";
+        }
+        ss << ")\n";
+        break;
+      case 4:
+        ss << "fn foo(a: i32, b: [u8; 4]) -> i32 { ret a <<<= b >>> 1 ... 2; }\n";
+        break;
+      case 5:
+        ss << "1_000_.5 0x1f 0b101 1.5e10 3.14 7 -_.\n";
+        break;
+      case 6:
+        ss << "# hash comment\n~> tilde comment\n// slash comment\n";
+        break;
+      case 7:
+        ss << "'c' 'x' '\\n' \"esc \\x41 \\101 \\\" q\"\n";
+        break;
+      case 8:
+        ss << "a::b::c ns:: ::x f\"fmt {x}\" sizeof as in out\n";
+        break;
+      case 9:
+        ss << "@macro_call(1, 2)\n@single line macro\n";
+        break;
+      case 10:
+        ss << "\n\n   \t\n";
+        break;
+      default:
+        ss << "struct S { a: i32, b: f64 }; $ ` \n";
+        break;
+    }
+  };
+
+  while (ss.tellp() < 200000) {
+    line();
+  }
+
+  return ss.str();
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+
+  std::vector<std::string_view> args(argv, argv + argc);
+  bool ok = true;
+
+  for (unsigned seed = 0; seed < 8; seed++) {
+    std::string src = adversarial_source(seed);
+    std::string name = "adversarial-" + std::to_string(seed);
+
+    for (size_t chunk : {4096, 16384, 65536}) {
+      for (size_t threads : {1, 4, 8}) {
+        ok &= compare(name, src, threads, chunk);
+      }
+    }
+  }
+
+  for (size_t i = 1; i < args.size(); i++) {
+    if (!std::filesystem::exists(args[i])) {
+      std::cerr << "File not found: " << args[i] << std::endl;
+      return 1;
+    }
+
+    std::ifstream in(std::string(args[i]), std::ios::binary);
+    std::string src((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ok &= compare(args[i], src, 0, 0);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << args[i] << ": compared in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <quix-lexer/Lib.h>
+
+#include <iostream>
+#include <memory>
+#include <quix-core/Classes.hh>
+#include <quix-lexer/Base.hh>
+#include <quix-lexer/Classes.hh>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* A lexer rebound to one text after another must produce what a fresh lexer
+ * over each text would, with strings landing in the shared interner. */
+
+static std::vector<std::string> describe(qlex_t *lexer) {
+  std::vector<std::string> out;
+
+  qlex_tok_t tok;
+  while ((tok = qlex_next(lexer)).ty != qEofF) {
+    std::string s = qlex_ty_str(tok.ty);
+
+    switch (tok.ty) {
+      case qKeyW:
+        s += std::string(" ") + qlex_kwstr(tok.v.key);
+        break;
+      case qOper:
+        s += std::string(" ") + qlex_opstr(tok.v.op);
+        break;
+      case qPunc:
+        s += std::string(" ") + qlex_punctstr(tok.v.punc);
+        break;
+      case qErro:
+        break;
+      default: {
+        size_t len;
+        const char *str = qlex_str(lexer, &tok, &len);
+        s += " " + std::string(str, len);
+        break;
+      }
+    }
+
+    s += " @" + std::to_string(qlex_line(lexer, tok.start)) + ":" +
+         std::to_string(qlex_col(lexer, tok.start));
+
+    out.push_back(std::move(s));
+  }
+
+  return out;
+}
+
+int main() {
+  qlex_lib_init();
+
+  const std::vector<std::string_view> texts = {
+      "let x = 10;",
+      "",
+      "fn f(a: i32) -> i32 {\n  ret a + 1; /* done */\n}\n",
+      "\"unterminated",
+      "@(return 'x')\n@call(1, 2)",
+      "x y z",
+      std::string_view("a\0b", 3),
+      "1.5e10 0x1f 'c' // trailing",
+  };
+
+  qcore_env env;
+  bool ok = true;
+
+  std::unique_ptr<qlex_t> reused = std::make_unique<qlex_t>(std::string_view(), nullptr, env.get());
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < texts.size(); i++) {
+      qlex_t *fresh = qlex_direct(texts[i].data(), texts[i].size(), nullptr, env.get());
+      auto expected = describe(fresh);
+      qlex_free(fresh);
+
+      if (!reused->rebind(texts[i])) {
+        std::cerr << "rebind failed on an in-memory lexer" << std::endl;
+        return 1;
+      }
+
+      if (describe(reused.get()) != expected) {
+        std::cerr << "text " << i << " (pass " << pass << "): tokens differ after rebind"
+                  << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  { /* Strings are interned once across rebinds */
+    size_t before = reused->m_strings->size();
+    reused->rebind("x y z");
+    describe(reused.get());
+
+    if (reused->m_strings->size() != before) {
+      std::cerr << "rebinding re-interned known strings" << std::endl;
+      ok = false;
+    }
+  }
+
+  { /* Stream lexers cannot be rebound */
+    FILE *file = fmemopen((void *)"x", 1, "r");
+    qlex_t *streamed = qlex_new(file, nullptr, env.get());
+
+    if (streamed->rebind("y")) {
+      std::cerr << "rebind accepted a file-backed lexer" << std::endl;
+      ok = false;
+    }
+
+    qlex_free(streamed);
+    fclose(file);
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include <quix-lexer/Lib.h>
+
+#include "Fixtures.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-lexer/Classes.hh>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static std::vector<qlex_tok_t> lex_all(qlex_t *lexer) {
+  std::vector<qlex_tok_t> toks;
+  qlex_tok_t batch[512];
+
+  size_t n;
+  do {
+    n = qlex_next_batch(lexer, batch, 512);
+    toks.insert(toks.end(), batch, batch + n);
+  } while (n && toks.back().ty != qEofF);
+
+  return toks;
+}
+
+static const char *fragments[] = {
+    " ",      "\n",  "x",  "let ",  "\"",   "'",    "/*",  "*/", "//",  "#",   "~>", "@(",
+    ")",      "(",   "1",  "0x",    ".",    "_",    "-",   "<<", "=",   ">>>", ";",  "{",
+    "}",      "fn ", "::", "\\",    "@m ",  "3.14", "ab",  "\n\n", "...", "\t", "`",  "$",
+    "retif ", "in ", "as ", "// x\n", "/* y */", "\"s\" ", "'c' ", "@(a())", "0b1", "1e5",
+};
+
+static std::string base_source() {
+  return "@use \"v1.0\";\n"
+         "/* header */\n"
+         "fn main(args: [str]): i32 {\n"
+         "  let x = 10, y = 0x1f, z = 1.5e3;\n"
+         "  // line comment\n"
+         "  let s = \"hello\\nworld\" \"concat\";\n"
+         "  @(print(\"macro\"))\n"
+         "  if x << 2 >= y { ret 'c'; } else { ret x ... y; }\n"
+         "  # hash comment\n"
+         "  ~> tilde comment\n"
+         "  a::b::c = f(x, y, z) as u8;\n"
+         "}\n";
+}
+
+static bool run_edits(unsigned seed, size_t edits) {
+  std::mt19937 rng(seed);
+  qcore_env env;
+
+  std::string text;
+  for (int i = 0; i < 6; i++) {
+    text += base_source();
+  }
+
+  auto src = std::make_unique<std::string>(text);
+  qlex_t *lexer = qlex_direct(src->data(), src->size(), "relex", env.get());
+  std::vector<qlex_tok_t> toks = lex_all(lexer);
+
+  for (size_t step = 0; step < edits; step++) {
+    qlex_size offset = rng() % (src->size() + 1);
+    qlex_size removed = std::min<qlex_size>(rng() % 4 ? rng() % 3 : rng() % 40,
+                                            src->size() - offset);
+
+    std::string ins;
+    for (unsigned k = 0, nfrag = rng() % 3; k < nfrag; k++) {
+      ins += fragments[rng() % (sizeof(fragments) / sizeof(fragments[0]))];
+    }
+
+    auto edited = std::make_unique<std::string>(*src);
+    edited->replace(offset, removed, ins);
+
+    qlex_splice_t splice;
+    qlex_t *next = qlex_relex(lexer, toks.data(), toks.size(), edited->data(), edited->size(),
+                              offset, removed, ins.size(), &splice);
+    if (!next) {
+      std::cerr << "seed " << seed << " step " << step << ": qlex_relex failed" << std::endl;
+      qlex_free(lexer);
+      return false;
+    }
+
+    toks.erase(toks.begin() + splice.first, toks.begin() + splice.first + splice.removed);
+    toks.insert(toks.begin() + splice.first, splice.tokens, splice.tokens + splice.count);
+    free(splice.tokens);
+
+    qlex_free(lexer);
+    lexer = next;
+    src = std::move(edited);
+
+    qlex_t *full = qlex_direct(src->data(), src->size(), "relex", env.get());
+    std::vector<qlex_tok_t> expected = lex_all(full);
+
+    bool same = expected.size() == toks.size();
+    for (size_t i = 0; same && i < toks.size(); i++) {
+      same = describe(full, expected[i]) == describe(lexer, toks[i]);
+    }
+    qlex_free(full);
+
+    if (!same) {
+      std::cerr << "seed " << seed << " step " << step << ": relexed tokens differ after edit at "
+                << offset << " (-" << removed << " +\"" << ins << "\")" << std::endl;
+      qlex_free(lexer);
+      return false;
+    }
+  }
+
+  qlex_free(lexer);
+  return true;
+}
+
+static bool time_file(std::string_view path) {
+  std::ifstream in(std::string(path), std::ios::binary);
+  std::string src((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  qcore_env env;
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  qlex_t *lexer = qlex_direct(src.data(), src.size(), nullptr, env.get());
+  std::vector<qlex_tok_t> toks = lex_all(lexer);
+
+  /* Type one character in the middle of the file */
+  std::string edited = src;
+  qlex_size offset = edited.find('\n', edited.size() / 2) + 1;
+  edited.insert(offset, "x");
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  qlex_splice_t splice;
+  qlex_t *next = qlex_relex(lexer, toks.data(), toks.size(), edited.data(), edited.size(), offset,
+                            0, 1, &splice);
+  auto t2 = std::chrono::high_resolution_clock::now();
+
+  if (!next) {
+    std::cerr << path << ": qlex_relex failed" << std::endl;
+    qlex_free(lexer);
+    return false;
+  }
+
+  std::cout << path << ": full lex "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()
+            << " us, relex "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
+            << " us (replaced " << splice.removed << " of " << toks.size() << " tokens with "
+            << splice.count << ")" << std::endl;
+
+  free(splice.tokens);
+  qlex_free(next);
+  qlex_free(lexer);
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+
+  std::vector<std::string_view> args(argv, argv + argc);
+  bool ok = true;
+
+  for (unsigned seed = 0; seed < 64; seed++) {
+    ok &= run_edits(seed, 200);
+  }
+
+  for (size_t i = 1; i < args.size(); i++) {
+    if (!std::filesystem::exists(args[i])) {
+      std::cerr << "File not found: " << args[i] << std::endl;
+      return 1;
+    }
+
+    ok &= time_file(args[i]);
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#include <quix-lexer/Lib.h>
+
+#include "Fixtures.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-lexer/Classes.hh>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static bool same(std::string_view name, const std::vector<TokInfo> &expected,
+                 const std::vector<TokInfo> &actual) {
+  if (expected.size() != actual.size()) {
+    std::cerr << name << ": token count mismatch: " << expected.size() << " vs "
+              << actual.size() << std::endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (!(expected[i] == actual[i])) {
+      std::cerr << name << ": token " << i << " differs (line " << expected[i].sl << ")"
+                << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool check(std::string_view name, std::string_view src) {
+  qcore_env env;
+  qcore_cache_key_t key{};
+  std::string keyname = std::string(name).substr(0, sizeof(key.key));
+  memcpy(key.key, keyname.data(), keyname.size());
+
+  qlex_t *direct = qlex_direct(src.data(), src.size(), nullptr, env.get());
+  auto expected = collect(direct);
+  qlex_free(direct);
+
+  /* Dump from a stream lexer, which sees the source one window at a time */
+  FILE *file = fmemopen((void *)src.data(), src.size(), "r");
+  qlex_t *streamed = qlex_new(file, nullptr, env.get());
+  size_t size = 0;
+  void *image = qlex_cache_dump(streamed, key.key, &size);
+  qlex_free(streamed);
+  fclose(file);
+
+  if (!image) {
+    std::cerr << name << ": qlex_cache_dump failed" << std::endl;
+    return false;
+  }
+
+  bool ok = true;
+
+  { /* Replay from memory */
+    qlex_t *replay = qlex_new_replay(image, size, false, key.key, nullptr, env.get());
+    if (!replay) {
+      std::cerr << name << ": qlex_new_replay rejected its own image" << std::endl;
+      free(image);
+      return false;
+    }
+
+    ok &= same(name, expected, collect(replay));
+
+    /* Dumping a replay yields the same image */
+    qlex_t *again = qlex_new_replay(image, size, false, key.key, nullptr, env.get());
+    size_t size2 = 0;
+    void *image2 = qlex_cache_dump(again, key.key, &size2);
+    if (!image2 || size2 != size || memcmp(image, image2, size) != 0) {
+      std::cerr << name << ": image of a replay differs" << std::endl;
+      ok = false;
+    }
+    free(image2);
+    qlex_free(again);
+    qlex_free(replay);
+  }
+
+  { /* Damaged images are rejected */
+    qcore_cache_key_t other = key;
+    other.key[0] ^= 1;
+
+    if (qlex_t *bad = qlex_new_replay(image, size, false, other.key, nullptr, env.get())) {
+      std::cerr << name << ": image accepted under another digest" << std::endl;
+      qlex_free(bad);
+      ok = false;
+    }
+
+    for (size_t cut : {size_t(0), size_t(7), size / 2, size - 1}) {
+      if (qlex_t *bad = qlex_new_replay(image, cut, false, nullptr, nullptr, env.get())) {
+        std::cerr << name << ": truncated image accepted (" << cut << " bytes)" << std::endl;
+        qlex_free(bad);
+        ok = false;
+      }
+    }
+  }
+
+  { /* Replay from a mapped file */
+    auto path = std::filesystem::temp_directory_path() / "quix-lexer-tokcache.bin";
+    std::ofstream(path, std::ios::binary).write((const char *)image, size);
+
+    qlex_t *mapped = qlex_new_replay_mapped(path.c_str(), key.key, env.get());
+    if (!mapped) {
+      std::cerr << name << ": qlex_new_replay_mapped failed" << std::endl;
+      ok = false;
+    } else {
+      ok &= same(name, expected, collect(mapped));
+      qlex_free(mapped);
+    }
+
+    std::filesystem::remove(path);
+  }
+
+  { /* Round trip through the cache provider */
+    qcore_cache_bind(cache_has, cache_read, cache_write);
+
+    if (qlex_t *miss = qlex_cache_load(&key, nullptr, env.get())) {
+      std::cerr << name << ": cache hit before the image was stored" << std::endl;
+      qlex_free(miss);
+      ok = false;
+    }
+
+    qcore_cache_write(&key, image, size);
+
+    qlex_t *hit = qlex_cache_load(&key, nullptr, env.get());
+    if (!hit) {
+      std::cerr << name << ": qlex_cache_load failed" << std::endl;
+      ok = false;
+    } else {
+      ok &= same(name, expected, collect(hit));
+      qlex_free(hit);
+    }
+
+    qcore_cache_unbind();
+    g_cache.clear();
+  }
+
+  free(image);
+
+  return ok;
+}
+
+static std::string random_source(unsigned seed) {
+  std::mt19937 rng(seed);
+  std::stringstream ss;
+
+  while (ss.tellp() < 100000) {
+    switch (rng() % 8) {
+      case 0:
+        ss << "let x" << rng() % 100 << " = " << rng() << ";\n";
+        break;
+      case 1:
+        ss << "/* block\n comment */ // line comment\n# hash comment\n";
+        break;
+      case 2:
+        ss << "\"multi\nline\\n string\" 'c' '\\n' \"\\x41\\0z\"\n";
+        break;
+      case 3:
+        ss << "@(\n  local v = (1 + (2))\n)\n@macro_call(1, 2)\n";
+        break;
+      case 4:
+        ss << "fn foo(a: i32, b: [u8; 4]) -> i32 { ret a <<<= b >>> 1 ... 2; }\n";
+        break;
+      case 5:
+        ss << "1_000_.5 0x1f 0b101 1.5e10 3.14 7 2147483646 2147483647 "
+              "340282366920938463463374607431768211455\n";
+        break;
+      case 6:
+        ss << "a::b::c ns:: ::x f\"fmt {x}\" sizeof as in out $ `\n";
+        break;
+      default:
+        ss << "\n\t  \n";
+        break;
+    }
+  }
+
+  return ss.str();
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+
+  std::vector<std::string_view> args(argv, argv + argc);
+  bool ok = true;
+
+  ok &= check("empty", "");
+  ok &= check("unterminated", "let s = \"never closed");
+
+  for (unsigned seed = 0; seed < 8; seed++) {
+    ok &= check("random-" + std::to_string(seed), random_source(seed));
+  }
+
+  for (size_t i = 1; i < args.size(); i++) {
+    if (!std::filesystem::exists(args[i])) {
+      std::cerr << "File not found: " << args[i] << std::endl;
+      return 1;
+    }
+
+    std::ifstream in(std::string(args[i]), std::ios::binary);
+    std::string src((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ok &= check(args[i], src);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << args[i] << ": checked in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -49,6 +49,7 @@ typedef enum qparse_key_t {
   QPK_VERBOSE,
   QPK_CRASHGUARD,
   QPV_FASTERROR,
+  QPK_PARALLEL,
 } qparse_key_t;
 
 typedef enum qparse_val_t {
@@ -118,6 +118,46 @@ void qparse_brepr(const qparse_node_t *node, bool compress, uint8_t **out, size_
  */
 bool qparse_do(qparse_t *parser, qparse_node_t **out);
 
+/**
+ * @brief Update a parse tree after an edit, parsing again only the top-level statements it
+ * touched.
+ *
+ * @param parser The parser instance that produced `old_tree`.
+ * @param lexer Lexer over the edited source, as returned by `qlex_relex`. The parser uses it
+ * from now on, in place of the lexer it had.
+ * @param old_tree The tree last returned by `qparse_do` or `qparse_reparse` on `parser`.
+ * @param splice The changes the edit made to the tokens of that parse (see `qparse_tokens`).
+ * @param out The output parse tree.
+ *
+ * @return Returns true if no non-fatal parsing errors occurred, false otherwise.
+ *
+ * @note If `!parser`, `!lexer`, `!splice` or `!out`, or if `parser` has not parsed anything
+ * yet, false is returned.
+ * @note Statements that read no token affected by the edit are reused as they are, so the new
+ * tree shares them with `old_tree`. Both trees remain valid until the parser is freed.
+ * @note If the last parse reported errors or `old_tree` is not the last tree, the edited tokens
+ * are parsed in full.
+ *
+ * @note This function is thread safe.
+ */
+bool qparse_reparse(qparse_t *parser, qlex_t *lexer, const qparse_node_t *old_tree,
+                    const qlex_splice_t *splice, qparse_node_t **out);
+
+/**
+ * @brief Get the tokens the last parse of a parser read.
+ *
+ * @param parser The parser instance.
+ * @param count Set to the number of tokens.
+ *
+ * @return The tokens, without the end-of-file token, or NULL if the parser has not parsed
+ * anything. They remain valid until the next parse.
+ *
+ * @note Pass these to `qlex_relex` to get the splice for `qparse_reparse`.
+ *
+ * @note This function is thread safe.
+ */
+const qlex_tok_t *qparse_tokens(qparse_t *parser, size_t *count);
+
 /**
  * @brief Parse QUIX code into a parse tree and dump it to a file.
  *
@@ -53,6 +53,7 @@ static const boost::bimap<qparse_key_t, std::string_view> options_bimap =
         {QPK_VERBOSE, "-fverbose"},
         {QPK_CRASHGUARD, "-fcrashguard"},
         {QPV_FASTERROR, "-ffasterror"},
+        {QPK_PARALLEL, "-fparallel"},
     });
 
 static const boost::bimap<qparse_val_t, std::string_view> values_bimap =
@@ -40,5 +40,6 @@ namespace qparse::conf {
       {QPK_VERBOSE, QPV_FALSE},
       {QPK_CRASHGUARD, QPV_ON},
       {QPV_FASTERROR, QPV_OFF},
+      {QPK_PARALLEL, QPV_OFF},
   };
 }
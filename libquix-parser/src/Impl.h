@@ -38,6 +38,9 @@
 #include <quix-parser/Config.h>
 #include <quix-parser/Node.h>
 
+#include <Reparse.hh>
+
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -46,6 +49,8 @@ struct qparse_impl_t {
   ~qparse_impl_t() = default;
 
   qparse::diag::DiagnosticManager diag;
+  qparse::ParseTrail trail;
+  std::vector<std::unique_ptr<qcore_arena>> arenas; /* Nodes of parallel parses */
 };
 
 struct qparse_conf_t {
@@ -85,6 +85,7 @@ namespace qparse::diag {
     size_t render(DiagnosticMessageHandler handler, FormatStyle style) const;
 
     void set_ctx(qparse_t *parser) { m_parser = parser; }
+    void clear() { m_msgs.clear(); }
   };
 
   /* Set reference to the current parser */
@@ -35,14 +35,20 @@
 #include <Impl.h>
 #include <parser/Parse.h>
 #include <quix-core/Error.h>
+#include <quix-core/Pool.hh>
 #include <quix-parser/Node.h>
 #include <quix-parser/Parser.h>
 #include <setjmp.h>
 #include <signal.h>
 
 #include <ParserStruct.hh>
+#include <TokenArray.hh>
+#include <algorithm>
 #include <atomic>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <thread>
 #include <quix-core/Classes.hh>
 
 #include "LibMacro.h"
@@ -51,7 +57,7 @@ using namespace qparse::parser;
 using namespace qparse::diag;
 
 bool qparse::parser::parse(qparse_t &job, qlex_t *rd, Block **group, bool expect_braces,
-                           bool single_stmt) {
+                           bool single_stmt, TopLevel *top) {
   try {
     qlex_tok_t tok;
 
@@ -65,6 +71,10 @@ bool qparse::parser::parse(qparse_t &job, qlex_t *rd, Block **group, bool expect
     }
 
     while ((tok = qlex_peek(rd)).ty != qEofF) {
+      if (top && !top->mark((*group)->get_items().size())) {
+        break;
+      }
+
       if (single_stmt && (*group)->get_items().size() > 0) {
         break;
       }
@@ -397,6 +407,10 @@ bool qparse::parser::parse(qparse_t &job, qlex_t *rd, Block **group, bool expect
       }
     }
 
+    if (top) {
+      top->mark((*group)->get_items().size());
+    }
+
     if (expect_braces) {
       syntax(tok, "Expected '}'");
     }
@@ -514,12 +528,9 @@ static void uninstall_sigguard(qparse_t *parser) {
   sigguard_old.clear();
 }
 
-LIB_EXPORT bool qparse_do(qparse_t *L, qparse_node_t **out) {
-  if (!L || !out) {
-    return false;
-  }
-  *out = nullptr;
-
+/* Run `fn` with the arena, diagnostics and crash guard of the parser in place */
+template <typename Fn>
+static bool run_guarded(qparse_t *L, const char *what, Fn &&fn) {
   try {
     /*=============== Swap in their arena  ===============*/
     qparse::qparse_arena.swap(*L->arena.get());
@@ -531,9 +542,9 @@ LIB_EXPORT bool qparse_do(qparse_t *L, qparse_node_t **out) {
     install_sigguard(L);
     parser_ctx = L;
 
-    bool status = false;
+    volatile bool status = false;
     if (setjmp(sigguard_env) == 0) {
-      status = qparse::parser::parse(*L, L->lexer, (qparse::Block **)out, false, false);
+      status = fn();
     } else {
       L->failed = true;
     }
@@ -551,7 +562,7 @@ LIB_EXPORT bool qparse_do(qparse_t *L, qparse_node_t **out) {
     /*==================== Return status ====================*/
     return status && !L->failed;
   } catch (std::exception &e) {
-    qcore_panicf("qparse_do: unhandled exception: %s", e.what());
+    qcore_panicf("%s: unhandled exception: %s", what, e.what());
   } catch (...) {
     /*== This will be caught iff QPK_CRASHGUARD is
      * QPV_ON ==*/
@@ -559,6 +570,429 @@ LIB_EXPORT bool qparse_do(qparse_t *L, qparse_node_t **out) {
   }
 }
 
+/// BEGIN: PERFORMANCE HYPER PARAMETERS
+/* Parallel parses leave files of fewer than twice this many tokens alone */
+static constexpr size_t MIN_SEGMENT_TOKENS = 4096;
+static constexpr size_t SEGMENTS_PER_THREAD = 4;
+/// END:   PERFORMANCE HYPER PARAMETERS
+
+/* Keywords that begin a top-level declaration and continue no statement */
+static bool starts_declaration(const qlex_tok_t &tok) {
+  if (!tok.is(qKeyW)) {
+    return false;
+  }
+
+  switch (tok.as<qlex_key_t>()) {
+    case qKVar:
+    case qKLet:
+    case qKConst:
+    case qKEnum:
+    case qKStruct:
+    case qKRegion:
+    case qKGroup:
+    case qKClass:
+    case qKUnion:
+    case qKType:
+    case qKSubsystem:
+    case qKFn:
+    case qKPub:
+    case qKImport:
+    case qKSec:
+    case qKPro:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* Cut the tokens into runs of at least `target` tokens. Cuts go only before
+ * a declaration keyword that follows a ';' or '}' outside of any brackets. */
+static std::vector<size_t> find_cuts(qlex_t *lexer, const std::vector<qlex_tok_t> &tokens,
+                                     size_t target) {
+  std::vector<size_t> cuts = {0};
+  size_t depth = 0;
+
+  for (size_t i = 0; i < tokens.size(); i++) {
+    qlex_tok_t tok = tokens[i];
+
+    switch (tok.ty) {
+      case qPunc:
+        switch (tok.as<qlex_punc_t>()) {
+          case qPuncLPar:
+          case qPuncLBrk:
+          case qPuncLCur:
+            depth++;
+            break;
+          case qPuncRPar:
+          case qPuncRBrk:
+          case qPuncRCur:
+            depth -= depth > 0;
+            break;
+          default:
+            break;
+        }
+        break;
+
+      case qIntL:
+        /* The text of an integer carried by value is interned when first
+         * asked for; do it here, so the workers only ever look strings up */
+        qlex_str(lexer, &tok, nullptr);
+        break;
+
+      case qKeyW:
+        if (depth == 0 && i - cuts.back() >= target && starts_declaration(tok) &&
+            (tokens[i - 1].is<qPuncSemi>() || tokens[i - 1].is<qPuncRCur>())) {
+          cuts.push_back(i);
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  cuts.push_back(tokens.size());
+
+  return cuts;
+}
+
+/* Worker count: `this.parse_threads` from the environment, else one per core.
+ * Each parse records in `this.parse_segments` how many parts it was cut in. */
+static size_t parse_threads() {
+  if (const char *count = qcore_env_get("this.parse_threads")) {
+    return std::strtoull(count, nullptr, 10);
+  }
+
+  return std::thread::hardware_concurrency();
+}
+
+struct Segment {
+  size_t begin, end;
+  qparse::Block *block = nullptr;
+  std::vector<qparse::StmtSpan> spans;
+  bool ok = false;
+};
+
+/* Parse a segment on this thread into `arena`, with diagnostics of its own */
+static void parse_segment(qparse_t *L, const std::shared_ptr<const std::vector<qlex_tok_t>> &tokens,
+                          qcore_arena &arena, Segment &seg) {
+  qparse::TokenArray rd(tokens, seg.begin, seg.end, L->lexer);
+  qparse::TopLevel top(&rd);
+
+  qparse_impl_t impl;
+  qparse_t job;
+  job.env = L->env;
+  job.id = L->id;
+  job.impl = &impl;
+  job.lexer = &rd;
+  job.conf = L->conf;
+  job.failed = false;
+  impl.diag.set_ctx(&job);
+
+  qparse::qparse_arena.swap(*arena.get());
+  qparse::diag::install_reference(&job);
+  parser_ctx = &job;
+
+  volatile bool status = false;
+  if (setjmp(sigguard_env) == 0) {
+    try {
+      status = qparse::parser::parse(job, &rd, &seg.block, false, false, &top);
+    } catch (...) {
+      job.failed = true;
+    }
+  } else {
+    job.failed = true;
+  }
+
+  parser_ctx = nullptr;
+  qparse::diag::install_reference(nullptr);
+  qparse::qparse_arena.swap(*arena.get());
+
+  /* A statement that read past the end of the segment was cut in two */
+  seg.ok = status && !job.failed && top.pos() == seg.end && rd.eofs() <= 1;
+  seg.spans = std::move(top.spans);
+}
+
+/**
+ * @brief Split the tokens between top-level declarations and parse the parts
+ * on a pool of threads, each allocating into an arena of its own that the
+ * parser keeps. The statements are joined into one block in source order.
+ *
+ * @return False, leaving no trace, if the file is too small to bother, the
+ * threads could not be started or a part did not parse cleanly on its own.
+ * The serial parse then decides.
+ */
+static bool parse_parallel(qparse_t *L, const std::shared_ptr<const std::vector<qlex_tok_t>> &tokens,
+                           qparse::Block **out, std::vector<qparse::StmtSpan> &spans) {
+  size_t threads = parse_threads();
+  if (threads < 2 || tokens->size() < 2 * MIN_SEGMENT_TOKENS) {
+    return false;
+  }
+
+  size_t target = std::max(MIN_SEGMENT_TOKENS, tokens->size() / (threads * SEGMENTS_PER_THREAD));
+  auto cuts = find_cuts(L->lexer, *tokens, target);
+  if (cuts.size() < 3) {
+    return false;
+  }
+
+  std::vector<Segment> segs(cuts.size() - 1);
+  for (size_t i = 0; i < segs.size(); i++) {
+    segs[i].begin = cuts[i];
+    segs[i].end = cuts[i + 1];
+  }
+
+  auto &arenas = L->impl->arenas;
+  size_t base = arenas.size();
+  threads = std::min(threads, segs.size());
+  for (size_t t = 0; t < threads; t++) {
+    arenas.push_back(std::make_unique<qcore_arena>());
+  }
+
+  /* One job per worker, so that each allocates into an arena of its own */
+  std::atomic<size_t> next = 0;
+  bool done = qcore_run_pool(threads, threads, [&](size_t t) {
+    qcore_env_set_current(L->env);
+
+    for (size_t i; (i = next++) < segs.size();) {
+      parse_segment(L, tokens, *arenas[base + t], segs[i]);
+    }
+  });
+
+  if (!done || !std::all_of(segs.begin(), segs.end(), [](const Segment &seg) { return seg.ok; })) {
+    arenas.resize(base);
+    return false;
+  }
+
+  qparse::Block *root = qparse::Block::get();
+  for (const auto &seg : segs) {
+    size_t items = root->get_items().size();
+
+    for (auto item : seg.block->get_items()) {
+      root->add_item(item);
+    }
+
+    for (auto span : seg.spans) {
+      span.item_begin += items;
+      span.item_end += items;
+      spans.push_back(span);
+    }
+  }
+
+  *out = root;
+  qcore_env_set("this.parse_segments", std::to_string(segs.size()).c_str());
+
+  return true;
+}
+
+/* Parse all of `rd` on this thread, remembering its statements for `qparse_reparse` */
+static bool parse_serial(qparse_t *L, qparse::TokenArray &rd,
+                         std::shared_ptr<const std::vector<qlex_tok_t>> tokens,
+                         qparse::Block **out) {
+  auto &trail = L->impl->trail;
+  qparse::TopLevel top(&rd);
+
+  qcore_env_set("this.parse_segments", "1");
+
+  bool status = qparse::parser::parse(*L, &rd, out, false, false, &top);
+
+  /* `qparse_tokens` hands out every token, read by the parse or not */
+  rd.drain();
+
+  trail.tokens = std::move(tokens);
+  trail.spans = std::move(top.spans);
+  trail.root = *out;
+  trail.clean = status && !L->failed;
+
+  return status;
+}
+
+/* Parse a whole token array, remembering its statements for `qparse_reparse` */
+static bool parse_all(qparse_t *L, std::shared_ptr<const std::vector<qlex_tok_t>> tokens,
+                      qparse::Block **out) {
+  auto &trail = L->impl->trail;
+  trail = {};
+
+  if (L->conf->has(QPK_PARALLEL, QPV_ON)) {
+    std::vector<qparse::StmtSpan> spans;
+    if (parse_parallel(L, tokens, out, spans)) {
+      trail.tokens = std::move(tokens);
+      trail.spans = std::move(spans);
+      trail.root = *out;
+      trail.clean = true;
+
+      return true;
+    }
+  }
+
+  qparse::TokenArray rd(tokens, 0, tokens->size(), L->lexer);
+
+  return parse_serial(L, rd, std::move(tokens), out);
+}
+
+/* Parse the statements an edit touched and splice them between the old ones */
+static bool parse_edit(qparse_t *L, std::shared_ptr<const std::vector<qlex_tok_t>> tokens,
+                       size_t first, size_t removed, size_t inserted, qparse::Block **out) {
+  using namespace qparse;
+
+  auto &trail = L->impl->trail;
+  const auto &spans = trail.spans;
+
+  /* Statements that looked at no token from `first` on parse the same again */
+  size_t a = std::partition_point(spans.begin(), spans.end(),
+                                  [&](const StmtSpan &s) { return s.tok_seen < first; }) -
+             spans.begin();
+  size_t from = a > 0 ? spans[a - 1].tok_end : 0;
+
+  /* Past the edit, an old statement boundary means the rest is unchanged */
+  auto old_at = [&](size_t o) {
+    return std::lower_bound(spans.begin() + a, spans.end(), o,
+                            [](const StmtSpan &s, size_t o) { return s.tok_begin < o; }) -
+           spans.begin();
+  };
+  auto resync = [&](size_t q) {
+    if (q < first + inserted) {
+      return false;
+    }
+
+    size_t b = old_at(q - inserted + removed);
+    return b < spans.size() && spans[b].tok_begin == q - inserted + removed;
+  };
+
+  TokenArray rd(tokens, from, tokens->size(), L->lexer);
+  TopLevel top(&rd, resync);
+
+  Block *region = nullptr;
+  if (!parser::parse(*L, &rd, &region, false, false, &top) || L->failed) {
+    L->impl->diag.clear();
+    L->failed = false;
+
+    return parse_all(L, std::move(tokens), out);
+  }
+
+  size_t b = top.stopped() ? old_at(top.pos() - inserted + removed) : spans.size();
+
+  const auto &old_items = trail.root->get_items();
+  size_t kept = a > 0 ? spans[a - 1].item_end : 0;
+  size_t tail = b < spans.size() ? spans[b].item_begin : old_items.size();
+  size_t fresh = region->get_items().size();
+
+  Block *root = Block::get();
+  for (size_t i = 0; i < kept; i++) {
+    root->add_item(old_items[i]);
+  }
+  for (auto item : region->get_items()) {
+    root->add_item(item);
+  }
+  for (size_t i = tail; i < old_items.size(); i++) {
+    root->add_item(old_items[i]);
+  }
+
+  std::vector<StmtSpan> next(spans.begin(), spans.begin() + a);
+  for (auto s : top.spans) {
+    s.item_begin += kept;
+    s.item_end += kept;
+    next.push_back(s);
+  }
+  for (size_t i = b; i < spans.size(); i++) {
+    StmtSpan s = spans[i];
+    s.tok_begin = s.tok_begin - removed + inserted;
+    s.tok_end = s.tok_end - removed + inserted;
+    s.tok_seen = s.tok_seen - removed + inserted;
+    s.item_begin = s.item_begin - tail + kept + fresh;
+    s.item_end = s.item_end - tail + kept + fresh;
+    next.push_back(s);
+  }
+
+  trail.tokens = std::move(tokens);
+  trail.spans = std::move(next);
+  trail.root = root;
+
+  *out = root;
+
+  return true;
+}
+
+LIB_EXPORT bool qparse_do(qparse_t *L, qparse_node_t **out) {
+  if (!L || !out) {
+    return false;
+  }
+  *out = nullptr;
+
+  return run_guarded(L, "qparse_do", [&]() {
+    auto tokens = std::make_shared<std::vector<qlex_tok_t>>();
+
+    /* Only a parse on several threads needs every token before it starts */
+    if (L->conf->has(QPK_PARALLEL, QPV_ON) && parse_threads() > 1) {
+      qlex_tok_t tok;
+      while ((tok = qlex_next(L->lexer)).ty != qEofF) {
+        tokens->push_back(tok);
+      }
+
+      return parse_all(L, std::move(tokens), (qparse::Block **)out);
+    }
+
+    L->impl->trail = {};
+    qparse::TokenArray rd(tokens, L->lexer);
+
+    return parse_serial(L, rd, std::move(tokens), (qparse::Block **)out);
+  });
+}
+
+LIB_EXPORT bool qparse_reparse(qparse_t *L, qlex_t *lexer, const qparse_node_t *old_tree,
+                               const qlex_splice_t *splice, qparse_node_t **out) {
+  if (!L || !lexer || !splice || !out) {
+    return false;
+  }
+  *out = nullptr;
+
+  auto &trail = L->impl->trail;
+  if (!trail.tokens) {
+    return false;
+  }
+
+  const auto &old = *trail.tokens;
+  if (splice->first > old.size() || splice->removed > old.size() - splice->first) {
+    return false;
+  }
+
+  auto tokens = std::make_shared<std::vector<qlex_tok_t>>();
+  tokens->reserve(old.size() - splice->removed + splice->count);
+  tokens->insert(tokens->end(), old.begin(), old.begin() + splice->first);
+  for (size_t i = 0; i < splice->count; i++) {
+    if (splice->tokens[i].ty != qEofF) {
+      tokens->push_back(splice->tokens[i]);
+    }
+  }
+  size_t inserted = tokens->size() - splice->first;
+  tokens->insert(tokens->end(), old.begin() + splice->first + splice->removed, old.end());
+
+  bool reuse = trail.clean && old_tree == trail.root;
+
+  L->lexer = lexer;
+  L->impl->diag.clear();
+  L->failed = false;
+
+  return run_guarded(L, "qparse_reparse", [&]() {
+    if (!reuse) {
+      return parse_all(L, std::move(tokens), (qparse::Block **)out);
+    }
+
+    return parse_edit(L, std::move(tokens), splice->first, splice->removed, inserted,
+                      (qparse::Block **)out);
+  });
+}
+
+LIB_EXPORT const qlex_tok_t *qparse_tokens(qparse_t *parser, size_t *count) {
+  if (!parser || !count) {
+    return nullptr;
+  }
+
+  const auto &tokens = parser->impl->trail.tokens;
+  *count = tokens ? tokens->size() : 0;
+
+  return tokens ? tokens->data() : nullptr;
+}
+
 LIB_EXPORT bool qparse_and_dump(qparse_t *L, FILE *out, void *x0, void *x1) {
   (void)x0;
   (void)x1;
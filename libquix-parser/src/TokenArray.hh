@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef __QUIX_PARSER_TOKEN_ARRAY_H__
+#define __QUIX_PARSER_TOKEN_ARRAY_H__
+
+#define __QUIX_LEXER_IMPL__
+
+#include <quix-lexer/Token.h>
+
+#include <Reparse.hh>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <quix-lexer/Base.hh>
+#include <string_view>
+#include <vector>
+
+namespace qparse {
+  /**
+   * @brief Lexer that serves a range of an array of tokens lexed beforehand,
+   * and knows how far it has been read. Strings and locations are those of
+   * the lexer that produced the tokens. Built over an array to fill, it
+   * instead reads the source as it goes, appending each token to the array.
+   */
+  class TokenArray final : public qlex_t {
+    std::shared_ptr<const std::vector<qlex_tok_t>> m_tokens;
+    std::vector<qlex_tok_t> *m_fill = nullptr;
+    qlex_t *m_source;
+    size_t m_pos, m_end;
+    size_t m_eofs = 0;
+
+    /* Lex the next token of the source into the array; false at its end */
+    bool pull() {
+      qlex_tok_t tok = qlex_next(m_source);
+      if (tok.ty == qEofF) {
+        m_end = m_fill->size();
+        m_fill = nullptr;
+        return false;
+      }
+
+      m_fill->push_back(tok);
+      return true;
+    }
+
+  public:
+    TokenArray(std::shared_ptr<const std::vector<qlex_tok_t>> tokens, size_t begin, size_t end,
+               qlex_t *source)
+        : qlex_t(std::string_view(), source->m_filename, source->m_env),
+          m_tokens(std::move(tokens)),
+          m_source(source),
+          m_pos(begin),
+          m_end(end) {
+      m_strings = source->m_strings;
+      m_flags = source->m_flags;
+    }
+
+    TokenArray(std::shared_ptr<std::vector<qlex_tok_t>> fill, qlex_t *source)
+        : TokenArray(fill, fill->size(), SIZE_MAX, source) {
+      m_fill = fill.get();
+    }
+
+    virtual qlex_tok_t next_impl() override {
+      if (m_fill && m_pos == m_fill->size()) {
+        pull();
+      }
+
+      if (m_pos == m_end) [[unlikely]] {
+        m_eofs++;
+        return qlex_tok_t::eof({}, {});
+      }
+
+      return (*m_tokens)[m_pos++];
+    }
+
+    virtual std::optional<qlex_size> loc2offset(qlex_loc_t loc) override {
+      return m_source->loc2offset(loc);
+    }
+
+    virtual std::optional<std::pair<qlex_size, qlex_size>> loc2rowcol(qlex_loc_t loc) override {
+      return m_source->loc2rowcol(loc);
+    }
+
+    /* Index of the next token to be read, counting those peeked or pushed back as unread */
+    size_t tell() const {
+      return m_pos - std::min(pending(), m_pos);
+    }
+
+    /* Index past the last token handed out, peeked or not */
+    size_t seen() const { return m_pos; }
+
+    /* Number of times the end of the range was read */
+    size_t eofs() const { return m_eofs; }
+
+    /* Read the rest of the source into the array being filled */
+    void drain() {
+      while (m_fill && pull()) {
+      }
+    }
+  };
+
+  /**
+   * @brief Records the statements of a top-level block while it is parsed.
+   * Between two statements it may also end the parse, at a token index for
+   * which `stop` returns true.
+   */
+  class TopLevel {
+    TokenArray *m_rd;
+    std::function<bool(size_t)> m_stop;
+    size_t m_pos, m_items;
+    bool m_stopped = false;
+
+  public:
+    std::vector<StmtSpan> spans;
+
+    TopLevel(TokenArray *rd, std::function<bool(size_t)> stop = nullptr)
+        : m_rd(rd), m_stop(std::move(stop)), m_pos(rd->tell()), m_items(0) {}
+
+    /* Close the statement ending here; false if the parse stops here */
+    bool mark(size_t items) {
+      size_t pos = m_rd->tell();
+      if (items > m_items) {
+        spans.push_back({m_pos, pos, m_rd->seen(), m_items, items});
+      }
+
+      m_pos = pos;
+      m_items = items;
+      m_stopped = m_stop && m_stop(pos);
+
+      return !m_stopped;
+    }
+
+    bool stopped() const { return m_stopped; }
+    size_t pos() const { return m_pos; }
+  };
+}  // namespace qparse
+
+#endif  // __QUIX_PARSER_TOKEN_ARRAY_H__
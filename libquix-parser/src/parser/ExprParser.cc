@@ -35,10 +35,11 @@
 #include <parser/Parse.h>
 #include <quix-parser/Node.h>
 
+#include <array>
 #include <cstddef>
-#include <stack>
 #include <stdexcept>
 #include <string_view>
+#include <tuple>
 
 #define MAX_EXPR_DEPTH (10000)
 #define MAX_LIST_DUP (10000)
@@ -222,15 +223,142 @@ static bool parse_fstring(qparse_t &job, FString **node, qlex_t *rd, size_t dept
   return true;
 }
 
-/// TODO: qlex_op_t precedence
-/// TODO: qlex_op_t associativity
+///=============================================================================
+/// Operator precedence, from loosest to tightest binding. `None` marks the
+/// operators that only appear in prefix or postfix position.
+
+enum class Prec : uint8_t {
+  None,
+  Seq, /* ',' */
+  Assign,
+  Ternary,
+  Range,
+  LogicOr,
+  LogicXor,
+  LogicAnd,
+  BitOr,
+  BitXor,
+  BitAnd,
+  Equality,
+  Compare,
+  Shift,
+  Sum,
+  Product,
+  Cast,
+  Prefix,
+};
+
+enum class Bind : uint8_t { Left, Right };
+
+static constexpr std::array<std::tuple<qlex_op_t, Prec, Bind>, qOpTernary + 1> operator_list = {{
+    {qOpPlus, Prec::Sum, Bind::Left},
+    {qOpMinus, Prec::Sum, Bind::Left},
+    {qOpTimes, Prec::Product, Bind::Left},
+    {qOpSlash, Prec::Product, Bind::Left},
+    {qOpPercent, Prec::Product, Bind::Left},
+    {qOpBitAnd, Prec::BitAnd, Bind::Left},
+    {qOpBitOr, Prec::BitOr, Bind::Left},
+    {qOpBitXor, Prec::BitXor, Bind::Left},
+    {qOpBitNot, Prec::None, Bind::Left},
+    {qOpLShift, Prec::Shift, Bind::Left},
+    {qOpRShift, Prec::Shift, Bind::Left},
+    {qOpROTL, Prec::Shift, Bind::Left},
+    {qOpROTR, Prec::Shift, Bind::Left},
+    {qOpLogicAnd, Prec::LogicAnd, Bind::Left},
+    {qOpLogicOr, Prec::LogicOr, Bind::Left},
+    {qOpLogicXor, Prec::LogicXor, Bind::Left},
+    {qOpLogicNot, Prec::None, Bind::Left},
+    {qOpLT, Prec::Compare, Bind::Left},
+    {qOpGT, Prec::Compare, Bind::Left},
+    {qOpLE, Prec::Compare, Bind::Left},
+    {qOpGE, Prec::Compare, Bind::Left},
+    {qOpEq, Prec::Equality, Bind::Left},
+    {qOpNE, Prec::Equality, Bind::Left},
+    {qOpSet, Prec::Assign, Bind::Right},
+    {qOpPlusSet, Prec::Assign, Bind::Right},
+    {qOpMinusSet, Prec::Assign, Bind::Right},
+    {qOpTimesSet, Prec::Assign, Bind::Right},
+    {qOpSlashSet, Prec::Assign, Bind::Right},
+    {qOpPercentSet, Prec::Assign, Bind::Right},
+    {qOpBitAndSet, Prec::Assign, Bind::Right},
+    {qOpBitOrSet, Prec::Assign, Bind::Right},
+    {qOpBitXorSet, Prec::Assign, Bind::Right},
+    {qOpLogicAndSet, Prec::Assign, Bind::Right},
+    {qOpLogicOrSet, Prec::Assign, Bind::Right},
+    {qOpLogicXorSet, Prec::Assign, Bind::Right},
+    {qOpLShiftSet, Prec::Assign, Bind::Right},
+    {qOpRShiftSet, Prec::Assign, Bind::Right},
+    {qOpROTLSet, Prec::Assign, Bind::Right},
+    {qOpROTRSet, Prec::Assign, Bind::Right},
+    {qOpInc, Prec::None, Bind::Left},
+    {qOpDec, Prec::None, Bind::Left},
+    {qOpAs, Prec::Cast, Bind::Left},
+    {qOpBitcastAs, Prec::Cast, Bind::Left},
+    {qOpIn, Prec::Compare, Bind::Left},
+    {qOpOut, Prec::Compare, Bind::Left},
+    {qOpSizeof, Prec::None, Bind::Left},
+    {qOpBitsizeof, Prec::None, Bind::Left},
+    {qOpAlignof, Prec::None, Bind::Left},
+    {qOpTypeof, Prec::None, Bind::Left},
+    {qOpDot, Prec::None, Bind::Left},
+    {qOpRange, Prec::Range, Bind::Left},
+    {qOpEllipsis, Prec::Range, Bind::Left},
+    {qOpArrow, Prec::Assign, Bind::Right},
+    {qOpTernary, Prec::Ternary, Bind::Right},
+}};
+
+struct OpInfo {
+  Prec prec;
+  Bind assoc;
+};
+
+static constexpr auto operators = []() {
+  std::array<OpInfo, qOpTernary + 1> tab{};
+  for (const auto &[op, prec, assoc] : operator_list) {
+    tab[op] = {prec, assoc};
+  }
+  return tab;
+}();
+
+static_assert(
+    []() {
+      std::array<bool, qOpTernary + 1> seen{};
+      for (const auto &[op, prec, assoc] : operator_list) {
+        if (seen[op]) {
+          return false;
+        }
+        seen[op] = true;
+      }
+      return true;
+    }(),
+    "Every operator of the lexer needs exactly one row in the precedence table");
 
-bool qparse::parser::parse_expr(qparse_t &job, qlex_t *rd, std::set<qlex_tok_t> terminators,
-                                Expr **node, size_t depth) {
+///=============================================================================
+
+namespace {
   /**
-   * @brief
+   * @brief Precedence climbing over the tokens of one expression. Each operand
+   * is parsed by `unary`, then `binary` folds the operators that follow into
+   * it for as long as they bind at least as tightly as asked for.
    */
+  struct Pratt {
+    qparse_t &job;
+    qlex_t *rd;
+    const std::set<qlex_tok_t> &terminators;
+
+    bool binary(Prec min, Expr **node, size_t depth);
+    bool unary(Expr **node, size_t depth);
+    bool primary(qlex_tok_t tok, Expr **node, size_t depth);
+    bool postfix(Expr **node, size_t depth);
 
+    bool ends(const qlex_tok_t &tok) const { return tok.is(qEofF) || terminators.contains(tok); }
+  };
+}  // namespace
+
+static const std::set<qlex_tok_t> until_rpar = {qlex_tok_t(qPunc, qPuncRPar)};
+static const std::set<qlex_tok_t> until_colon = {qlex_tok_t(qPunc, qPuncColn)};
+
+bool Pratt::binary(Prec min, Expr **node, size_t depth) {
   if (depth > MAX_EXPR_DEPTH) {
     syntax(qlex_peek(rd),
            "Expression depth exceeded; Expressions can not be nested more than %d times",
@@ -238,496 +366,469 @@ bool qparse::parser::parse_expr(qparse_t &job, qlex_t *rd, std::set<qlex_tok_t>
     return false;
   }
 
-  std::stack<Expr *> stack;
+  Expr *left = nullptr;
+  if (!unary(&left, depth)) {
+    return false;
+  }
 
   while (true) {
     qlex_tok_t tok = qlex_peek(rd);
+    if (ends(tok)) {
+      break;
+    }
+
+    if (tok.is<qPuncComa>()) {
+      if (min > Prec::Seq) {
+        break;
+      }
+      qlex_next(rd);
 
-    if (tok.is(qEofF)) {
-      // syntax(tok, "Unexpected end of file while parsing expression");
+      Expr *right = nullptr;
+      if (!binary(Prec::Seq, &right, depth + 1)) {
+        syntax(tok, "Expected an expression after ','");
+        return false;
+      }
+
+      left = SeqPoint::get(SeqPoint({left, right}));
+      continue;
+    }
+
+    if (!tok.is(qOper)) {
+      break;
+    }
+
+    qlex_op_t op = tok.as<qlex_op_t>();
+    auto [prec, assoc] = operators[op];
+
+    if (prec == Prec::None) {
+      syntax(tok, "Unexpected operator in expression");
       return false;
     }
 
-    if (terminators.contains(tok)) {
-      /**
-       * @brief
-       */
+    if (prec < min) {
+      break;
+    }
+    qlex_next(rd);
 
-      if (stack.empty()) {
-        node = nullptr;
-        return true;
+    if (op == qOpAs || op == qOpBitcastAs) {
+      Type *type = nullptr;
+      if (!parse_type(job, rd, &type)) {
+        syntax(tok, "Failed to parse type in '%s' expression", qlex_opstr(op));
+        return false;
       }
 
-      if (stack.size() != 1) {
-        syntax(tok, "Expected a single expression on the stack");
+      left = BinExpr::get(left, op, TypeExpr::get(type));
+      continue;
+    }
+
+    if (op == qOpTernary) {
+      Expr *then = nullptr, *other = nullptr;
+      if (!parse_expr(job, rd, until_colon, &then, depth + 1) || !then) {
+        syntax(tok, "Expected an expression after '?'");
         return false;
       }
 
-      /* */
-      *node = stack.top();
-      return true;
+      if (!qlex_next(rd).is<qPuncColn>()) {
+        syntax(tok, "Expected ':' in ternary expression");
+        return false;
+      }
+
+      if (!binary(prec, &other, depth + 1)) {
+        syntax(tok, "Expected an expression after ':'");
+        return false;
+      }
+
+      left = TernaryExpr::get(left, then, other);
+      continue;
+    }
+
+    Expr *right = nullptr;
+    Prec next = assoc == Bind::Right ? prec : static_cast<Prec>(static_cast<uint8_t>(prec) + 1);
+    if (!binary(next, &right, depth + 1)) {
+      syntax(tok, "Failed to parse expression in binary operation");
+      return false;
     }
 
+    left = BinExpr::get(left, op, right);
+  }
+
+  *node = left;
+  return true;
+}
+
+bool Pratt::unary(Expr **node, size_t depth) {
+  qlex_tok_t tok = qlex_peek(rd);
+
+  if (ends(tok)) {
+    syntax(tok, "Expected an expression");
+    return false;
+  }
+
+  if (tok.is(qOper)) {
+    qlex_op_t op = tok.as<qlex_op_t>();
+    if (op == qOpDot || op == qOpAs || op == qOpBitcastAs || op == qOpTernary) {
+      syntax(tok, "Expected an expression before '%s'", qlex_opstr(op));
+      return false;
+    }
     qlex_next(rd);
 
-    switch (tok.ty) {
-      case qIntL: {
-        /**
-         * @brief
-         */
+    Expr *operand = nullptr;
+    if (!binary(Prec::Prefix, &operand, depth + 1)) {
+      syntax(tok, "Failed to parse the operand of a unary operator");
+      return false;
+    }
 
-        stack.push(LOC_121(ConstInt::get(tok.as_string(rd)), tok));
-        continue;
-      }
-      case qNumL: {
-        /**
-         * @brief
-         */
+    *node = UnaryExpr::get(op, operand);
+    return true;
+  }
 
-        stack.push(LOC_121(ConstFloat::get(tok.as_string(rd)), tok));
-        continue;
+  qlex_next(rd);
+
+  return primary(tok, node, depth) && postfix(node, depth);
+}
+
+bool Pratt::primary(qlex_tok_t tok, Expr **node, size_t depth) {
+  switch (tok.ty) {
+    case qIntL: {
+      *node = LOC_121(ConstInt::get(tok.as_string(rd)), tok);
+      return true;
+    }
+    case qNumL: {
+      *node = LOC_121(ConstFloat::get(tok.as_string(rd)), tok);
+      return true;
+    }
+    case qText: {
+      *node = LOC_121(ConstString::get(tok.as_string(rd)), tok);
+      return true;
+    }
+    case qChar: {
+      auto str = tok.as_string(rd);
+      if (str.size() > 4) {
+        syntax(tok, "Invalid character literal");
+        return false;
       }
-      case qText: {
-        /**
-         * @brief
-         */
+      str.resize(4, '\0');
 
-        stack.push(LOC_121(ConstString::get(tok.as_string(rd)), tok));
-        continue;
+      char32_t v = 0;
+      for (size_t i = 0; i < 4; i++) {
+        v |= (char32_t)str[i] >> (i * 8);
       }
-      case qChar: {
-        /**
-         * @brief
-         */
-        auto str = tok.as_string(rd);
-        if (str.size() > 4) {
-          syntax(tok, "Invalid character literal");
-          return false;
-        }
-        str.resize(4, '\0');
 
-        char32_t v = 0;
-        for (size_t i = 0; i < 4; i++) {
-          v |= (char32_t)str[i] >> (i * 8);
+      *node = LOC_121(ConstChar::get(v), tok);
+      return true;
+    }
+    case qName: {
+      *node = LOC_121(Ident::get(tok.as_string(rd)), tok);
+      return true;
+    }
+    case qKeyW: {
+      switch (tok.as<qlex_key_t>()) {
+        case qKTrue: {
+          *node = LOC_121(ConstBool::get(true), tok);
+          return true;
         }
-
-        stack.push(LOC_121(ConstChar::get(v), tok));
-        continue;
-      }
-      case qKeyW: {
-        switch (tok.as<qlex_key_t>()) {
-          case qKTrue: {
-            stack.push(LOC_121(ConstBool::get(true), tok));
-            continue;
-          }
-          case qKFalse: {
-            stack.push(LOC_121(ConstBool::get(false), tok));
-            continue;
-          }
-          case qKNull: {
-            stack.push(LOC_121(ConstNull::get(), tok));
-            continue;
-          }
-          case qKUndef: {
-            stack.push(LOC_121(ConstUndef::get(), tok));
-            continue;
+        case qKFalse: {
+          *node = LOC_121(ConstBool::get(false), tok);
+          return true;
+        }
+        case qKNull: {
+          *node = LOC_121(ConstNull::get(), tok);
+          return true;
+        }
+        case qKUndef: {
+          *node = LOC_121(ConstUndef::get(), tok);
+          return true;
+        }
+        case qKFn: {
+          Stmt *f = nullptr;
+          if (!parse_function(job, rd, &f)) {
+            syntax(tok, "Expected a function definition in expression");
+            return false;
           }
-          case qKFn: {
-            Stmt *f = nullptr;
-            if (!parse_function(job, rd, &f)) {
-              syntax(tok, "Expected a function definition in expression");
-              return false;
-            }
-            StmtExpr *adapter = StmtExpr::get(f);
-
-            if (qlex_peek(rd).is<qPuncLPar>()) {
-              qlex_next(rd);
-              Call *fcall = parse_function_call(job, adapter, rd, depth);
+          StmtExpr *adapter = StmtExpr::get(f);
 
-              if (fcall == nullptr) {
-                syntax(tok, "Expected a function call after function definition expression");
-                return false;
-              }
+          if (qlex_peek(rd).is<qPuncLPar>()) {
+            qlex_next(rd);
+            Call *fcall = parse_function_call(job, adapter, rd, depth);
 
-              stack.push(fcall);
-              continue;
-            }
-            stack.push(adapter);
-            continue;
-          }
-          case qKFString: {
-            FString *f = nullptr;
-            if (!parse_fstring(job, &f, rd, depth)) {
-              syntax(tok, "Expected an F-string in expression");
+            if (fcall == nullptr) {
+              syntax(tok, "Expected a function call after function definition expression");
               return false;
             }
-            stack.push(f);
-            continue;
+
+            *node = fcall;
+            return true;
           }
 
-          default: {
-            syntax(tok, "Unexpected keyword in expression");
+          *node = adapter;
+          return true;
+        }
+        case qKFString: {
+          FString *f = nullptr;
+          if (!parse_fstring(job, &f, rd, depth)) {
+            syntax(tok, "Expected an F-string in expression");
             return false;
           }
+
+          *node = f;
+          return true;
+        }
+        default: {
+          syntax(tok, "Unexpected keyword in expression");
+          return false;
         }
-        break;
       }
-      case qPunc: {
-        switch (tok.as<qlex_punc_t>()) {
-          case qPuncLPar: {
-            if (!stack.empty() && stack.top()->is<Field>()) {
-              Call *fcall = parse_function_call(job, stack.top(), rd, depth);
-
-              if (fcall == nullptr) {
-                syntax(tok, "Expected a function call in expression");
-                return false;
-              }
+    }
+    case qPunc: {
+      switch (tok.as<qlex_punc_t>()) {
+        case qPuncLPar: {
+          Expr *expr = nullptr;
+          if (!parse_expr(job, rd, until_rpar, &expr, depth + 1) || !expr) {
+            syntax(tok, "Expected an expression in parentheses");
+            return false;
+          }
 
-              stack.pop();
-              stack.push(fcall);
-              continue;
+          if (!qlex_next(rd).is<qPuncRPar>()) {
+            syntax(tok, "Expected ')' to close the parentheses");
+            return false;
+          }
+
+          *node = expr;
+          return true;
+        }
+        case qPuncLCur: {
+          ListData elements;
+          while (true) {
+            tok = qlex_peek(rd);
+            if (tok.is<qPuncRCur>()) {
+              qlex_next(rd);
+              break;
             }
 
-            Expr *expr = nullptr;
-            auto terminators_copy = terminators;
-            terminators_copy.insert(qlex_tok_t(qPunc, qPuncRPar));
-            if (!parse_expr(job, rd, terminators_copy, &expr, depth + 1) || !expr) {
-              syntax(tok, "Expected an expression in parentheses");
+            Expr *key = nullptr, *value = nullptr;
+            if (!parse_expr(job, rd, until_colon, &key, depth + 1) || !key) {
+              syntax(tok, "Expected a key in list element");
               return false;
             }
 
-            if (!qlex_next(rd).is<qPuncRPar>()) {
-              syntax(tok, "Expected ')' to close the parentheses");
+            tok = qlex_next(rd);
+            if (!tok.is<qPuncColn>()) {
+              syntax(tok, "Expected ':' in list element");
               return false;
             }
 
-            stack.push(expr);
-            continue;
-          }
-          case qPuncRPar: {
-            if (stack.size() != 1) {
-              syntax(tok, "Expected a single expression on the stack");
+            if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncComa), qlex_tok_t(qPunc, qPuncRCur)},
+                            &value, depth + 1) ||
+                !value) {
+              syntax(tok, "Expected a value in list element");
               return false;
             }
 
-            *node = stack.top();
-            stack.pop();
-            return true;
-          }
-          case qPuncLCur: {
-            ListData elements;
-            while (true) {
-              tok = qlex_peek(rd);
-              if (tok.is<qPuncRCur>()) {
-                qlex_next(rd);
-                break;
-              }
+            elements.push_back(Assoc::get(key, value));
 
-              Expr *key = nullptr, *value = nullptr;
-              if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncColn)}, &key, depth + 1) || !key) {
-                syntax(tok, "Expected a key in list element");
-                return false;
-              }
-
-              tok = qlex_next(rd);
-              if (!tok.is<qPuncColn>()) {
-                syntax(tok, "Expected ':' in list element");
-                return false;
-              }
-
-              if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncComa), qlex_tok_t(qPunc, qPuncRCur)},
-                              &value, depth + 1) ||
-                  !value) {
-                syntax(tok, "Expected a value in list element");
-                return false;
-              }
-
-              elements.push_back(Assoc::get(key, value));
-
-              tok = qlex_peek(rd);
-              if (tok.is<qPuncComa>()) {
-                qlex_next(rd);
-              }
+            tok = qlex_peek(rd);
+            if (tok.is<qPuncComa>()) {
+              qlex_next(rd);
             }
-
-            stack.push(List::get(elements));
-            continue;
           }
-          case qPuncLBrk: {
-            if (stack.empty()) {
-              ListData elements;
-              while (true) {
-                tok = qlex_peek(rd);
-                if (tok.is<qPuncRBrk>()) {
-                  qlex_next(rd);
-                  stack.push(List::get(elements));
-                  break;
-                }
-
-                Expr *element = nullptr;
-                if (!parse_expr(job, rd,
-                                {qlex_tok_t(qPunc, qPuncComa), qlex_tok_t(qPunc, qPuncSemi),
-                                 qlex_tok_t(qPunc, qPuncRBrk)},
-                                &element, depth + 1) ||
-                    !element) {
-                  syntax(tok, "Expected an element in list");
-                  return false;
-                }
-
-                tok = qlex_peek(rd);
-                if (tok.is<qPuncSemi>()) {
-                  qlex_next(rd);
-
-                  Expr *count = nullptr;
-                  if (!parse_expr(job, rd,
-                                  {qlex_tok_t(qPunc, qPuncRBrk), qlex_tok_t(qPunc, qPuncComa)},
-                                  &count, depth + 1) ||
-                      !count) {
-                    syntax(tok, "Expected a count in list element");
-                    return false;
-                  }
-
-                  if (!count->is<ConstInt>()) {
-                    syntax(tok, "Expected a constant integer in list element");
-                    return false;
-                  }
-                  size_t count_val = 0;
-
-                  try {
-                    count_val = std::stoi(count->as<ConstInt>()->get_value().c_str());
-                  } catch (std::out_of_range &) {
-                    syntax(tok, "Expected a constant integer in list element. std::stoi() failed");
-                    return false;
-                  }
-
-                  if (count_val > MAX_LIST_DUP) {
-                    syntax(tok, "List element duplication count exceeds the maximum limit");
-                    return false;
-                  }
-
-                  for (size_t i = 0; i < count_val; i++) {
-                    elements.push_back(element);
-                  }
-
-                  tok = qlex_peek(rd);
-                } else if (element) {
-                  elements.push_back(element);
-                }
-
-                if (tok.is<qPuncComa>()) {
-                  qlex_next(rd);
-                }
-              }
 
-              continue;
+          *node = List::get(elements);
+          return true;
+        }
+        case qPuncLBrk: {
+          ListData elements;
+          while (true) {
+            tok = qlex_peek(rd);
+            if (tok.is<qPuncRBrk>()) {
+              qlex_next(rd);
+              break;
             }
 
-            if (stack.size() != 1) {
-              syntax(tok, "Expected a single expression on the stack");
+            Expr *element = nullptr;
+            if (!parse_expr(job, rd,
+                            {qlex_tok_t(qPunc, qPuncComa), qlex_tok_t(qPunc, qPuncSemi),
+                             qlex_tok_t(qPunc, qPuncRBrk)},
+                            &element, depth + 1) ||
+                !element) {
+              syntax(tok, "Expected an element in list");
               return false;
             }
 
-            Expr *index = nullptr, *left = stack.top();
-            stack.pop();
+            tok = qlex_peek(rd);
+            if (tok.is<qPuncSemi>()) {
+              qlex_next(rd);
 
-            if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncRBrk), qlex_tok_t(qPunc, qPuncColn)},
-                            &index, depth + 1) ||
-                !index) {
-              syntax(tok, "Expected an index in list");
-              return false;
-            }
+              Expr *count = nullptr;
+              if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncRBrk), qlex_tok_t(qPunc, qPuncComa)},
+                              &count, depth + 1) ||
+                  !count) {
+                syntax(tok, "Expected a count in list element");
+                return false;
+              }
 
-            tok = qlex_next(rd);
-            if (tok.is<qPuncColn>()) {
-              Expr *end = nullptr;
-              if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncRBrk)}, &end, depth + 1) || !end) {
-                syntax(tok, "Expected an end index in list");
+              if (!count->is<ConstInt>()) {
+                syntax(tok, "Expected a constant integer in list element");
                 return false;
               }
+              size_t count_val = 0;
 
-              tok = qlex_next(rd);
-              if (!tok.is<qPuncRBrk>()) {
-                syntax(tok, "Expected ']' to close the list index");
+              try {
+                count_val = std::stoi(count->as<ConstInt>()->get_value().c_str());
+              } catch (std::out_of_range &) {
+                syntax(tok, "Expected a constant integer in list element. std::stoi() failed");
                 return false;
               }
 
-              stack.push(Slice::get(left, index, end));
-              continue;
-            }
+              if (count_val > MAX_LIST_DUP) {
+                syntax(tok, "List element duplication count exceeds the maximum limit");
+                return false;
+              }
 
-            if (!tok.is<qPuncRBrk>()) {
-              syntax(tok, "Expected ']' to close the list index");
-              return false;
+              for (size_t i = 0; i < count_val; i++) {
+                elements.push_back(element);
+              }
+
+              tok = qlex_peek(rd);
+            } else {
+              elements.push_back(element);
             }
 
-            tok = qlex_peek(rd);
-            if (tok.is<qOpInc>()) {
-              PostUnaryExpr *p = PostUnaryExpr::get(Index::get(left, index), qOpInc);
-              stack.push(p);
+            if (tok.is<qPuncComa>()) {
               qlex_next(rd);
-              continue;
-            } else if (tok.is<qOpDec>()) {
-              PostUnaryExpr *p = PostUnaryExpr::get(Index::get(left, index), qOpDec);
-              stack.push(p);
-              qlex_next(rd);
-              continue;
             }
-
-            stack.push(Index::get(left, index));
-            continue;
           }
-          case qPuncComa: {
-            if (stack.size() != 1) {
-              syntax(tok, "Expected a single expression on the stack");
-              return false;
-            }
 
-            Expr *right = nullptr, *left = stack.top();
-            stack.pop();
-
-            if (!parse_expr(job, rd, terminators, &right, depth + 1) || !right) {
-              syntax(tok, "Expected an expression after ','");
-              return false;
-            }
-
-            stack.push(SeqPoint::get(SeqPoint({left, right})));
-            continue;
-          }
-          default: {
-            syntax(tok, "Unexpected punctuation in expression");
-            return false;
-          } break;
+          *node = List::get(elements);
+          return true;
         }
-      }
-      case qOper: {
-        qlex_op_t op = tok.as<qlex_op_t>();
-        if (op == qOpDot) {
-          if (stack.size() != 1) {
-            syntax(tok, "Expected a single expression on the stack");
-            return false;
-          }
-
-          Expr *left = stack.top();
-          stack.pop();
-
-          tok = qlex_next(rd);
-          if (!tok.is(qName)) {
-            syntax(tok, "Expected an identifier after '.'");
-            return false;
-          }
-
-          std::string ident = tok.as_string(rd);
-          tok = qlex_peek(rd);
-          if (tok.is<qOpInc>()) {
-            PostUnaryExpr *p = PostUnaryExpr::get(Field::get(left, ident), qOpInc);
-            stack.push(p);
-            qlex_next(rd);
-            continue;
-          } else if (tok.is<qOpDec>()) {
-            PostUnaryExpr *p = PostUnaryExpr::get(Field::get(left, ident), qOpDec);
-            stack.push(p);
-            qlex_next(rd);
-            continue;
-          }
-
-          stack.push(Field::get(left, ident));
-          continue;
+        default: {
+          syntax(tok, "Unexpected punctuation in expression");
+          return false;
         }
-        Expr *expr = nullptr;
-
-        if (op == qOpAs) {
-          if (stack.size() != 1) {
-            syntax(tok, "Expected a single expression on the stack");
-            return false;
-          }
+      }
+    }
+    default: {
+      syntax(tok, "Unexpected token in expression");
+      return false;
+    }
+  }
+}
 
-          Type *type = nullptr;
-          if (!parse_type(job, rd, &type)) {
-            syntax(tok, "Failed to parse type in 'as' expression");
-            return false;
-          }
+bool Pratt::postfix(Expr **node, size_t depth) {
+  while (true) {
+    qlex_tok_t tok = qlex_peek(rd);
+    if (ends(tok)) {
+      return true;
+    }
 
-          Expr *left = stack.top();
-          stack.pop();
-          stack.push(BinExpr::get(left, qOpAs, TypeExpr::get(type)));
-          continue;
-        }
+    if (tok.is<qPuncLPar>() && ((*node)->is<Ident>() || (*node)->is<Field>())) {
+      qlex_next(rd);
 
-        if (op == qOpBitcastAs) {
-          if (stack.size() != 1) {
-            syntax(tok, "Expected a single expression on the stack");
-            return false;
-          }
+      Call *fcall = parse_function_call(job, *node, rd, depth);
+      if (fcall == nullptr) {
+        syntax(tok, "Expected a function call in expression");
+        return false;
+      }
 
-          Type *type = nullptr;
-          if (!parse_type(job, rd, &type)) {
-            syntax(tok, "Failed to parse type in 'bitcast as' expression");
-            return false;
-          }
+      *node = fcall;
+    } else if (tok.is<qPuncLBrk>()) {
+      qlex_next(rd);
 
-          Expr *left = stack.top();
-          stack.pop();
-          stack.push(BinExpr::get(left, qOpBitcastAs, TypeExpr::get(type)));
-          continue;
-        }
+      Expr *index = nullptr;
+      if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncRBrk), qlex_tok_t(qPunc, qPuncColn)},
+                      &index, depth + 1) ||
+          !index) {
+        syntax(tok, "Expected an index in list");
+        return false;
+      }
 
-        if (!parse_expr(job, rd, terminators, &expr, depth + 1) || !expr) {
-          syntax(tok, "Failed to parse expression in binary operation");
+      tok = qlex_next(rd);
+      if (tok.is<qPuncColn>()) {
+        Expr *end = nullptr;
+        if (!parse_expr(job, rd, {qlex_tok_t(qPunc, qPuncRBrk)}, &end, depth + 1) || !end) {
+          syntax(tok, "Expected an end index in list");
           return false;
         }
 
-        if (stack.empty()) {
-          stack.push(UnaryExpr::get((qlex_op_t)op, expr));
-          continue;
-        } else if (stack.size() == 1) {
-          Expr *left = stack.top();
-          stack.pop();
-          stack.push(BinExpr::get(left, (qlex_op_t)op, expr));
-          continue;
-        } else {
-          syntax(tok, "Unexpected operator in expression");
+        tok = qlex_next(rd);
+        if (!tok.is<qPuncRBrk>()) {
+          syntax(tok, "Expected ']' to close the list index");
           return false;
         }
-        break;
+
+        *node = Slice::get(*node, index, end);
+        continue;
       }
-      case qName: {
-        std::string ident = tok.as_string(rd);
-        if (qlex_peek(rd).ty == qPunc && (qlex_peek(rd)).as<qlex_punc_t>() == qPuncLPar) {
-          qlex_next(rd);
-
-          Call *fcall = parse_function_call(job, Ident::get(ident), rd, depth);
-          if (fcall == nullptr) {
-            syntax(tok, "Expected a function call in expression");
-            return false;
-          }
 
-          stack.push(fcall);
-          continue;
-        } else if (qlex_peek(rd).is<qOpInc>()) {
-          PostUnaryExpr *p = PostUnaryExpr::get(Ident::get(ident), qOpInc);
-          stack.push(p);
-          qlex_next(rd);
-          continue;
-        } else if (qlex_peek(rd).is<qOpDec>()) {
-          PostUnaryExpr *p = PostUnaryExpr::get(Ident::get(ident), qOpDec);
-          stack.push(p);
-          qlex_next(rd);
-          continue;
-        } else {
-          Ident *id = Ident::get(ident);
-          id->set_start_pos(tok.start);
-          id->set_end_pos(tok.end);
-          stack.push(id);
-          continue;
-        }
+      if (!tok.is<qPuncRBrk>()) {
+        syntax(tok, "Expected ']' to close the list index");
+        return false;
       }
-      default: {
-        syntax(tok, "Unexpected token in expression");
+
+      *node = Index::get(*node, index);
+    } else if (tok.is<qOpDot>()) {
+      qlex_next(rd);
+
+      tok = qlex_next(rd);
+      if (!tok.is(qName)) {
+        syntax(tok, "Expected an identifier after '.'");
         return false;
       }
+
+      *node = Field::get(*node, tok.as_string(rd));
+    } else if (tok.is<qOpInc>() || tok.is<qOpDec>()) {
+      qlex_next(rd);
+
+      *node = PostUnaryExpr::get(*node, tok.as<qlex_op_t>());
+    } else {
+      return true;
     }
   }
+}
 
-  syntax(qlex_peek(rd), "Unexpected end of expression");
-  return false;
+bool qparse::parser::parse_expr(qparse_t &job, qlex_t *rd, const std::set<qlex_tok_t> &terminators,
+                                Expr **node, size_t depth) {
+  /**
+   * @brief Parse an expression up to, but not including, one of the
+   * terminators. Nothing before the terminator yields no expression.
+   */
+
+  if (depth > MAX_EXPR_DEPTH) {
+    syntax(qlex_peek(rd),
+           "Expression depth exceeded; Expressions can not be nested more than %d times",
+           MAX_EXPR_DEPTH);
+    return false;
+  }
+
+  qlex_tok_t tok = qlex_peek(rd);
+  if (tok.is(qEofF)) {
+    return false;
+  }
+
+  if (terminators.contains(tok)) {
+    return true;
+  }
+
+  Pratt pratt{job, rd, terminators};
+
+  Expr *expr = nullptr;
+  if (!pratt.binary(Prec::Seq, &expr, depth)) {
+    return false;
+  }
+
+  tok = qlex_peek(rd);
+  if (tok.is(qEofF)) {
+    return false;
+  }
+
+  if (tok.is<qPuncRPar>() && !terminators.contains(tok)) {
+    /* A stray ')' ends the expression */
+    qlex_next(rd);
+  } else if (!terminators.contains(tok)) {
+    syntax(tok, "Unexpected token in expression");
+    return false;
+  }
+
+  *node = expr;
+  return true;
 }
@@ -48,9 +48,13 @@
 #include <ParserStruct.hh>
 #include <set>
 
+namespace qparse {
+  class TopLevel;
+}
+
 namespace qparse::parser {
   bool parse(qparse_t &job, qlex_t *rd, Block **node, bool expect_braces = true,
-             bool single_stmt = false);
+             bool single_stmt = false, TopLevel *top = nullptr);
 
   bool parse_pub(qparse_t &job, qlex_t *rd, Stmt **node);
   bool parse_sec(qparse_t &job, qlex_t *rd, Stmt **node);
@@ -76,8 +80,8 @@ namespace qparse::parser {
 
   bool parse_function(qparse_t &job, qlex_t *rd, Stmt **node);
 
-  bool parse_expr(qparse_t &job, qlex_t *rd, std::set<qlex_tok_t> terminators, Expr **node,
-                  size_t depth = 0);
+  bool parse_expr(qparse_t &job, qlex_t *rd, const std::set<qlex_tok_t> &terminators,
+                  Expr **node, size_t depth = 0);
 
   bool parse_type(qparse_t &job, qlex_t *rd, Type **node);
 
@@ -0,0 +1,173 @@
+#include <quix-lexer/Lib.h>
+#include <quix-parser/Lib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <quix-core/Classes.hh>
+#include <quix-parser/Classes.hh>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Benchmark of the expression parser on operator-dense code: the rounds of
+ * hash functions and stream ciphers, and tables of crypto constants. Lexing
+ * is timed on its own and subtracted, leaving the time spent parsing. */
+
+static const char *sha256_k[] = {
+    "0x428a2f98", "0x71374491", "0xb5c0fbcf", "0xe9b5dba5", "0x3956c25b", "0x59f111f1",
+    "0x923f82a4", "0xab1c5ed5", "0xd807aa98", "0x12835b01", "0x243185be", "0x550c7dc3",
+    "0x72be5d74", "0x80deb1fe", "0x9bdc06a7", "0xc19bf174", "0xe49b69c1", "0xefbe4786",
+    "0x0fc19dc6", "0x240ca1cc", "0x2de92c6f", "0x4a7484aa", "0x5cb0a9dc", "0x76f988da",
+    "0x983e5152", "0xa831c66d", "0xb00327c8", "0xbf597fc7", "0xc6e00bf3", "0xd5a79147",
+    "0x06ca6351", "0x14292967", "0x27b70a85", "0x2e1b2138", "0x4d2c6dfc", "0x53380d13",
+    "0x650a7354", "0x766a0abb", "0x81c2c92e", "0x92722c85", "0xa2bfe8a1", "0xa81a664b",
+    "0xc24b8b70", "0xc76c51a3", "0xd192e819", "0xd6990624", "0xf40e3585", "0x106aa070",
+    "0x19a4c116", "0x1e376c08", "0x2748774c", "0x34b0bcb5", "0x391c0cb3", "0x4ed8aa4a",
+    "0x5b9cca4f", "0x682e6ff3", "0x748f82ee", "0x78a5636f", "0x84c87814", "0x8cc70208",
+    "0x90befffa", "0xa4506ceb", "0xbef9a3f7", "0xc67178f2",
+};
+
+static std::string generate(size_t repeat) {
+  std::string src;
+
+  for (size_t r = 0; r < repeat; r++) {
+    std::string n = std::to_string(r);
+
+    src += "fn sha256_rounds" + n + "(w: [u32; 64], s: [u32; 8]): u32 {\n";
+    for (size_t i = 0; i < 64; i++) {
+      std::string k = sha256_k[i], j = std::to_string(i);
+      src += "  t1 = s[7] + ((s[4] >>> 6) ^ (s[4] >>> 11) ^ (s[4] >>> 25)) + ((s[4] & s[5]) ^ "
+             "(~s[4] & s[6])) + " +
+             k + " + w[" + j + "];\n";
+      src += "  t2 = ((s[0] >>> 2) ^ (s[0] >>> 13) ^ (s[0] >>> 22)) + ((s[0] & s[1]) ^ (s[0] & "
+             "s[2]) ^ (s[1] & s[2]));\n";
+      src += "  w[" + j + "] = w[" + j + "] + (w[" + j + "] >>> 7 ^ w[" + j + "] >>> 18 ^ w[" + j +
+             "] >> 3) + " + k + " * 3 - 1;\n";
+    }
+    src += "  ret t1 + t2;\n}\n";
+
+    src += "fn chacha_rounds" + n + "(x: [u32; 16]) {\n";
+    for (size_t i = 0; i < 8; i++) {
+      std::string a = std::to_string(i % 4), b = std::to_string(4 + (i + i / 4) % 4),
+                  c = std::to_string(8 + (i + 2 * (i / 4)) % 4),
+                  d = std::to_string(12 + (i + 3 * (i / 4)) % 4);
+      src += "  x[" + a + "] += x[" + b + "]; x[" + d + "] = (x[" + d + "] ^ x[" + a +
+             "]) <<< 16;\n";
+      src += "  x[" + c + "] += x[" + d + "]; x[" + b + "] = (x[" + b + "] ^ x[" + c +
+             "]) <<< 12;\n";
+      src += "  x[" + a + "] += x[" + b + "]; x[" + d + "] = (x[" + d + "] ^ x[" + a +
+             "]) <<< 8;\n";
+      src += "  x[" + c + "] += x[" + d + "]; x[" + b + "] = (x[" + b + "] ^ x[" + c +
+             "]) <<< 7;\n";
+    }
+    src += "}\n";
+
+    src += "let mix" + n + ": u32 = ";
+    for (size_t i = 0; i < 64; i++) {
+      src += std::string(i ? (i % 3 == 0 ? " + " : i % 3 == 1 ? " ^ " : " * ") : "") + "(" +
+             sha256_k[i] + " <<< " + std::to_string(i % 32) + " & 0xffffffff)";
+    }
+    src += ";\n";
+  }
+
+  return src;
+}
+
+static double now_ns() {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::high_resolution_clock::now().time_since_epoch())
+      .count();
+}
+
+/* Best time of `iterations` runs of lexing, and of lexing and parsing */
+static bool measure(const std::string &src, size_t iterations, double &lex_ns, double &total_ns,
+                    size_t &tokens) {
+  lex_ns = total_ns = std::numeric_limits<double>::max();
+
+  for (size_t i = 0; i < iterations; i++) {
+    qcore_env env;
+
+    {
+      qlex_t *lexer = qlex_direct(src.data(), src.size(), "bench.q", env.get());
+      double t0 = now_ns();
+
+      tokens = 0;
+      while (qlex_next(lexer).ty != qEofF) {
+        tokens++;
+      }
+
+      lex_ns = std::min(lex_ns, now_ns() - t0);
+      qlex_free(lexer);
+    }
+
+    {
+      qlex_t *lexer = qlex_direct(src.data(), src.size(), "bench.q", env.get());
+      bool ok;
+
+      {
+        qparse_conf conf;
+        qparser parser(lexer, conf.get(), env.get());
+        qparse_node_t *tree = nullptr;
+
+        double t0 = now_ns();
+        ok = qparse_do(parser.get(), &tree);
+        total_ns = std::min(total_ns, now_ns() - t0);
+      }
+
+      qlex_free(lexer);
+
+      if (!ok) {
+        std::cerr << "The benchmark source does not parse" << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+  qparse_lib_init();
+
+  std::vector<std::string_view> args(argv, argv + argc);
+  size_t iterations = 5, repeat = 50;
+
+  for (size_t i = 1; i < args.size(); i++) {
+    if (args[i] == "--iterations" && i + 1 < args.size()) {
+      iterations = std::max(1, atoi(args[++i].data()));
+    } else if (args[i] == "--repeat" && i + 1 < args.size()) {
+      repeat = std::max(1, atoi(args[++i].data()));
+    } else {
+      std::cerr << "Usage: " << args[0] << " [--iterations N] [--repeat N]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::string src = generate(repeat);
+
+  double lex_ns, total_ns;
+  size_t tokens;
+  if (!measure(src, iterations, lex_ns, total_ns, tokens)) {
+    return 1;
+  }
+
+  double parse_ns = std::max(total_ns - lex_ns, 0.0);
+
+  std::cout << "Source size: " << src.size() << " bytes" << std::endl;
+  std::cout << "Token count: " << tokens << std::endl;
+  std::cout << "Lex time: " << (size_t)lex_ns << " ns" << std::endl;
+  std::cout << "Lex and parse time: " << (size_t)total_ns << " ns" << std::endl;
+  std::cout << "Parse time: " << (size_t)parse_ns << " ns" << std::endl;
+  std::cout << "Parse ns per token: " << (tokens ? parse_ns / tokens : 0.0) << std::endl;
+  std::cout << "Tokens parsed per second: " << (parse_ns > 0 ? tokens / (parse_ns / 1e9) : 0.0)
+            << std::endl;
+
+  qparse_lib_deinit();
+  qlex_lib_deinit();
+
+  return 0;
+}
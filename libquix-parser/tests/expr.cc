@@ -0,0 +1,87 @@
+#include <quix-lexer/Lib.h>
+#include <quix-parser/Lib.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-parser/Classes.hh>
+#include <string>
+
+/* Operators bind by precedence and associativity: each expression parses to
+ * the same tree as its fully parenthesized form. */
+
+static const char *cases[][2] = {
+    {"a + b * c", "a + (b * c)"},
+    {"a * b + c", "(a * b) + c"},
+    {"a - b - c", "(a - b) - c"},
+    {"a / b * c % d", "((a / b) * c) % d"},
+    {"a = b += c", "a = (b += c)"},
+    {"x ^ y <<< 7 & m", "x ^ ((y <<< 7) & m)"},
+    {"a | b ^ c & d", "a | (b ^ (c & d))"},
+    {"a || b ^^ c && d == e", "a || (b ^^ (c && (d == e)))"},
+    {"a < b == c >= d", "(a < b) == (c >= d)"},
+    {"-a * b", "(-a) * b"},
+    {"!a && ~b", "(!a) && (~b)"},
+    {"a[0] as u32 << 8", "(a[0] as u32) << 8"},
+    {"s.x * k + f(1, 2)", "((s.x) * k) + (f(1, 2))"},
+    {"i++ + --j", "(i++) + (--j)"},
+    {"c ? a + 1 : b ? d : e", "c ? (a + 1) : (b ? d : e)"},
+    {"0x6a09e667 ^ 0xbb67ae85 + 0x3c6ef372", "0x6a09e667 ^ (0xbb67ae85 + 0x3c6ef372)"},
+};
+
+static bool parse(const std::string &expr, std::string &out) {
+  std::string src = "let x: u32 = " + expr + ";";
+
+  qcore_env env;
+  qlex_t *lexer = qlex_direct(src.data(), src.size(), "expr.q", env.get());
+
+  bool ok;
+  {
+    qparse_conf conf;
+    qparser parser(lexer, conf.get(), env.get());
+
+    qparse_node_t *tree = nullptr;
+    if ((ok = qparse_do(parser.get(), &tree))) {
+      size_t len = 0;
+      char *str = qparse_repr(tree, false, 2, &len);
+      out = std::string(str, len);
+      free(str);
+    }
+  }
+
+  qlex_free(lexer);
+
+  return ok;
+}
+
+int main() {
+  qlex_lib_init();
+  qparse_lib_init();
+
+  bool ok = true;
+
+  for (const auto &[expr, grouped] : cases) {
+    std::string a, b;
+
+    if (!parse(expr, a) || !parse(grouped, b)) {
+      std::cerr << "'" << expr << "' does not parse" << std::endl;
+      ok = false;
+    } else if (a != b) {
+      std::cerr << "'" << expr << "' does not parse as '" << grouped << "'" << std::endl;
+      ok = false;
+    }
+  }
+
+  std::string unused;
+  if (parse("a + * ;", unused) || parse("a b", unused)) {
+    std::cerr << "malformed expressions parse" << std::endl;
+    ok = false;
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qparse_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
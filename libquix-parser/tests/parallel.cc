@@ -0,0 +1,125 @@
+#include <quix-lexer/Lib.h>
+#include <quix-parser/Lib.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-parser/Classes.hh>
+#include <string>
+
+/* Parsing a large file on several threads yields the same tree, and the same
+ * reports, as parsing it on one. */
+
+static std::string generate(size_t count, bool broken) {
+  std::string src;
+
+  for (size_t i = 0; i < count; i++) {
+    std::string n = std::to_string(i);
+
+    src += "struct S" + n + " {\n  a: [u8; " + n + "],\n  b: i16,\n}\n";
+    src += "fn f" + n + "(x: i32, y: i32): i32 {\n";
+    src += "  if x > " + n + " { ret x * y + 0x" + n + "; } else { ret (x - y) >> 3; }\n";
+    src += "}\n";
+    src += "let g" + n + ": i32 = " + n + " * 3 + f" + n + "(1, 2);\n";
+    src += "pub \"C\" fn e" + n + "(): i32 { ret g" + n + "; }\n";
+
+    if (broken && i == count / 2) {
+      src += "fn oops( {\n";
+    }
+  }
+
+  return src;
+}
+
+struct Result {
+  bool ok;
+  std::string tree;
+  size_t reports;
+  size_t segments; /* Parts the file was parsed in */
+};
+
+static Result parse(const std::string &src, bool parallel) {
+  qcore_env env;
+  if (parallel) {
+    /* Take the threaded path even on a machine with a single core */
+    qcore_env_set("this.parse_threads", "4");
+  }
+
+  qlex_t *lexer = qlex_direct(src.data(), src.size(), "parallel.q", env.get());
+
+  Result r{};
+  {
+    qparse_conf conf;
+    qparse_conf_setopt(conf.get(), QPK_PARALLEL, parallel ? QPV_ON : QPV_OFF);
+    qparser parser(lexer, conf.get(), env.get());
+
+    qparse_node_t *tree = nullptr;
+    r.ok = qparse_do(parser.get(), &tree);
+
+    if (r.ok) {
+      size_t len = 0;
+      char *str = qparse_repr(tree, false, 2, &len);
+      r.tree = std::string(str, len);
+      free(str);
+    }
+
+    qparse_dumps(
+        parser.get(), true, [](const char *, size_t, uintptr_t data) { (*(size_t *)data)++; },
+        (uintptr_t)&r.reports);
+  }
+
+  const char *segments = qcore_env_get("this.parse_segments");
+  r.segments = segments ? std::strtoull(segments, nullptr, 10) : 0;
+
+  qlex_free(lexer);
+
+  return r;
+}
+
+static bool expect(const char *what, const std::string &src, bool ok, bool threaded) {
+  Result serial = parse(src, false);
+  Result parallel = parse(src, true);
+
+  if (serial.ok != ok || parallel.ok != ok) {
+    std::cerr << what << ": expected the parses to " << (ok ? "succeed" : "fail") << std::endl;
+    return false;
+  }
+
+  /* Without this, a parse that quietly fell back to one thread would pass */
+  if (serial.segments != 1 || (parallel.segments > 1) != threaded) {
+    std::cerr << what << ": parsed in " << parallel.segments << " parts, expected "
+              << (threaded ? "several" : "one") << std::endl;
+    return false;
+  }
+
+  if (serial.tree != parallel.tree) {
+    std::cerr << what << ": the trees differ" << std::endl;
+    return false;
+  }
+
+  if (serial.reports != parallel.reports) {
+    std::cerr << what << ": " << serial.reports << " reports in serial, " << parallel.reports
+              << " in parallel" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main() {
+  qlex_lib_init();
+  qparse_lib_init();
+
+  bool ok = true;
+
+  ok &= expect("small file", generate(4, false), true, false);
+  ok &= expect("large file", generate(2000, false), true, true);
+  ok &= expect("large file with an error", generate(2000, true), false, false);
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qparse_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
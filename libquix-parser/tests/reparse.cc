@@ -0,0 +1,148 @@
+#include <quix-lexer/Lib.h>
+#include <quix-parser/Lib.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-parser/Classes.hh>
+#include <string>
+
+/* After an edit, reparsing yields the tree a full parse of the edited source
+ * would, while the statements the edit did not touch are reused as they are. */
+
+static const char *source =
+    "struct Point {\n"
+    "  x: i32,\n"
+    "  y: i32,\n"
+    "}\n"
+    "fn add(a: i32, b: i32): i32 {\n"
+    "  ret a + b;\n"
+    "}\n"
+    "fn scale(p: Point, k: i32): i32 {\n"
+    "  ret p.x * k;\n"
+    "}\n"
+    "let origin: Point;\n"
+    "fn main(): i32 {\n"
+    "  ret add(1, 2);\n"
+    "}\n";
+
+static std::string repr(const qparse_node_t *node) {
+  size_t len = 0;
+  char *str = qparse_repr(node, false, 2, &len);
+  std::string out(str, len);
+  free(str);
+
+  return out;
+}
+
+static std::string parse_full(const std::string &src, qcore_env_t env) {
+  qlex_t *lexer = qlex_direct(src.data(), src.size(), "reparse.q", env);
+
+  std::string out;
+  {
+    qparse_conf conf;
+    qparser parser(lexer, conf.get(), env);
+
+    qparse_node_t *tree = nullptr;
+    if (qparse_do(parser.get(), &tree)) {
+      out = repr(tree);
+    }
+  }
+
+  qlex_free(lexer);
+
+  return out;
+}
+
+/* Replace `find` in the source with `with` and check the reparse, which must
+ * reuse at least `reused` statements of the old tree */
+static bool edit(const char *what, const char *find, const char *with, size_t reused) {
+  qcore_env env;
+
+  std::string before = source;
+  size_t offset = before.find(find);
+  std::string after = before;
+  after.replace(offset, strlen(find), with);
+
+  qlex_t *lexer = qlex_direct(before.data(), before.size(), "reparse.q", env.get());
+  qlex_t *next = nullptr;
+  bool ok = true;
+
+  {
+    qparse_conf conf;
+    qparser parser(lexer, conf.get(), env.get());
+
+    qparse_node_t *old_tree = nullptr, *new_tree = nullptr;
+    if (!qparse_do(parser.get(), &old_tree)) {
+      std::cerr << what << ": the source does not parse" << std::endl;
+      qlex_free(lexer);
+      return false;
+    }
+
+    size_t count;
+    const qlex_tok_t *tokens = qparse_tokens(parser.get(), &count);
+
+    qlex_splice_t splice;
+    next = qlex_relex(lexer, tokens, count, after.data(), after.size(), offset, strlen(find),
+                      strlen(with), &splice);
+    if (!next) {
+      std::cerr << what << ": qlex_relex failed" << std::endl;
+      qlex_free(lexer);
+      return false;
+    }
+
+    if (!qparse_reparse(parser.get(), next, old_tree, &splice, &new_tree)) {
+      std::cerr << what << ": qparse_reparse failed" << std::endl;
+      ok = false;
+    } else {
+      std::string expected = parse_full(after, env.get());
+      if (repr(new_tree) != expected) {
+        std::cerr << what << ": expected\n" << expected << "\ngot\n" << repr(new_tree) << std::endl;
+        ok = false;
+      }
+
+      auto &old_items = static_cast<qparse::Block *>(old_tree)->get_items();
+      auto &new_items = static_cast<qparse::Block *>(new_tree)->get_items();
+
+      size_t shared = 0;
+      for (auto item : new_items) {
+        for (auto old_item : old_items) {
+          shared += item == old_item;
+        }
+      }
+
+      if (shared < reused) {
+        std::cerr << what << ": expected at least " << reused << " reused statements, got " << shared
+                  << std::endl;
+        ok = false;
+      }
+    }
+
+    free(splice.tokens);
+  }
+
+  qlex_free(next);
+  qlex_free(lexer);
+
+  return ok;
+}
+
+int main() {
+  qlex_lib_init();
+  qparse_lib_init();
+
+  bool ok = true;
+
+  ok &= edit("function body", "p.x * k", "p.y * k + 1", 4);
+  ok &= edit("new declaration", "let origin", "let unit: Point;\nlet origin", 3);
+  ok &= edit("removed declaration", "let origin: Point;\n", "", 3);
+  ok &= edit("appended declaration", "ret add(1, 2);\n}\n", "ret add(1, 2);\n}\nlet z: i32;\n", 4);
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qparse_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -33,6 +33,8 @@
 #define __QUIX_PREP_PROCESS_H__
 
 #include <quix-lexer/Lexer.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -75,9 +77,96 @@ typedef bool (*qprep_fetch_module_t)(qlex_t *ctx, const char *import_name, char
  * @param any User-defined data to pass to the fetch function.
  *
  * @note This function is thread-safe.
+ * @warning What `fetch_fn` returns for an import name is cached for the whole
+ * process, by `fetch_fn`, `any` and name, and never refetched on its own. A
+ * host that outlives edits to modules, such as a language server, must call
+ * `qprep_clear_import_cache` when a module changes.
  */
 void qprep_set_fetch_module(qlex_t *ctx, qprep_fetch_module_t fetch_fn, uintptr_t any);
 
+/**
+ * @brief Set a fetch module function that may be called from several threads
+ * at once, all with the same preprocessor context.
+ *
+ * The modules of a run of consecutive `@import` statements are then fetched
+ * and lexed ahead, in parallel, when the first of them is expanded. The output
+ * is the same as with `qprep_set_fetch_module`.
+ *
+ * @param ctx Preprocessor context.
+ * @param fetch_fn Fetch module function, safe to call concurrently.
+ * @param any User-defined data to pass to the fetch function.
+ *
+ * @note This function is thread-safe.
+ * @warning Fetched modules are cached as with `qprep_set_fetch_module`.
+ */
+void qprep_set_fetch_module_concurrent(qlex_t *ctx, qprep_fetch_module_t fetch_fn, uintptr_t any);
+
+/**
+ * @brief Forget all modules fetched so far.
+ *
+ * Fetched modules are cached for the whole process and shared between
+ * preprocessor contexts, so that the fetch function is called once per import
+ * name. Nothing expires on its own: call this whenever modules may have
+ * changed since they were fetched, or later files keep seeing the old text.
+ *
+ * @note This function is thread-safe.
+ */
+void qprep_clear_import_cache();
+
+/**
+ * @brief Forget all memoized expansions of pure macros.
+ *
+ * A macro marked pure, with `quix.pure(name)` or by defining it as
+ * `@(pure fn name(...) { ... })`, expands to the tokens it expanded to
+ * before whenever it is called with the same argument text. Those tokens are
+ * kept for the whole process and, if a cache provider is bound, stored
+ * through it. Only calls whose arguments are literals are memoized.
+ *
+ * @note Expansions already stored through the cache provider are not removed.
+ * @note This function is thread-safe.
+ */
+void qprep_clear_memo_cache();
+
+/**
+ * @brief What one macro call, macro block or define cost a preprocessor.
+ *
+ * Lua time excludes lexing and the macros expanded while it ran, which are
+ * counted on their own. Lexing time and tokens are those of the text the
+ * macro expanded to, by returning or emitting it.
+ */
+typedef struct qprep_profile_entry_t {
+  const char *name; /* Macro name, block source or define name */
+  const char *kind; /* "call", "block" or "define" */
+  uint64_t calls;   /* Times expanded */
+  uint64_t lua_ns;  /* Time running Lua */
+  uint64_t lex_ns;  /* Time lexing the expansion */
+  uint64_t tokens;  /* Tokens expanded to */
+} qprep_profile_entry_t;
+
+/**
+ * @brief Start or stop profiling macro expansion.
+ *
+ * @param ctx Preprocessor context.
+ * @param enabled Whether to profile from now on.
+ *
+ * @note Profiling is off by default. Stopping keeps what was recorded so far.
+ * @note This function is thread-safe.
+ */
+void qprep_set_profiling(qlex_t *ctx, bool enabled);
+
+/**
+ * @brief Get the macro profile of a preprocessor context.
+ *
+ * @param ctx Preprocessor context.
+ * @param[out] entries Entries ordered by time spent, the most first.
+ *
+ * @return The number of entries.
+ * @warning Don't free the entries. They stay valid until the next call or until the context is
+ * freed.
+ * @note This function is thread-safe.
+ */
+size_t qprep_get_profile(qlex_t *ctx, const qprep_profile_entry_t **entries);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <core/Defines.hh>
+#include <utility>
+
+void DefineTable::rebuild(size_t capacity) {
+  m_slots.assign(capacity, 0);
+  m_bloom.fill(0);
+
+  size_t mask = capacity - 1;
+
+  for (size_t e = 0; e < m_entries.size(); e++) {
+    size_t i = mix(m_entries[e].id) & mask;
+    while (m_slots[i] != 0) {
+      i = (i + 1) & mask;
+    }
+    m_slots[i] = e + 1;
+
+    size_t bit = mix(m_entries[e].id) % BLOOM_BITS;
+    m_bloom[bit / 64] |= 1ULL << (bit % 64);
+  }
+}
+
+void DefineTable::set(qlex_size id, std::string_view name, std::string_view value) {
+  if (!m_slots.empty()) {
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = mix(id) & mask; m_slots[i] != 0; i = (i + 1) & mask) {
+      Entry &entry = m_entries[m_slots[i] - 1];
+      if (entry.id == id) {
+        entry.value = value;
+        return;
+      }
+    }
+  }
+
+  m_entries.push_back({id, std::string(name), std::string(value)});
+
+  /* Kept at most half full, so that probe runs stay short */
+  if (m_entries.size() * 2 > m_slots.size()) {
+    rebuild(std::max<size_t>(m_slots.size() * 2, 16));
+    return;
+  }
+
+  size_t mask = m_slots.size() - 1;
+  size_t i = mix(id) & mask;
+  while (m_slots[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  m_slots[i] = m_entries.size();
+
+  size_t bit = mix(id) % BLOOM_BITS;
+  m_bloom[bit / 64] |= 1ULL << (bit % 64);
+}
+
+void DefineTable::erase(qlex_size id) {
+  for (size_t e = 0; e < m_entries.size(); e++) {
+    if (m_entries[e].id == id) {
+      if (e + 1 != m_entries.size()) {
+        m_entries[e] = std::move(m_entries.back());
+      }
+      m_entries.pop_back();
+
+      /* Undefining is rare; rebuilding also clears the filter bit */
+      rebuild(m_slots.size());
+      return;
+    }
+  }
+}
+
+void DefineTable::rekey(const std::function<qlex_size(std::string_view)> &intern) {
+  for (auto &entry : m_entries) {
+    entry.id = intern(entry.name);
+  }
+
+  if (!m_slots.empty()) {
+    rebuild(m_slots.size());
+  }
+}
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __QPREP_CORE_DEFINES_HH__
+#define __QPREP_CORE_DEFINES_HH__
+
+#include <quix-lexer/Token.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The preprocessor's own copy of the `def.` namespace, keyed by the
+ * interned id of the name, so that an identifier is checked without building
+ * a key string or taking the environment lock. A small bloom filter rejects
+ * most identifiers before the table is probed. Not thread-safe; every
+ * preprocessor owns one.
+ */
+class DefineTable {
+  static constexpr size_t BLOOM_BITS = 4096;
+
+  struct Entry {
+    qlex_size id;
+    std::string name;
+    std::string value;
+  };
+
+  std::vector<Entry> m_entries;
+  std::vector<uint32_t> m_slots; /* Entry index + 1; zero marks an empty slot */
+  std::array<uint64_t, BLOOM_BITS / 64> m_bloom{};
+
+  static size_t mix(qlex_size id) { return (id * 0x9E3779B1u) >> 7; }
+
+  void rebuild(size_t capacity);
+
+public:
+  const std::string *find(qlex_size id) const {
+    size_t bit = mix(id) % BLOOM_BITS;
+    if (!(m_bloom[bit / 64] & (1ULL << (bit % 64)))) [[likely]] {
+      return nullptr;
+    }
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = mix(id) & mask;; i = (i + 1) & mask) {
+      uint32_t slot = m_slots[i];
+      if (slot == 0) {
+        return nullptr;
+      }
+      if (m_entries[slot - 1].id == id) {
+        return &m_entries[slot - 1].value;
+      }
+    }
+  }
+
+  void set(qlex_size id, std::string_view name, std::string_view value);
+  void erase(qlex_size id);
+
+  /* Re-key every entry after the names were moved to another interner */
+  void rekey(const std::function<qlex_size(std::string_view)> &intern);
+
+  size_t size() const { return m_entries.size(); }
+};
+
+#endif  // __QPREP_CORE_DEFINES_HH__
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <core/Preprocess.hh>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+  struct ImportKey {
+    qprep_fetch_module_t fetch;
+    uintptr_t any;
+    std::string name;
+
+    bool operator==(const ImportKey &o) const {
+      return fetch == o.fetch && any == o.any && name == o.name;
+    }
+  };
+
+  struct ImportKeyHash {
+    size_t operator()(const ImportKey &k) const {
+      size_t h = std::hash<std::string>{}(k.name);
+      h ^= std::hash<uintptr_t>{}((uintptr_t)k.fetch) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+      h ^= std::hash<uintptr_t>{}(k.any) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+}  // namespace
+
+static std::mutex g_import_mutex;
+static std::unordered_map<ImportKey, ImportCache::Module, ImportKeyHash> g_by_name;
+static std::unordered_multimap<size_t, ImportCache::Module> g_by_hash;
+
+const LexedText &ImportedModule::tokens(qcore_env_t env) {
+  std::call_once(m_lexed_once, [&]() { m_lexed = lex_text(body, "<import>", env); });
+  return m_lexed;
+}
+
+ImportCache::Module ImportCache::find(qprep_fetch_module_t fetch, uintptr_t any,
+                                      std::string_view name) {
+  std::lock_guard<std::mutex> lock(g_import_mutex);
+
+  auto it = g_by_name.find({fetch, any, std::string(name)});
+  return it == g_by_name.end() ? nullptr : it->second;
+}
+
+ImportCache::Module ImportCache::insert(qprep_fetch_module_t fetch, uintptr_t any,
+                                        std::string_view name, std::string &&body) {
+  size_t hash = std::hash<std::string_view>{}(body);
+  ImportKey key{fetch, any, std::string(name)};
+
+  std::lock_guard<std::mutex> lock(g_import_mutex);
+
+  /* Two preprocessors may have fetched the same module at once */
+  if (auto it = g_by_name.find(key); it != g_by_name.end()) {
+    return it->second;
+  }
+
+  Module module;
+
+  auto [begin, end] = g_by_hash.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    if (it->second->body == body) {
+      module = it->second;
+      break;
+    }
+  }
+
+  if (!module) {
+    module = std::make_shared<ImportedModule>(std::move(body), hash);
+    g_by_hash.emplace(hash, module);
+  }
+
+  g_by_name.emplace(std::move(key), module);
+
+  return module;
+}
+
+void ImportCache::clear() {
+  std::lock_guard<std::mutex> lock(g_import_mutex);
+
+  /* Preprocessors still holding a module keep it alive */
+  g_by_name.clear();
+  g_by_hash.clear();
+}
@@ -34,6 +34,7 @@
 #include <quix-prep/Lib.h>
 
 #include <atomic>
+#include <core/Preprocess.hh>
 
 #include "core/LibMacro.h"
 
@@ -46,7 +47,13 @@ static std::atomic<size_t> qprep_lib_ref_count = 0;
 
 bool do_init() { return true; }
 
-void do_deinit() { return; }
+void do_deinit() {
+  /* Pooled Lua states, fetched modules and memoized expansions are not needed
+   * past the last user */
+  StatePool::clear();
+  ImportCache::clear();
+  MemoCache::clear();
+}
 
 LIB_EXPORT bool qprep_lib_init() {
   if (qprep_lib_ref_count++ > 1) {
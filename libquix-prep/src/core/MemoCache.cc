@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <quix-core/Cache.h>
+
+#include <algorithm>
+#include <core/Preprocess.hh>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* Beyond this many expansions, new ones are still persisted but not kept in
+ * memory, so that distinct argument texts cannot grow the process without
+ * bound. */
+#define MAX_MEMO_ENTRIES 65536
+
+#define MEMO_MAGIC 0x4f4d4551 /* "QEMO" */
+#define MEMO_VERSION 2
+#define MEMO_BOM 0x01020304
+
+namespace {
+  struct MemoKey {
+    qcore_cache_key_t key;
+
+    bool operator==(const MemoKey &o) const {
+      return memcmp(key.key, o.key.key, sizeof(key.key)) == 0;
+    }
+  };
+
+  struct MemoKeyHash {
+    size_t operator()(const MemoKey &k) const {
+      /* The key is a digest already */
+      size_t h;
+      memcpy(&h, k.key.key, sizeof(h));
+      return h;
+    }
+  };
+
+  struct MemoHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bom;
+    uint32_t count;
+  };
+
+  /* Each token is followed by the length of its string and the string */
+  std::string encode(const LexedText &tokens) {
+    std::string out;
+
+    MemoHeader header{MEMO_MAGIC, MEMO_VERSION, MEMO_BOM, (uint32_t)tokens.size()};
+    out.append((const char *)&header, sizeof(header));
+
+    for (const auto &[tok, str] : tokens) {
+      uint32_t len = str.size();
+      out.append((const char *)&tok, QLEX_TOK_SIZE);
+      out.append((const char *)&len, sizeof(len));
+      out.append(str);
+    }
+
+    return out;
+  }
+
+  bool decode(std::string_view image, LexedText &tokens) {
+    MemoHeader header;
+    if (image.size() < sizeof(header)) {
+      return false;
+    }
+
+    memcpy(&header, image.data(), sizeof(header));
+    image.remove_prefix(sizeof(header));
+
+    if (header.magic != MEMO_MAGIC || header.version != MEMO_VERSION || header.bom != MEMO_BOM) {
+      return false;
+    }
+
+    tokens.clear();
+    tokens.reserve(std::min<size_t>(header.count, image.size() / QLEX_TOK_SIZE));
+
+    for (uint32_t i = 0; i < header.count; i++) {
+      LexedToken tok;
+      uint32_t len;
+
+      if (image.size() < QLEX_TOK_SIZE + sizeof(len)) {
+        return false;
+      }
+
+      memcpy(&tok.tok, image.data(), QLEX_TOK_SIZE);
+      memcpy(&len, image.data() + QLEX_TOK_SIZE, sizeof(len));
+      image.remove_prefix(QLEX_TOK_SIZE + sizeof(len));
+
+      /* The end of file is never stored; it ends the lexing of an expansion */
+      if (tok.tok.ty <= qEofF || tok.tok.ty > qNote || image.size() < len) {
+        return false;
+      }
+
+      tok.str = image.substr(0, len);
+      image.remove_prefix(len);
+
+      tokens.push_back(std::move(tok));
+    }
+
+    return image.empty();
+  }
+}  // namespace
+
+static std::mutex g_memo_mutex;
+static std::unordered_map<MemoKey, MemoCache::Expansion, MemoKeyHash> g_memo;
+
+static void remember(const qcore_cache_key_t &key, MemoCache::Expansion expansion) {
+  std::lock_guard<std::mutex> lock(g_memo_mutex);
+
+  if (g_memo.size() < MAX_MEMO_ENTRIES) {
+    g_memo.emplace(MemoKey{key}, std::move(expansion));
+  }
+}
+
+MemoCache::Expansion MemoCache::find(const qcore_cache_key_t &key) {
+  {
+    std::lock_guard<std::mutex> lock(g_memo_mutex);
+
+    if (auto it = g_memo.find(MemoKey{key}); it != g_memo.end()) {
+      return it->second;
+    }
+  }
+
+  if (!qcore_cache_bound()) {
+    return nullptr;
+  }
+
+  int64_t size = qcore_cache_has(&key);
+  if (size < 0) {
+    return nullptr;
+  }
+
+  std::string image(size, '\0');
+  LexedText tokens;
+  if (!qcore_cache_read(&key, image.data(), image.size()) || !decode(image, tokens)) {
+    return nullptr;
+  }
+
+  auto expansion = std::make_shared<const LexedText>(std::move(tokens));
+  remember(key, expansion);
+
+  return expansion;
+}
+
+void MemoCache::insert(const qcore_cache_key_t &key, LexedText &&tokens) {
+  /* Locations index the table of the lexer that produced them, which means
+   * nothing to the one replaying them; the call site is used instead */
+  for (auto &[tok, str] : tokens) {
+    tok.start = tok.end = {};
+  }
+
+  if (qcore_cache_bound()) {
+    std::string image = encode(tokens);
+    qcore_cache_write(&key, image.data(), image.size());
+  }
+
+  remember(key, std::make_shared<const LexedText>(std::move(tokens)));
+}
+
+void MemoCache::clear() {
+  std::lock_guard<std::mutex> lock(g_memo_mutex);
+
+  /* Preprocessors still replaying an expansion keep it alive */
+  g_memo.clear();
+}
@@ -36,14 +36,19 @@
 #include <quix-lexer/Token.h>
 #include <quix-prep/Lib.h>
 
+
+#include <algorithm>
 #include <core/Preprocess.hh>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <new>
 #include <optional>
 #include <qcall/List.hh>
 #include <quix-lexer/Base.hh>
+#include <string>
 #include <string_view>
+#include <utility>
 
 #include "LibMacro.h"
 
@@ -55,14 +60,69 @@ extern "C" {
 
 using namespace qcall;
 
-#define MAX_RECURSION_DEPTH 10000
+/* Expansions of expansions nested deeper than this are taken to be runaway */
+#define MAX_EXPANSION_DEPTH 10000
+
+/* Beyond this many chunks of one kind, new chunks are compiled and run
+ * without being kept, so that distinct call texts cannot grow the Lua
+ * registry without bound. */
+#define MAX_CACHED_CHUNKS 8192
+
+///=============================================================================
+
+void TokenQueue::grow(size_t min_size) {
+  size_t cap = std::max<size_t>(m_ring.size(), 16);
+  while (cap < min_size) {
+    cap *= 2;
+  }
+
+  std::vector<qlex_tok_t> ring(cap);
+  for (size_t i = 0; i < m_size; i++) {
+    ring[i] = m_ring[(m_head + i) & (m_ring.size() - 1)];
+  }
+
+  m_ring = std::move(ring);
+  m_head = 0;
+}
+
+void TokenQueue::push_front(const qlex_tok_t *tokens, size_t count, uint32_t depth) {
+  if (count == 0) {
+    return;
+  }
+
+  m_frames.push_back({count, depth});
+
+  if (m_size + count > m_ring.size()) {
+    grow(m_size + count);
+  }
+
+  size_t mask = m_ring.size() - 1;
+  m_head = (m_head - count) & mask;
+  m_size += count;
+
+  /* The run may wrap around the end of the ring */
+  size_t first = std::min(count, m_ring.size() - m_head);
+  std::copy(tokens, tokens + first, m_ring.begin() + m_head);
+  std::copy(tokens + first, tokens + count, m_ring.begin());
+}
 
 ///=============================================================================
 
 qprep_impl_t::Core::~Core() {
-  if (L) {
+  if (!L) {
+    return;
+  }
+
+  for (int ref : refs) {
+    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+  }
+
+  if (poisoned || snapshot == 0) {
     lua_close(L);
+    return;
   }
+
+  StatePool::release({L, snapshot, std::move(chunks)});
 }
 
 static std::string_view ltrim(std::string_view s) {
@@ -75,242 +135,495 @@ static std::string_view rtrim(std::string_view s) {
   return s;
 }
 
+static std::string_view trim(std::string_view s) { return rtrim(ltrim(s)); }
+
+static bool is_ident_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* Whether Lua argument text names nothing but table fields, so that it means
+ * the same wherever it is evaluated. Long strings and comments count as not. */
+static bool is_literal_args(std::string_view args) {
+  size_t i = 0;
+
+  while (i < args.size()) {
+    char c = args[i];
+
+    if (c == '\'' || c == '"') { /* Skip a quoted string */
+      for (i++; i < args.size() && args[i] != c; i++) {
+        if (args[i] == '\\') {
+          i++;
+        }
+      }
+      i++;
+      continue;
+    }
+
+    if (c == '[' && i + 1 < args.size() && (args[i + 1] == '[' || args[i + 1] == '=')) {
+      return false;
+    }
+
+    if (c == '-' && i + 1 < args.size() && args[i + 1] == '-') {
+      return false;
+    }
+
+    if (!is_ident_char(c)) {
+      i++;
+      continue;
+    }
+
+    size_t begin = i;
+    while (i < args.size() && (is_ident_char(args[i]) || (args[begin] <= '9' && args[i] == '.'))) {
+      i++;
+    }
+
+    std::string_view word = args.substr(begin, i - begin);
+    if (word[0] <= '9' || word == "true" || word == "false" || word == "nil") {
+      continue;
+    }
+
+    /* A field name in a table constructor */
+    size_t next = args.find_first_not_of(" \t\n\r", i);
+    if (next == std::string_view::npos || args[next] != '=' ||
+        (next + 1 < args.size() && args[next + 1] == '=')) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+DeferList::Handle DeferList::install(DeferFn fn, uintptr_t data) {
+  m_live++;
+
+  /* During a pass, new handlers go after the slots it has yet to visit */
+  if (m_running == 0) {
+    for (size_t i = 0; i < m_slots.size(); i++) {
+      if (!m_slots[i].fn) {
+        m_slots[i] = {fn, data, false};
+        return i;
+      }
+    }
+  }
+
+  m_slots.push_back({fn, data, false});
+  return m_slots.size() - 1;
+}
+
+void DeferList::uninstall(Handle handle) {
+  if (m_slots[handle].fn) {
+    m_slots[handle] = {};
+    m_live--;
+  }
+
+  trim();
+}
+
+void DeferList::trim() {
+  while (m_running == 0 && !m_slots.empty() && !m_slots.back().fn) {
+    m_slots.pop_back();
+  }
+}
+
 bool qprep_impl_t::run_defer_callbacks(qlex_tok_t last) {
   /**
-   * @brief We do it this way because the callback could potentially modify the
-   * `defer_callbacks` vector, which would invalidate the iterator.
-   * The callback is able to instruct us to keep it around for the next token or to
-   * remove it.
-   *
-   * The callback is able to consume and emit token sequences, which may result in this
-   * `run_defer_callbacks` function being called recursively.
-   *
-   * So like, if any of the callbacks says to emit a token, we should emit a token. Otherwise,
-   * we should not emit a token.
+   * @brief The token is emitted if any handler asks for it, or if no handler
+   * ran. Handlers run newest first, and those installed meanwhile run after
+   * them, for this token too. A handler may consume and emit tokens, so this
+   * can be reentered for another token while a handler runs; that handler is
+   * skipped by the nested pass.
    */
 
-  std::vector<DeferCallback> saved;
-  saved.reserve(m_core->defer_callbacks.size());
-  bool emit_token = m_core->defer_callbacks.empty();
+  DeferList &list = m_core->defers;
+  if (list.empty()) {
+    return true;
+  }
+
+  bool emit_token = true, ran = false;
+  size_t end = 0;
 
-  while (!m_core->defer_callbacks.empty()) {
-    DeferCallback cb = m_core->defer_callbacks.back();
-    m_core->defer_callbacks.pop_back();
+  list.m_running++;
 
-    DeferOp op = cb(this, last);
-    if (op != DeferOp::UninstallHandler) {
-      saved.push_back(cb);
-    }
-    if (op == DeferOp::EmitToken) {
-      emit_token = true;
+  while (end < list.m_slots.size()) {
+    size_t begin = end;
+    end = list.m_slots.size();
+
+    for (size_t i = end; i-- > begin;) {
+      /* Handlers may install others, which can move the slots */
+      DeferHandler handler = list.m_slots[i];
+      if (!handler.fn || handler.busy) {
+        continue;
+      }
+
+      if (!ran) {
+        ran = true;
+        emit_token = false;
+      }
+
+      list.m_slots[i].busy = true;
+
+      DeferOp op;
+      try {
+        op = handler.fn(this, last, handler.data);
+      } catch (...) {
+        list.m_slots[i].busy = false;
+        list.m_running--;
+        throw;
+      }
+
+      list.m_slots[i].busy = false;
+
+      if (op == DeferOp::UninstallHandler) {
+        list.uninstall(i);
+      } else if (op == DeferOp::EmitToken) {
+        emit_token = true;
+      }
     }
   }
 
-  m_core->defer_callbacks = saved;
+  list.m_running--;
+  list.trim();
 
   return emit_token;
 }
 
-std::optional<std::string> qprep_impl_t::run_lua_code(const std::string &s) {
-  int before_size = lua_gettop(m_core->L);
+bool qprep_impl_t::push_chunk(std::string_view code, ChunkKind kind) {
+  /**
+   * @brief Compiling is by far the most expensive part of running a small
+   * macro, and the same macro tends to be invoked over and over. Each chunk
+   * is therefore compiled once per Lua state and kept in the registry, from
+   * where later invocations fetch the function directly.
+   */
+
+  lua_State *L = m_core->L;
+  ChunkCache &cache = m_core->chunks[(size_t)kind];
+
+  if (auto it = cache.find(code); it != cache.end()) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, it->second);
+    return true;
+  }
+
+  std::string chunk;
+  switch (kind) {
+    case ChunkKind::Block:
+      chunk = code;
+      break;
+    case ChunkKind::Call:
+      chunk = "return " + std::string(code);
+      break;
+    case ChunkKind::BareCall:
+      chunk = "return " + std::string(code) + "()";
+      break;
+    case ChunkKind::Count:
+      __builtin_unreachable();
+  }
+
+  /* Named after its source, as `luaL_dostring` would */
+  if (luaL_loadbuffer(L, chunk.data(), chunk.size(), chunk.c_str()) != LUA_OK) {
+    return false;
+  }
+
+  if (cache.size() < MAX_CACHED_CHUNKS) {
+    lua_pushvalue(L, -1);
+    cache.emplace(code, luaL_ref(L, LUA_REGISTRYINDEX));
+  }
+
+  return true;
+}
+
+std::optional<std::string> qprep_impl_t::run_lua_code(std::string_view code, ChunkKind kind) {
+  lua_State *L = m_core->L;
+  int before_size = lua_gettop(L);
 
-  int error = luaL_dostring(m_core->L, std::string(s.data(), s.size()).c_str());
-  if (error) {
-    qcore_print(QCORE_ERROR, "Failed to run Lua code: %s\n", lua_tostring(m_core->L, -1));
+  if (!push_chunk(code, kind) || lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK) {
+    qcore_print(QCORE_ERROR, "Failed to run Lua code: %s\n", lua_tostring(L, -1));
+    lua_settop(L, before_size);
     return std::nullopt;
   }
 
-  if (lua_gettop(m_core->L) == before_size) {
-    return "";
-  } else if (lua_isnil(m_core->L, -1)) {
-    return "";
-  } else if (lua_isstring(m_core->L, -1)) {
-    return lua_tostring(m_core->L, -1);
-  } else if (lua_isnumber(m_core->L, -1)) {
-    return std::to_string(lua_tonumber(m_core->L, -1));
-  } else if (lua_isboolean(m_core->L, -1)) {
-    return lua_toboolean(m_core->L, -1) ? "true" : "false";
-  } else {
-    return std::nullopt;
+  std::optional<std::string> result;
+
+  if (lua_gettop(L) == before_size) {
+    result = "";
+  } else if (lua_isnil(L, -1)) {
+    result = "";
+  } else if (lua_isstring(L, -1)) {
+    result = lua_tostring(L, -1);
+  } else if (lua_isnumber(L, -1)) {
+    result = std::to_string(lua_tonumber(L, -1));
+  } else if (lua_isboolean(L, -1)) {
+    result = lua_toboolean(L, -1) ? "true" : "false";
   }
+
+  /* Drop the results so that the stack does not grow with every macro */
+  lua_settop(L, before_size);
+
+  return result;
 }
 
 void qprep_impl_t::expand_raw(std::string_view code) {
-  FILE *resbuf = fmemopen((void *)code.data(), code.size(), "r");
-  if (resbuf == nullptr) {
-    qcore_panic("qprep_impl_t::next_impl: failed to create a memory buffer");
+  /**
+   * @brief The text is lexed in place by a lexer kept for the purpose, so
+   * expanding creates no lexer and, once the tables are warm, allocates
+   * nothing beyond new strings. The tokens are not expanded here; they are
+   * queued and go through `next_impl` like any other token.
+   *
+   * While a macro runs, its output is held back rather than queued, so that
+   * what it emits and then returns ends up ahead of the remaining input in
+   * the order it was produced, and `quix.next()` keeps reading the input.
+   */
+
+  Core &core = *m_core;
+  qlex_t *span = core.span.get();
+  MacroProfile::Time start;
+  if (core.profiling) {
+    start = MacroProfile::now();
   }
 
-  {
-    qlex_t *clone = weak_clone(resbuf, m_filename);
+  if (span->m_strings != m_strings) {
+    span->replace_interner(m_strings);
+  }
+  span->m_flags = m_flags;
+  span->rebind(code);
 
-    qlex_tok_t tok;
-    std::vector<qlex_tok_t> tokens;
-    while ((tok = qlex_next(clone)).ty != qEofF) {
-      tokens.push_back(tok);
+  size_t mark = core.output.size();
+
+  qlex_tok_t tok;
+  while ((tok = span->next()).ty != qEofF) {
+    core.output.push_back(tok);
+  }
+
+  if (core.profiling) {
+    core.profiling->lexed(start, core.output.size() - mark);
+  }
+
+  if (!core.capturing) {
+    flush_output(mark);
+  }
+}
+
+void qprep_impl_t::flush_output(size_t mark) {
+  Core &core = *m_core;
+
+  core.queue.push_front(core.output.data() + mark, core.output.size() - mark, core.depth + 1);
+  core.output.resize(mark);
+}
+
+bool qprep_impl_t::run_and_expand(std::string_view code, ChunkKind kind) {
+  Core &core = *m_core;
+  size_t mark = core.output.size();
+  bool was_capturing = std::exchange(core.capturing, true);
+
+  std::optional<std::string> res;
+  try {
+    res = run_lua_code(code, kind);
+  } catch (...) {
+    core.capturing = was_capturing;
+    throw;
+  }
+
+  if (res.has_value()) {
+    expand_raw(*res);
+  }
+
+  /* The outermost macro queues the output of any nested ones with its own */
+  core.capturing = was_capturing;
+  if (!was_capturing) {
+    flush_output(mark);
+  }
+
+  return res.has_value();
+}
+
+bool qprep_impl_t::run_block(std::string_view block) {
+  block = ltrim(block);
+
+  /* `pure fn name(...) { ... }` defines a macro and marks it pure */
+  bool pure = block.starts_with("pure fn ");
+  if (pure) {
+    block = ltrim(block.substr(5));
+  }
+
+  if (!block.starts_with("fn ")) {
+    if (!run_and_expand(block)) {
+      qcore_print(QCORE_ERROR, "Failed to expand macro block: %s\n", block.data());
+      return false;
     }
 
-    qlex_free(clone);
+    return true;
+  }
+
+  block = ltrim(block.substr(3));
+  size_t pos = block.find_first_of("(");
+  if (pos == std::string_view::npos) {
+    qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
+    return false;
+  }
 
-    for (auto it = tokens.rbegin(); it != tokens.rend(); it++) {
-      m_core->buffer.push_front(*it);
+  std::string_view name = rtrim(block.substr(0, pos));
+  std::string code = "function " + std::string(name) + std::string(block.substr(pos));
+
+  { /* Remove the opening brace */
+    pos = code.find_first_of("{");
+    if (pos == std::string::npos) {
+      qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
+      return false;
     }
+    code.erase(pos, 1);
   }
 
-  fclose(resbuf);
-}
+  { /* Remove the closing brace */
+    pos = code.find_last_of("}");
+    if (pos == std::string::npos) {
+      qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
+      return false;
+    }
+    code.erase(pos, 1);
+    code.insert(pos, "end");
+  }
 
-bool qprep_impl_t::run_and_expand(const std::string &code) {
-  auto res = run_lua_code(code);
-  if (!res.has_value()) {
+  if (!run_and_expand(code)) {
+    qcore_print(QCORE_ERROR, "Failed to expand macro function: %s\n", name.data());
     return false;
   }
 
-  expand_raw(*res);
+  if (pure && !mark_pure(name)) {
+    qcore_print(QCORE_ERROR, "Failed to mark macro function as pure: %s\n", name.data());
+    return false;
+  }
 
   return true;
 }
 
-class RecursiveGuard {
-  size_t &m_depth;
+namespace {
+  /* Times one expansion, when profiling */
+  class ProfileScope {
+    MacroProfile *m_profile;
 
-public:
-  RecursiveGuard(size_t &depth) : m_depth(depth) { m_depth++; }
-  ~RecursiveGuard() { m_depth--; }
+  public:
+    ProfileScope(MacroProfile *profile, MacroProfile::Kind kind, std::string_view name)
+        : m_profile(profile) {
+      if (m_profile) {
+        m_profile->enter(kind, name);
+      }
+    }
 
-  bool should_stop() { return m_depth >= MAX_RECURSION_DEPTH; }
-};
+    ~ProfileScope() {
+      if (m_profile) {
+        m_profile->leave();
+      }
+    }
+  };
+}  // namespace
 
 CPP_EXPORT qlex_tok_t qprep_impl_t::next_impl() {
+  /**
+   * @brief Expanding a token queues what it expands to, and the loop goes on
+   * with the front of the queue; skipped tokens are passed over the same
+   * way. How deeply expansions nest is tracked by the queue, so neither
+   * depends on the call stack. The loop is only reentered by macros and
+   * handlers that read tokens themselves.
+   */
+
+  Core &core = *m_core;
+  uint32_t outer_depth = core.depth;
   qlex_tok_t x{};
 
   try {
-    RecursiveGuard guard(m_depth);
-    if (guard.should_stop()) {
-      qcore_print(QCORE_FATAL, "Maximum macro recursion depth reached\n");
-      throw StopException();
-    }
-
-    if (!m_core->buffer.empty()) {
-      x = m_core->buffer.front();
-      m_core->buffer.pop_front();
-    } else {
-      x = qlex_t::next_impl();
-    }
+    while (true) {
+      if (!core.queue.empty()) {
+        x = core.queue.pop_front(core.depth);
+      } else {
+        core.depth = 0;
+        x = qlex_t::next_impl();
+      }
 
-    if (m_do_expanse) {
-      switch (x.ty) {
-        case qEofF:
-          return x;
-        case qErro:
-        case qKeyW:
-        case qIntL:
-        case qText:
-        case qChar:
-        case qNumL:
-        case qOper:
-        case qPunc:
-        case qNote: {
-          goto emit_token;
-        }
+      if (m_do_expanse) {
+        switch (x.ty) {
+          case qEofF:
+            core.depth = outer_depth;
+            return x;
+
+          case qErro:
+          case qKeyW:
+          case qIntL:
+          case qText:
+          case qChar:
+          case qNumL:
+          case qOper:
+          case qPunc:
+          case qNote:
+            break;
+
+          case qName: { /* Handle the expansion of defines */
+            const std::string *value = core.defines.find(x.v.str_idx);
+            if (value == nullptr) {
+              break;
+            }
 
-        case qName: { /* Handle the expansion of defines */
-          std::string key = "def." + std::string(get_string(x.v.str_idx));
+            check_depth();
 
-          const char *value = qcore_env_get(key.c_str());
-          if (value == nullptr) {
-            goto emit_token;
+            ProfileScope scope(core.profiling, MacroProfile::Kind::Define,
+                               get_string(x.v.str_idx));
+            expand_raw(*value);
+            continue;
           }
 
-          expand_raw(value);
-          return this->next_impl();
-        }
+          case qMacB: {
+            check_depth();
 
-        case qMacB: {
-          std::string_view block = ltrim(get_string(x.v.str_idx));
-          if (!block.starts_with("fn ")) {
-            if (!run_and_expand(std::string(block))) {
-              qcore_print(QCORE_ERROR, "Failed to expand macro block: %s\n", block.data());
+            std::string_view block = get_string(x.v.str_idx);
+            ProfileScope scope(core.profiling, MacroProfile::Kind::Block, trim(block));
+            if (!run_block(block)) {
               x.ty = qErro;
-              goto emit_token;
-            }
-          } else {
-            block = ltrim(block.substr(3));
-            size_t pos = block.find_first_of("(");
-            if (pos == std::string_view::npos) {
-              qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
-              x.ty = qErro;
-              goto emit_token;
-            }
-
-            std::string_view name = rtrim(block.substr(0, pos));
-            std::string code = "function " + std::string(name) + std::string(block.substr(pos));
-
-            { /* Remove the opening brace */
-              pos = code.find_first_of("{");
-              if (pos == std::string::npos) {
-                qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
-                x.ty = qErro;
-                goto emit_token;
-              }
-              code.erase(pos, 1);
-            }
-
-            { /* Remove the closing brace */
-              pos = code.find_last_of("}");
-              if (pos == std::string::npos) {
-                qcore_print(QCORE_ERROR, "Invalid macro function definition: %s\n", block.data());
-                x.ty = qErro;
-                goto emit_token;
-              }
-              code.erase(pos, 1);
-              code.insert(pos, "end");
+              break;
             }
 
-            if (!run_and_expand(code)) {
-              qcore_print(QCORE_ERROR, "Failed to expand macro function: %s\n", name.data());
-              x.ty = qErro;
-              goto emit_token;
-            }
+            continue;
           }
 
-          return this->next_impl();
-        }
-
-        case qMacr: {
-          std::string_view body = get_string(x.v.str_idx);
+          case qMacr: {
+            check_depth();
 
-          size_t pos = body.find_first_of("(");
-          if (pos != std::string_view::npos) {
-            if (!run_and_expand("return " + std::string(body))) {
-              qcore_print(QCORE_ERROR, "Failed to expand macro function: %s\n", body.data());
-              x.ty = qErro;
-              goto emit_token;
-            }
+            std::string_view body = get_string(x.v.str_idx);
 
-            return this->next_impl();
-          } else {
-            if (!run_and_expand("return " + std::string(body) + "()")) {
+            ProfileScope scope(core.profiling, MacroProfile::Kind::Call,
+                               trim(body.substr(0, body.find_first_of("("))));
+            if (!run_call(body, x)) {
               qcore_print(QCORE_ERROR, "Failed to expand macro function: %s\n", body.data());
               x.ty = qErro;
-              goto emit_token;
+              break;
             }
 
-            return this->next_impl();
+            continue;
           }
         }
       }
-    }
 
-  emit_token:
-    if (!m_do_expanse || run_defer_callbacks(x)) { /* Emit the token */
-      return x;
-    } else { /* Skip the token */
-      return this->next_impl();
+      if (!m_do_expanse || run_defer_callbacks(x)) { /* Emit the token */
+        core.depth = outer_depth;
+        return x;
+      }
     }
   } catch (StopException &) {
+    /* The exception may have unwound through Lua frames */
+    core.poisoned = true;
+    core.depth = outer_depth;
+
     x.ty = qEofF;
     return x;
+  } catch (...) {
+    /* The end of the source is signalled by an exception from the lexer, so
+     * a macro reading ahead must get its own depth back */
+    core.depth = outer_depth;
+    throw;
+  }
+}
+
+void qprep_impl_t::check_depth() {
+  if (m_core->depth >= MAX_EXPANSION_DEPTH) {
+    qcore_print(QCORE_FATAL, "Maximum macro recursion depth reached\n");
+    throw StopException();
   }
 }
 
@@ -326,31 +639,339 @@ void qprep_impl_t::install_lua_api() {
   lua_setglobal(m_core->L, "quix");
 }
 
-qlex_t *qprep_impl_t::weak_clone(FILE *file, const char *filename) {
-  qprep_impl_t *clone = new qprep_impl_t(file, filename, m_env);
+void qprep_impl_t::set_define(std::string_view name, const char *value) {
+  qlex_size id = put_string(name);
+  if (id == UINT32_MAX) {
+    return;
+  }
+
+  if (value) {
+    m_core->defines.set(id, name, value);
+  } else {
+    m_core->defines.erase(id);
+  }
+}
+
+CPP_EXPORT void qprep_impl_t::replace_interner(std::shared_ptr<Interner> new_interner) {
+  qlex_t::replace_interner(new_interner);
+
+  /* Defines are keyed by interned id, which differs between interners */
+  m_core->defines.rekey([this](std::string_view name) { return put_string(name); });
+}
 
-  clone->m_core = m_core;
-  clone->replace_interner(m_strings);
-  clone->m_flags = m_flags;
-  clone->m_depth = m_depth + 1;
+void qprep_impl_t::bind_lua_api() {
+  /* The API functions carry the engine they act on as an upvalue */
+  lua_getglobal(m_core->L, "quix");
+
+  for (const auto &qcall : qsyscalls) {
+    lua_getfield(m_core->L, -1, qcall.getName().data());
+    if (lua_tocfunction(m_core->L, -1) == qcall.getFunc()) {
+      lua_pushinteger(m_core->L, (lua_Integer)(uintptr_t)this);
+      lua_setupvalue(m_core->L, -2, 1);
+    }
+    lua_pop(m_core->L, 1);
+  }
 
-  return clone;
+  lua_pop(m_core->L, 1);
 }
 
-qprep_impl_t::qprep_impl_t(FILE *file, const char *filename, qcore_env_t env)
-    : qlex_t(file, filename, false, env) {
-  m_core = std::make_shared<Core>();
-  m_do_expanse = true;
-  m_depth = 0;
+namespace {
+  bool has_string(const qlex_tok_t &tok) {
+    switch (tok.ty) {
+      case qName:
+      case qIntL:
+      case qNumL:
+      case qText:
+      case qChar:
+      case qMacB:
+      case qMacr:
+      case qNote:
+        return !(tok.v.str_idx & QLEX_INT_INLINE);
+      default:
+        return false;
+    }
+  }
+
+  /* The standard prefix never changes, so it is lexed once per process */
+  const LexedText &prefix_tokens(qcore_env_t env) {
+    static const LexedText tokens = lex_text(quix_code_prefix, "<prefix>", env);
+    return tokens;
+  }
+}  // namespace
+
+LexedText lex_text(std::string_view text, const char *filename, qcore_env_t env) {
+  LexedText out;
+  qlex_t lexer(text, filename, env);
+
+  qlex_tok_t tok;
+  while ((tok = lexer.next()).ty != qEofF) {
+    out.push_back({tok, has_string(tok) ? std::string(lexer.get_string(tok.v.str_idx)) : ""});
+  }
+
+  return out;
+}
+
+void qprep_impl_t::expand_lexed(const LexedText &text, const qlex_tok_t *site) {
+  /* Like `expand_raw`, but the text was lexed beforehand. Tokens lexed
+   * elsewhere may be given the location of the `site` they expand at. */
+  Core &core = *m_core;
+  size_t mark = core.output.size();
+  MacroProfile::Time start;
+  if (core.profiling) {
+    start = MacroProfile::now();
+  }
+
+  for (const auto &[tok, str] : text) {
+    if (m_flags & QLEX_NO_COMMENTS && tok.ty == qNote) {
+      continue;
+    }
+
+    qlex_tok_t copy = tok;
+    if (has_string(copy)) {
+      copy.v.str_idx = put_string(str);
+    }
+    if (site) {
+      copy.start = site->start;
+      copy.end = site->end;
+    }
+    core.output.push_back(copy);
+  }
+
+  if (core.profiling) {
+    core.profiling->lexed(start, core.output.size() - mark);
+  }
+
+  if (!core.capturing) {
+    flush_output(mark);
+  }
+}
+
+std::vector<std::string> qprep_impl_t::peek_imports(size_t max) {
+  /**
+   * @brief The tokens read ahead are queued again at the depth of source
+   * tokens, so they are read as if they never were. Nothing is read ahead
+   * while tokens are queued, as the source does not come next then.
+   */
+
+  Core &core = *m_core;
+  std::vector<std::string> names;
+  if (!core.queue.empty()) {
+    return names;
+  }
+
+  std::vector<qlex_tok_t> read;
+  std::string name;
+  size_t matched = 0; /* Tokens matched of `@import name ;` */
+
+  while (names.size() < max) {
+    qlex_tok_t tok;
+    try {
+      tok = qlex_t::next_impl();
+    } catch (...) { /* The end of the source */
+      break;
+    }
+
+    read.push_back(tok);
+
+    if (tok.ty == qNote) {
+      continue;
+    }
+
+    if (matched == 0 && tok.ty == qMacr && trim(get_string(tok.v.str_idx)) == "import") {
+      matched = 1;
+    } else if (matched == 1 && (tok.ty == qName || tok.ty == qText)) {
+      name = get_string(tok.v.str_idx);
+      matched = 2;
+    } else if (matched == 2 && tok.ty == qPunc && tok.v.punc == qPuncSemi) {
+      names.push_back(std::move(name));
+      matched = 0;
+    } else {
+      break;
+    }
+  }
+
+  core.queue.push_front(read.data(), read.size(), 0);
+
+  return names;
+}
+
+bool qprep_impl_t::mark_pure(std::string_view name) {
+  lua_State *L = m_core->L;
+  std::string global(name);
+
+  lua_getglobal(L, global.c_str());
+  if (!lua_isfunction(L, -1) || lua_iscfunction(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+
+  /* The same definition gets the same digest in every file and process */
+  lua_Debug ar;
+  lua_pushvalue(L, -1);
+  lua_getinfo(L, ">S", &ar);
+
+  PureMacro macro;
+  if (!qcore_cache_key_digest({"quix-prep-pure", qprep_lib_version(), ar.source,
+                               std::to_string(ar.linedefined), std::to_string(ar.lastlinedefined)},
+                              &macro.digest)) {
+    lua_pop(L, 1);
+    return false;
+  }
+
+  macro.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  m_core->refs.push_back(macro.ref);
+  m_core->pure.insert_or_assign(std::move(global), macro);
+
+  return true;
+}
+
+bool qprep_impl_t::memo_key(std::string_view name, std::string_view args,
+                            qcore_cache_key_t &key) {
+  auto it = m_core->pure.find(name);
+  if (it == m_core->pure.end() || !is_literal_args(args)) {
+    return false;
+  }
+
+  /* The global may have been assigned another function since */
+  lua_State *L = m_core->L;
+  lua_getglobal(L, it->first.c_str());
+  lua_rawgeti(L, LUA_REGISTRYINDEX, it->second.ref);
+  bool same = lua_rawequal(L, -1, -2);
+  lua_pop(L, 2);
+
+  if (!same) {
+    return false;
+  }
+
+  char comments = m_flags & QLEX_NO_COMMENTS ? 0 : 1;
+  const qcore_cache_key_t &digest = it->second.digest;
+
+  return qcore_cache_key_digest(
+      {std::string_view((const char *)digest.key, sizeof(digest.key)),
+       std::string_view(&comments, 1), args},
+      &key);
+}
+
+bool qprep_impl_t::run_call(std::string_view body, const qlex_tok_t &site) {
+  /**
+   * @brief A pure macro expands to the same tokens whenever it is called
+   * with the same argument text, so those tokens are kept and replayed
+   * rather than calling Lua and lexing the result again. Replayed tokens
+   * take the location of the call they replace.
+   */
+
+  Core &core = *m_core;
+  size_t pos = body.find_first_of("(");
+  ChunkKind kind = pos != std::string_view::npos ? ChunkKind::Call : ChunkKind::BareCall;
+
+  qcore_cache_key_t key;
+  if (core.pure.empty() ||
+      !memo_key(trim(body.substr(0, pos)), kind == ChunkKind::Call ? body.substr(pos) : "",
+                key)) {
+    return run_and_expand(body, kind);
+  }
+
+  if (auto expansion = MemoCache::find(key)) {
+    expand_lexed(*expansion, &site);
+    return true;
+  }
+
+  size_t mark = core.output.size();
+  bool was_capturing = std::exchange(core.capturing, true);
+
+  bool ok;
+  try {
+    ok = run_and_expand(body, kind);
+  } catch (...) {
+    core.capturing = was_capturing;
+    throw;
+  }
+
+  core.capturing = was_capturing;
+
+  if (ok) {
+    LexedText tokens;
+    tokens.reserve(core.output.size() - mark);
+
+    for (size_t i = mark; i < core.output.size(); i++) {
+      const qlex_tok_t &tok = core.output[i];
+      tokens.push_back({tok, has_string(tok) ? std::string(get_string(tok.v.str_idx)) : ""});
+    }
+
+    MemoCache::insert(key, std::move(tokens));
+  }
+
+  if (!was_capturing) {
+    flush_output(mark);
+  }
+
+  return ok;
+}
+
+void qprep_impl_t::run_prefix(bool run_blocks) {
+  /**
+   * @brief The macro blocks of the prefix are run right away rather than
+   * queued, so that a new state can be snapshotted as the prefix leaves it.
+   * A pooled state has run them already. Anything else in the prefix is
+   * queued ahead of the source, in order with what the blocks produce.
+   */
+
+  Core &core = *m_core;
+  core.capturing = true;
+
+  for (const auto &[tok, str] : prefix_tokens(m_env)) {
+    if (tok.ty == qMacB) {
+      if (run_blocks) {
+        run_block(str);
+      }
+      continue;
+    }
+
+    qlex_tok_t copy = tok;
+    if (has_string(copy)) {
+      copy.v.str_idx = put_string(str);
+    }
+    core.output.push_back(copy);
+  }
+
+  core.capturing = false;
+  flush_output(0);
 }
 
 qprep_impl_t::qprep_impl_t(FILE *file, const char *filename, bool is_owned, qcore_env_t env)
     : qlex_t(file, filename, is_owned, env) {
   m_core = std::make_shared<Core>();
   m_do_expanse = true;
-  m_depth = 0;
 
-  { /* Create the Lua state */
+  m_core->span = std::make_unique<qlex_t>(std::string_view(), m_filename, env);
+  m_core->span->replace_interner(m_strings);
+
+  qcore_env_t old = qcore_env_current();
+  qcore_env_set_current(env);
+
+  { /* Pick up defines already in the environment, once */
+    std::vector<std::pair<std::string, std::string>> found;
+    qcore_env_foreach(
+        "def.",
+        [](const char *key, const char *value, uintptr_t any) {
+          auto *found = reinterpret_cast<std::vector<std::pair<std::string, std::string>> *>(any);
+          found->emplace_back(key + 4, value);
+        },
+        reinterpret_cast<uintptr_t>(&found));
+
+    for (const auto &[name, value] : found) {
+      set_define(name, value.c_str());
+    }
+  }
+
+  if (auto pooled = StatePool::acquire()) {
+    m_core->L = pooled->L;
+    m_core->snapshot = pooled->snapshot;
+    m_core->chunks = std::move(pooled->chunks);
+
+    bind_lua_api();
+    run_prefix(false);
+  } else { /* Create the Lua state */
     m_core->L = luaL_newstate();
 
     /* Load the special selection of standard libraries */
@@ -358,10 +979,14 @@ qprep_impl_t::qprep_impl_t(FILE *file, const char *filename, bool is_owned, qcor
 
     /* Install the QUIX API */
     install_lua_api();
+
+    // Run the standard language prefix
+    run_prefix(true);
+
+    m_core->snapshot = StatePool::snapshot(m_core->L);
   }
 
-  // Run the standard language prefix
-  expand_raw(quix_code_prefix);
+  qcore_env_set_current(old);
 }
 
 CPP_EXPORT qprep_impl_t::~qprep_impl_t() {}
@@ -383,4 +1008,46 @@ LIB_EXPORT void qprep_set_fetch_module(qlex_t *ctx, qprep_fetch_module_t fetch_f
   std::lock_guard<std::mutex> lock(obj->m_mutex);
 
   obj->m_fetch_module = {fetch_fn, any};
+  obj->m_fetch_concurrent = false;
+}
+
+LIB_EXPORT void qprep_set_fetch_module_concurrent(qlex_t *ctx, qprep_fetch_module_t fetch_fn,
+                                                  uintptr_t any) {
+  qprep_impl_t *obj = reinterpret_cast<qprep_impl_t *>(ctx);
+  std::lock_guard<std::mutex> lock(obj->m_mutex);
+
+  obj->m_fetch_module = {fetch_fn, any};
+  obj->m_fetch_concurrent = true;
+}
+
+LIB_EXPORT void qprep_clear_import_cache() { ImportCache::clear(); }
+
+LIB_EXPORT void qprep_clear_memo_cache() { MemoCache::clear(); }
+
+LIB_EXPORT void qprep_set_profiling(qlex_t *ctx, bool enabled) {
+  qprep_impl_t *obj = reinterpret_cast<qprep_impl_t *>(ctx);
+  std::lock_guard<std::mutex> lock(obj->m_mutex);
+
+  auto &core = *obj->m_core;
+  if (enabled && !core.profile) {
+    core.profile = std::make_unique<MacroProfile>();
+  }
+
+  core.profiling = enabled ? core.profile.get() : nullptr;
+}
+
+LIB_EXPORT size_t qprep_get_profile(qlex_t *ctx, const qprep_profile_entry_t **entries) {
+  qprep_impl_t *obj = reinterpret_cast<qprep_impl_t *>(ctx);
+  std::lock_guard<std::mutex> lock(obj->m_mutex);
+
+  auto &core = *obj->m_core;
+  if (!core.profile) {
+    *entries = nullptr;
+    return 0;
+  }
+
+  const auto &view = core.profile->view();
+  *entries = view.data();
+
+  return view.size();
 }
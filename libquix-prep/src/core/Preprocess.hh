@@ -29,15 +29,24 @@
 ///                                                                          ///
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <quix-core/Cache.h>
 #include <quix-core/Env.h>
 #include <quix-lexer/Token.h>
 #include <quix-prep/Preprocess.h>
 
+#include <array>
+#include <core/Defines.hh>
+#include <core/Profile.hh>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <quix-lexer/Base.hh>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #define get_engine() ((qprep_impl_t *)(uintptr_t)luaL_checkinteger(L, lua_upvalueindex(1)))
 
@@ -51,37 +60,264 @@ enum class DeferOp {
 
 struct qprep_impl_t;
 
-typedef std::function<DeferOp(qprep_impl_t *obj, qlex_tok_t last)> DeferCallback;
+typedef DeferOp (*DeferFn)(qprep_impl_t *obj, qlex_tok_t last, uintptr_t data);
+
+struct DeferHandler {
+  DeferFn fn = nullptr; /* Null in a free slot */
+  uintptr_t data = 0;
+  bool busy = false; /* Set while the handler runs, so it is not reentered */
+};
+
+/**
+ * @brief Handlers called on every token about to be emitted. Handlers live in
+ * slots that never move while they run, so a slot index is a stable handle.
+ * Checking for handlers and running them allocates nothing.
+ */
+class DeferList {
+  std::vector<DeferHandler> m_slots;
+  size_t m_live = 0;
+  size_t m_running = 0; /* Passes in progress */
+
+  void trim();
+
+  friend struct qprep_impl_t;
+
+public:
+  typedef size_t Handle;
+
+  bool empty() const { return m_live == 0; }
+
+  Handle install(DeferFn fn, uintptr_t data);
+  void uninstall(Handle handle);
+};
+
+/* How macro source text is turned into a Lua chunk */
+enum class ChunkKind {
+  Block,    /* The text as is */
+  Call,     /* "return " .. text */
+  BareCall, /* "return " .. text .. "()" */
+  Count,
+};
+
+struct ChunkHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+/* Compiled chunks by macro source text, as registry references */
+typedef std::unordered_map<std::string, int, ChunkHash, std::equal_to<>> ChunkCache;
+typedef std::array<ChunkCache, (size_t)ChunkKind::Count> ChunkCaches;
 
 extern std::string_view quix_code_prefix;
 
+/* A Lua state that has run the standard prefix, with what was compiled in it */
+struct PooledState {
+  lua_State *L = nullptr;
+  int snapshot = 0; /* Registry reference to the state as the prefix left it */
+  ChunkCaches chunks;
+};
+
+/**
+ * @brief Process-wide pool of Lua states ready for preprocessing, so that a
+ * preprocessor does not have to open the libraries and run the prefix anew.
+ * Released states are reset to their snapshot before being reused.
+ */
+class StatePool {
+public:
+  static std::optional<PooledState> acquire();
+  static void release(PooledState &&state);
+  static void clear();
+
+  /* Record all of `L` that scripts can reach, for restoring on release */
+  static int snapshot(lua_State *L);
+};
+
+/* A token lexed ahead of time, holding its string rather than an interned id */
+struct LexedToken {
+  qlex_tok_t tok;
+  std::string str;
+};
+
+typedef std::vector<LexedToken> LexedText;
+
+/* Lex `text` on its own, for replaying into any preprocessor later */
+LexedText lex_text(std::string_view text, const char *filename, qcore_env_t env);
+
+/* The source of an imported module, shared by all that import it */
+class ImportedModule {
+  std::once_flag m_lexed_once;
+  LexedText m_lexed;
+
+public:
+  ImportedModule(std::string &&body, size_t hash) : body(std::move(body)), hash(hash) {}
+
+  const std::string body;
+  const size_t hash;
+
+  /* The body as tokens, lexed on first use */
+  const LexedText &tokens(qcore_env_t env);
+};
+
+/**
+ * @brief Process-wide cache of fetched modules, so that a module imported by
+ * many files is fetched once. Entries are found by fetch function and import
+ * name; bodies are held by content hash, so that modules with the same text
+ * share one copy and are lexed once between them. Entries stay until the
+ * host calls `qprep_clear_import_cache`.
+ */
+class ImportCache {
+public:
+  typedef std::shared_ptr<ImportedModule> Module;
+
+  static Module find(qprep_fetch_module_t fetch, uintptr_t any, std::string_view name);
+  static Module insert(qprep_fetch_module_t fetch, uintptr_t any, std::string_view name,
+                       std::string &&body);
+  static void clear();
+};
+
+/**
+ * @brief Process-wide cache of what pure macros expanded to, keyed by the
+ * macro's definition and argument text. When a cache provider is bound,
+ * entries are also stored through it and looked up there on a miss, so that
+ * they outlive the process. Tokens are kept without their locations.
+ */
+class MemoCache {
+public:
+  typedef std::shared_ptr<const LexedText> Expansion;
+
+  static Expansion find(const qcore_cache_key_t &key);
+  static void insert(const qcore_cache_key_t &key, LexedText &&tokens);
+  static void clear();
+};
+
+/* A macro marked pure, as its global name held it when marked */
+struct PureMacro {
+  int ref;                  /* Registry reference to the function */
+  qcore_cache_key_t digest; /* Hash of where the function was defined */
+};
+
+/**
+ * @brief FIFO of tokens that also takes a whole run at its front in one step.
+ * Each run is a frame of the expansion stack: its tokens share the depth of
+ * the expansion that produced them, which is how deep expansion is bounded
+ * without recursing.
+ */
+class TokenQueue {
+  struct Frame {
+    size_t remaining;
+    uint32_t depth;
+  };
+
+  std::vector<qlex_tok_t> m_ring; /* Size is zero or a power of two */
+  size_t m_head = 0;
+  size_t m_size = 0;
+
+  /* Innermost last; their sizes add up to `m_size` */
+  std::vector<Frame> m_frames;
+
+  void grow(size_t min_size);
+
+public:
+  bool empty() const { return m_size == 0; }
+  size_t size() const { return m_size; }
+
+  qlex_tok_t pop_front(uint32_t &depth) {
+    Frame &frame = m_frames.back();
+    depth = frame.depth;
+    if (--frame.remaining == 0) {
+      m_frames.pop_back();
+    }
+
+    qlex_tok_t tok = m_ring[m_head];
+    m_head = (m_head + 1) & (m_ring.size() - 1);
+    m_size--;
+    return tok;
+  }
+
+  /* Queue `count` tokens, in order, ahead of those already queued */
+  void push_front(const qlex_tok_t *tokens, size_t count, uint32_t depth);
+};
+
 struct __attribute__((visibility("default"))) qprep_impl_t final : public qlex_t {
   struct Core {
     lua_State *L = nullptr;
-    std::vector<DeferCallback> defer_callbacks;
-    std::deque<qlex_tok_t> buffer;
+    DeferList defers;
+
+    /* Registry references to drop before the state is reused */
+    std::vector<int> refs;
+
+    /* Set when an exception may have left the Lua state inconsistent */
+    bool poisoned = false;
+    int snapshot = 0;
+
+    /* Tokens to be read before the source resumes */
+    TokenQueue queue;
+
+    /* Expansion depth of the token being expanded; source tokens are at 0 */
+    uint32_t depth = 0;
+
+    /* Expanded tokens held back while a macro runs; see `expand_raw` */
+    std::vector<qlex_tok_t> output;
+    bool capturing = false;
+
+    /* Lexes expansion text in place, sharing our string table */
+    std::unique_ptr<qlex_t> span;
+
+    /* Defines by interned name; mirrors the `def.` environment namespace */
+    DefineTable defines;
+
+    /* Compiled chunks by kind and macro source text */
+    ChunkCaches chunks;
+
+    /* Import names whose fetch ahead of their `@import` failed */
+    std::unordered_set<std::string> prefetch_failed;
+
+    /* Macros whose expansions are memoized, by global name */
+    std::unordered_map<std::string, PureMacro, ChunkHash, std::equal_to<>> pure;
+
+    /* What was recorded, and the same while profiling is on */
+    std::unique_ptr<MacroProfile> profile;
+    MacroProfile *profiling = nullptr;
 
     ~Core();
   };
 
   std::shared_ptr<Core> m_core;
   std::pair<qprep_fetch_module_t, uintptr_t> m_fetch_module;
+  bool m_fetch_concurrent = false;
   std::mutex m_mutex;
   bool m_do_expanse = true;
-  size_t m_depth = 0;
 
   virtual qlex_tok_t next_impl() override;
 
   bool run_defer_callbacks(qlex_tok_t last);
+  void check_depth();
 
-  std::optional<std::string> run_lua_code(const std::string &s);
-  bool run_and_expand(const std::string &code);
+  bool push_chunk(std::string_view code, ChunkKind kind);
+  std::optional<std::string> run_lua_code(std::string_view code,
+                                          ChunkKind kind = ChunkKind::Block);
+  bool run_and_expand(std::string_view code, ChunkKind kind = ChunkKind::Block);
+  bool run_block(std::string_view block);
+  bool run_call(std::string_view body, const qlex_tok_t &site);
+  bool memo_key(std::string_view name, std::string_view args, qcore_cache_key_t &key);
+  void run_prefix(bool run_blocks);
   void expand_raw(std::string_view code);
+  void expand_lexed(const LexedText &text, const qlex_tok_t *site = nullptr);
+  void flush_output(size_t mark);
   void install_lua_api();
-  qlex_t *weak_clone(FILE *file, const char *filename);
+  void bind_lua_api();
+
+  /* Record a `def.` write; a null value undefines the name */
+  void set_define(std::string_view name, const char *value);
+
+  /* Names of the `@import` statements next in the source, without consuming them */
+  std::vector<std::string> peek_imports(size_t max);
+
+  /* Memoize calls to the Lua function now held by global `name` */
+  bool mark_pure(std::string_view name);
+  virtual void replace_interner(std::shared_ptr<Interner> new_interner) override;
 
 public:
-  qprep_impl_t(FILE *file, const char *filename, qcore_env_t env);
   qprep_impl_t(FILE *file, const char *filename, bool is_owned, qcore_env_t env);
   virtual ~qprep_impl_t() override;
 };
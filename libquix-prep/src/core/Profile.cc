@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <core/Profile.hh>
+
+static uint64_t since(MacroProfile::Time start, MacroProfile::Time end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+static const char *kind_name(MacroProfile::Kind kind) {
+  switch (kind) {
+    case MacroProfile::Kind::Block:
+      return "block";
+    case MacroProfile::Kind::Call:
+      return "call";
+    case MacroProfile::Kind::Define:
+      return "define";
+  }
+
+  __builtin_unreachable();
+}
+
+void MacroProfile::enter(Kind kind, std::string_view name) {
+  Index &index = m_index[(size_t)kind];
+
+  Entry *entry;
+  if (auto it = index.find(name); it != index.end()) {
+    entry = it->second;
+  } else {
+    entry = &m_entries.emplace_back(Entry{kind, std::string(name)});
+    index.emplace(entry->name, entry);
+  }
+
+  entry->calls++;
+  m_stack.push_back({entry, now(), 0});
+}
+
+void MacroProfile::leave() {
+  if (m_stack.empty()) {
+    return;
+  }
+
+  Frame frame = m_stack.back();
+  m_stack.pop_back();
+
+  uint64_t elapsed = since(frame.start, now());
+  frame.entry->lua_ns += elapsed - std::min(elapsed, frame.child_ns);
+
+  if (!m_stack.empty()) {
+    m_stack.back().child_ns += elapsed;
+  }
+}
+
+void MacroProfile::lexed(Time start, size_t tokens) {
+  if (m_stack.empty()) {
+    return;
+  }
+
+  uint64_t elapsed = since(start, now());
+
+  Frame &frame = m_stack.back();
+  frame.entry->lex_ns += elapsed;
+  frame.entry->tokens += tokens;
+  frame.child_ns += elapsed;
+}
+
+const std::vector<qprep_profile_entry_t> &MacroProfile::view() {
+  m_view.clear();
+  m_view.reserve(m_entries.size());
+
+  for (const Entry &e : m_entries) {
+    m_view.push_back(
+        {e.name.c_str(), kind_name(e.kind), e.calls, e.lua_ns, e.lex_ns, e.tokens});
+  }
+
+  std::stable_sort(m_view.begin(), m_view.end(), [](const auto &a, const auto &b) {
+    return a.lua_ns + a.lex_ns > b.lua_ns + b.lex_ns;
+  });
+
+  return m_view;
+}
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __QPREP_CORE_PROFILE_HH__
+#define __QPREP_CORE_PROFILE_HH__
+
+#include <quix-prep/Preprocess.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Where a preprocessor's time goes, per macro call, macro block and
+ * define. Lua time is self time: lexing and macros nested inside a macro are
+ * charged to themselves, not to the macro that caused them. Lexing time and
+ * tokens go to the innermost macro being expanded. Not thread-safe; every
+ * preprocessor owns one, and only when profiling was asked for.
+ */
+class MacroProfile {
+public:
+  enum class Kind { Block, Call, Define };
+
+  struct Entry {
+    Kind kind;
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t lua_ns = 0;
+    uint64_t lex_ns = 0;
+    uint64_t tokens = 0;
+  };
+
+  typedef std::chrono::steady_clock::time_point Time;
+
+  static Time now() { return std::chrono::steady_clock::now(); }
+
+private:
+  struct Frame {
+    Entry *entry;
+    Time start;
+    uint64_t child_ns;
+  };
+
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+  };
+
+  typedef std::unordered_map<std::string, Entry *, NameHash, std::equal_to<>> Index;
+
+  std::deque<Entry> m_entries; /* Stable addresses */
+  std::array<Index, 3> m_index; /* By kind, as a define and a macro may share a name */
+  std::vector<Frame> m_stack;
+  std::vector<qprep_profile_entry_t> m_view;
+
+public:
+  /* Start timing an expansion of `name`; pairs with `leave` */
+  void enter(Kind kind, std::string_view name);
+  void leave();
+
+  /* Charge lexing that began at `start` and produced `tokens` */
+  void lexed(Time start, size_t tokens);
+
+  /* Entries with the most time first; valid until the next call */
+  const std::vector<qprep_profile_entry_t> &view();
+};
+
+#endif  // __QPREP_CORE_PROFILE_HH__
@@ -0,0 +1,377 @@
+////////////////////////////////////////////////////////////////////////////////
+///                                                                          ///
+///  ░▒▓██████▓▒░░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓██████▓▒░░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░      ░▒▓█▓▒░        ///
+/// ░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░ ///
+///  ░▒▓██████▓▒░ ░▒▓██████▓▒░░▒▓█▓▒░▒▓█▓▒░░▒▓█▓▒░░▒▓██████▓▒░ ░▒▓██████▓▒░  ///
+///    ░▒▓█▓▒░                                                               ///
+///     ░▒▓██▓▒░                                                             ///
+///                                                                          ///
+///   * QUIX LANG COMPILER - The official compiler for the Quix language.    ///
+///   * Copyright (C) 2024 Wesley C. Jones                                   ///
+///                                                                          ///
+///   The QUIX Compiler Suite is free software; you can redistribute it or   ///
+///   modify it under the terms of the GNU Lesser General Public             ///
+///   License as published by the Free Software Foundation; either           ///
+///   version 2.1 of the License, or (at your option) any later version.     ///
+///                                                                          ///
+///   The QUIX Compiler Suite is distributed in the hope that it will be     ///
+///   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of ///
+///   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU      ///
+///   Lesser General Public License for more details.                        ///
+///                                                                          ///
+///   You should have received a copy of the GNU Lesser General Public       ///
+///   License along with the QUIX Compiler Suite; if not, see                ///
+///   <https://www.gnu.org/licenses/>.                                       ///
+///                                                                          ///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <core/Preprocess.hh>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <lua/lauxlib.h>
+#include <lua/lua.h>
+}
+
+/* Idle states kept beyond this are closed instead */
+#define MAX_POOLED_STATES 32
+
+static std::mutex g_pool_mutex;
+static std::vector<PooledState> g_pool;
+
+///=============================================================================
+/// A snapshot records everything reachable from the globals, from the string
+/// keys of the registry and from the metatables shared by a type: a shallow
+/// copy and the metatable of each table, the metatable of each userdata, and
+/// the upvalues of each function. Restoring all of them undoes any change a
+/// script made to state that existed before it ran, however deep; whatever it
+/// created is unreachable afterwards. Integer keys of the registry are left
+/// alone, as they are references the preprocessor hands out itself.
+
+enum SnapshotPart {
+  SNAP_TABLES = 1, /* table -> {copy, metatable} */
+  SNAP_USERDATA,   /* userdata -> metatable or false */
+  SNAP_UPVALUES,   /* function -> {upvalue...} */
+  SNAP_TYPES,      /* index in shared_mt_types -> metatable */
+  SNAP_REGISTRY,   /* string key -> registry value */
+};
+
+/* Types whose values all share one metatable */
+static const int shared_mt_types[] = {LUA_TNIL,    LUA_TBOOLEAN,  LUA_TLIGHTUSERDATA,
+                                      LUA_TNUMBER, LUA_TSTRING,   LUA_TFUNCTION,
+                                      LUA_TTHREAD};
+
+static int noop(lua_State *) { return 0; }
+
+static void push_sample(lua_State *L, int type) {
+  switch (type) {
+    case LUA_TBOOLEAN:
+      lua_pushboolean(L, 0);
+      break;
+    case LUA_TLIGHTUSERDATA:
+      lua_pushlightuserdata(L, nullptr);
+      break;
+    case LUA_TNUMBER:
+      lua_pushinteger(L, 0);
+      break;
+    case LUA_TSTRING:
+      lua_pushliteral(L, "");
+      break;
+    case LUA_TFUNCTION:
+      lua_pushcfunction(L, noop);
+      break;
+    case LUA_TTHREAD:
+      lua_pushthread(L);
+      break;
+    default:
+      lua_pushnil(L);
+      break;
+  }
+}
+
+/* Add the value at `idx` to the values left to visit, if it can hold others */
+static void enqueue(lua_State *L, int pending, lua_Integer &n, int idx) {
+  switch (lua_type(L, idx)) {
+    case LUA_TTABLE:
+    case LUA_TUSERDATA:
+    case LUA_TFUNCTION:
+      lua_pushvalue(L, idx);
+      lua_rawseti(L, pending, ++n);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Whether the value at `idx` is already a key of the part at `part` */
+static bool visited(lua_State *L, int part, int idx) {
+  lua_pushvalue(L, idx);
+  bool seen = lua_rawget(L, part) != LUA_TNIL;
+  lua_pop(L, 1);
+
+  return seen;
+}
+
+int StatePool::snapshot(lua_State *L) {
+  int top = lua_gettop(L);
+
+  lua_createtable(L, SNAP_REGISTRY, 0);
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_newtable(L);
+  int snap = top + 1, tables = top + 2, userdata = top + 3, upvalues = top + 4, pending = top + 5;
+  lua_Integer n = 0;
+
+  lua_pushglobaltable(L);
+  enqueue(L, pending, n, -1);
+  lua_pop(L, 1);
+
+  lua_newtable(L);
+  lua_pushnil(L);
+  while (lua_next(L, LUA_REGISTRYINDEX)) {
+    if (lua_type(L, -2) == LUA_TSTRING) {
+      enqueue(L, pending, n, -1);
+      lua_pushvalue(L, -2);
+      lua_insert(L, -2);
+      lua_rawset(L, -4);
+    } else {
+      lua_pop(L, 1);
+    }
+  }
+  lua_rawseti(L, snap, SNAP_REGISTRY);
+
+  lua_newtable(L);
+  for (size_t i = 0; i < std::size(shared_mt_types); i++) {
+    push_sample(L, shared_mt_types[i]);
+    if (lua_getmetatable(L, -1)) {
+      enqueue(L, pending, n, -1);
+      lua_rawseti(L, -3, i + 1);
+    }
+    lua_pop(L, 1);
+  }
+  lua_rawseti(L, snap, SNAP_TYPES);
+
+  while (n > 0) {
+    lua_rawgeti(L, pending, n);
+    lua_pushnil(L);
+    lua_rawseti(L, pending, n--);
+    int value = lua_gettop(L);
+
+    switch (lua_type(L, value)) {
+      case LUA_TTABLE: {
+        if (visited(L, tables, value)) {
+          break;
+        }
+
+        lua_pushvalue(L, value);
+        lua_createtable(L, 2, 0);
+
+        lua_newtable(L);
+        lua_pushnil(L);
+        while (lua_next(L, value)) {
+          enqueue(L, pending, n, -2);
+          enqueue(L, pending, n, -1);
+          lua_pushvalue(L, -2);
+          lua_insert(L, -2);
+          lua_rawset(L, -4);
+        }
+        lua_rawseti(L, -2, 1);
+
+        if (lua_getmetatable(L, value)) {
+          enqueue(L, pending, n, -1);
+          lua_rawseti(L, -2, 2);
+        }
+
+        lua_rawset(L, tables);
+        break;
+      }
+
+      case LUA_TUSERDATA: {
+        if (visited(L, userdata, value)) {
+          break;
+        }
+
+        lua_pushvalue(L, value);
+        if (lua_getmetatable(L, value)) {
+          enqueue(L, pending, n, -1);
+        } else {
+          lua_pushboolean(L, 0);
+        }
+        lua_rawset(L, userdata);
+        break;
+      }
+
+      case LUA_TFUNCTION: {
+        /* Functions without upvalues hold nothing to restore */
+        if (!lua_getupvalue(L, value, 1)) {
+          break;
+        }
+        lua_pop(L, 1);
+
+        if (visited(L, upvalues, value)) {
+          break;
+        }
+
+        lua_pushvalue(L, value);
+        lua_newtable(L);
+        for (int i = 1; lua_getupvalue(L, value, i); i++) {
+          enqueue(L, pending, n, -1);
+          lua_rawseti(L, -2, i);
+        }
+        lua_rawset(L, upvalues);
+        break;
+      }
+
+      default:
+        break;
+    }
+
+    lua_settop(L, value - 1);
+  }
+
+  lua_pop(L, 1);
+  lua_rawseti(L, snap, SNAP_UPVALUES);
+  lua_rawseti(L, snap, SNAP_USERDATA);
+  lua_rawseti(L, snap, SNAP_TABLES);
+
+  return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+/* Make the fields of `table` those of `copy`, or only its string keys */
+static void restore_fields(lua_State *L, int table, int copy, bool strings_only) {
+  /* Drop the fields added since; clearing fields while traversing is allowed */
+  lua_pushnil(L);
+  while (lua_next(L, table)) {
+    lua_pop(L, 1);
+
+    if (strings_only && lua_type(L, -1) != LUA_TSTRING) {
+      continue;
+    }
+
+    lua_pushvalue(L, -1);
+    bool added = lua_rawget(L, copy) == LUA_TNIL;
+    lua_pop(L, 1);
+
+    if (added) {
+      lua_pushvalue(L, -1);
+      lua_pushnil(L);
+      lua_rawset(L, table);
+    }
+  }
+
+  /* Put back the fields changed or removed since */
+  lua_pushnil(L);
+  while (lua_next(L, copy)) {
+    lua_pushvalue(L, -2);
+    lua_insert(L, -2);
+    lua_rawset(L, table);
+  }
+}
+
+static void restore(lua_State *L, int snapshot) {
+  lua_settop(L, 0);
+  lua_sethook(L, nullptr, 0, 0);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, snapshot); /* 1: snapshot */
+
+  lua_rawgeti(L, 1, SNAP_TABLES); /* 2: tables */
+  lua_pushnil(L);
+  while (lua_next(L, 2)) { /* 3: table, 4: entry */
+    lua_rawgeti(L, 4, 1);  /* 5: copy */
+    restore_fields(L, 3, 5, false);
+
+    lua_rawgeti(L, 4, 2);
+    lua_setmetatable(L, 3);
+
+    lua_pop(L, 2);
+  }
+  lua_pop(L, 1);
+
+  lua_rawgeti(L, 1, SNAP_USERDATA); /* 2: userdata */
+  lua_pushnil(L);
+  while (lua_next(L, 2)) { /* 3: userdata, 4: metatable */
+    if (!lua_istable(L, 4)) {
+      lua_pushnil(L);
+      lua_replace(L, 4);
+    }
+    lua_setmetatable(L, 3);
+  }
+  lua_pop(L, 1);
+
+  lua_rawgeti(L, 1, SNAP_UPVALUES); /* 2: functions */
+  lua_pushnil(L);
+  while (lua_next(L, 2)) { /* 3: function, 4: upvalues */
+    for (int i = 1; lua_getupvalue(L, 3, i); i++) {
+      lua_pop(L, 1);
+      lua_rawgeti(L, 4, i);
+      lua_setupvalue(L, 3, i);
+    }
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+
+  lua_rawgeti(L, 1, SNAP_TYPES); /* 2: metatables */
+  for (size_t i = 0; i < std::size(shared_mt_types); i++) {
+    push_sample(L, shared_mt_types[i]);
+    lua_rawgeti(L, 2, i + 1);
+    lua_setmetatable(L, -2);
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+
+  lua_rawgeti(L, 1, SNAP_REGISTRY); /* 2: registry copy */
+  restore_fields(L, LUA_REGISTRYINDEX, 2, true);
+
+  lua_settop(L, 0);
+}
+
+///=============================================================================
+
+std::optional<PooledState> StatePool::acquire() {
+  std::lock_guard<std::mutex> lock(g_pool_mutex);
+
+  if (g_pool.empty()) {
+    return std::nullopt;
+  }
+
+  PooledState state = std::move(g_pool.back());
+  g_pool.pop_back();
+
+  return state;
+}
+
+void StatePool::release(PooledState &&state) {
+  restore(state.L, state.snapshot);
+
+  {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+
+    if (g_pool.size() < MAX_POOLED_STATES) {
+      g_pool.push_back(std::move(state));
+      return;
+    }
+  }
+
+  lua_close(state.L);
+}
+
+void StatePool::clear() {
+  std::vector<PooledState> pool;
+
+  {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    pool.swap(g_pool);
+  }
+
+  for (auto &state : pool) {
+    lua_close(state.L);
+  }
+}
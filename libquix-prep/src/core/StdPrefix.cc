@@ -150,14 +150,13 @@ std::string_view quix_code_prefix = R"(
   name = name.v;
 
   quix.debug('Attempting to import module: ', name);
-  local content = quix.fetch(name);
-  if content == nil then
+  -- Expands the module in place from its cached tokens
+  local size = quix.fetch(name, true);
+  if size == nil then
     quix.abort('Failed to import module: ', quix.errno);
   end
 
-  quix.debug(string.format('Fetched module: %s (%d bytes)', name, #content));
-
-  return content;
+  quix.debug(string.format('Fetched module: %s (%d bytes)', name, size));
 })
 
 @(
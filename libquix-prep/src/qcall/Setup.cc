@@ -38,6 +38,7 @@ const std::vector<QSysCall> qcall::qsyscalls = {
     {"peek", 0x0011, sys_peek},   /* Peek at the next token from the lexer */
     {"emit", 0x0012, sys_emit},   /* Emit data subject to recursive expansion */
     {"defer", 0x0013, sys_defer}, /* Callback after every token is emitted */
+    {"pure", 0x0014, sys_pure},   /* Memoize a macro function's expansions */
 
     {"debug", 0x0051, sys_debug}, /* Print a debug message */
     {"info", 0x0052, sys_info},   /* Print an informational message */
@@ -36,6 +36,71 @@ extern "C" {
 #include <lua/lauxlib.h>
 }
 
+static DeferOp lua_defer(qprep_impl_t* obj, qlex_tok_t tok, uintptr_t id) {
+  lua_State* L = obj->m_core->L;
+
+  lua_rawgeti(L, LUA_REGISTRYINDEX, (lua_Integer)id); /* Push the function */
+
+  { /* Push the function arguments */
+    lua_createtable(L, 0, 2);
+
+    lua_pushstring(L, qlex_ty_str(tok.ty));
+    lua_setfield(L, -2, "ty");
+
+    switch (tok.ty) {
+      case qEofF:
+      case qErro: {
+        lua_pushnil(L);
+        break;
+      }
+      case qKeyW: {
+        lua_pushstring(L, qlex_kwstr(tok.v.key));
+        break;
+      }
+      case qOper: {
+        lua_pushstring(L, qlex_opstr(tok.v.op));
+        break;
+      }
+      case qPunc: {
+        lua_pushstring(L, qlex_punctstr(tok.v.punc));
+        break;
+      }
+      case qIntL:
+      case qNumL:
+      case qText:
+      case qChar:
+      case qName:
+      case qMacB:
+      case qMacr:
+      case qNote: {
+        lua_pushstring(L, obj->get_string(tok.v.str_idx).data());
+        break;
+      }
+    }
+
+    lua_setfield(L, -2, "v");
+  }
+
+  DeferOp op;
+
+  if (lua_pcall(L, 1, 1, 0) != 0) {
+    qcore_print(QCORE_ERROR, "sys_defer: %s\n", lua_tostring(L, -1));
+    op = DeferOp::EmitToken;
+  } else if (lua_isnil(L, -1)) {
+    op = DeferOp::UninstallHandler;
+  } else if (!lua_isboolean(L, -1)) {
+    qcore_print(QCORE_ERROR, "sys_defer: expected boolean return value or nil, got %s\n",
+                luaL_typename(L, -1));
+    op = DeferOp::EmitToken;
+  } else {
+    op = lua_toboolean(L, -1) ? DeferOp::EmitToken : DeferOp::SkipToken;
+  }
+
+  lua_pop(L, 1);
+
+  return op;
+}
+
 int qcall::sys_defer(lua_State* L) {
   /**
    *   @brief Defer token callback.
@@ -51,75 +116,15 @@ int qcall::sys_defer(lua_State* L) {
                       luaL_typename(L, 1));
   }
 
+  lua_pushvalue(L, 1);
   int id = luaL_ref(L, LUA_REGISTRYINDEX);
   if (id == LUA_REFNIL) {
     return luaL_error(L, "sys_defer: failed to store callback in registry");
   }
 
-  DeferCallback cb = [L, id](qprep_impl_t* obj, qlex_tok_t tok) -> DeferOp {
-    lua_rawgeti(L, LUA_REGISTRYINDEX, id); /* Push the function */
-
-    { /* Push the function arguments */
-      lua_newtable(L);
-
-      lua_pushstring(L, "ty");
-      lua_pushstring(L, qlex_ty_str(tok.ty));
-      lua_settable(L, -3);
-
-      lua_pushstring(L, "v");
-      switch (tok.ty) {
-        case qEofF:
-        case qErro: {
-          lua_pushnil(L);
-          break;
-        }
-        case qKeyW: {
-          lua_pushstring(L, qlex_kwstr(tok.v.key));
-          break;
-        }
-        case qOper: {
-          lua_pushstring(L, qlex_opstr(tok.v.op));
-          break;
-        }
-        case qPunc: {
-          lua_pushstring(L, qlex_punctstr(tok.v.punc));
-          break;
-        }
-        case qIntL:
-        case qNumL:
-        case qText:
-        case qChar:
-        case qName:
-        case qMacB:
-        case qMacr:
-        case qNote: {
-          lua_pushstring(L, obj->get_string(tok.v.str_idx).data());
-          break;
-        }
-      }
-
-      lua_settable(L, -3);
-    }
-
-    if (lua_pcall(L, 1, 1, 0) != 0) {
-      qcore_print(QCORE_ERROR, "sys_defer: %s\n", lua_tostring(L, -1));
-      return DeferOp::EmitToken;
-    }
-
-    if (lua_isnil(L, -1)) {
-      return DeferOp::UninstallHandler;
-    }
-
-    if (!lua_isboolean(L, -1)) {
-      qcore_print(QCORE_ERROR, "sys_defer: expected boolean return value or nil, got %s\n",
-                  luaL_typename(L, -1));
-      return DeferOp::EmitToken;
-    }
-
-    return lua_toboolean(L, -1) ? DeferOp::EmitToken : DeferOp::SkipToken;
-  };
-
-  get_engine()->m_core->defer_callbacks.push_back(cb);
+  qprep_impl_t* obj = get_engine();
+  obj->m_core->defers.install(lua_defer, (uintptr_t)id);
+  obj->m_core->refs.push_back(id);
 
   return 0;
 }
@@ -30,86 +30,211 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <quix-core/Env.h>
+#include <quix-core/Pool.hh>
 
+#include <algorithm>
 #include <core/Preprocess.hh>
 #include <cstddef>
 #include <qcall/List.hh>
+#include <thread>
 
 extern "C" {
 #include <lua/lauxlib.h>
 }
 
-#include <algorithm>
-#include <optional>
-#include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
 
-static bool is_valid_import_name(const std::string &name) {
-  if (name.empty()) {
-    return false;
-  }
+/* At most this many `@import` statements are fetched ahead at once */
+#define MAX_PREFETCH_IMPORTS 64
+#define MAX_PREFETCH_THREADS 8
 
-  if (std::any_of(name.begin(), name.end(), [](char c) { return c & 0x80; })) {
-    return false;
-  }
+static bool is_ident_start(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_ident_char(char c) { return is_ident_start(c) || (c >= '0' && c <= '9'); }
 
-  std::regex re(R"(^[a-zA-Z_][a-zA-Z0-9_]*(::[a-zA-Z_][a-zA-Z0-9_]*)*$)");
-  return std::regex_match(name, re);
+/* Identifiers joined by `::`, in ASCII only */
+static bool is_valid_import_name(std::string_view name) {
+  size_t i = 0;
+
+  while (true) {
+    if (i >= name.size() || !is_ident_start(name[i])) {
+      return false;
+    }
+
+    while (++i < name.size() && is_ident_char(name[i])) {
+    }
+
+    if (i == name.size()) {
+      return true;
+    }
+
+    if (name.substr(i, 2) != "::") {
+      return false;
+    }
+
+    i += 2;
+  }
 }
 
-static void canonicalize_import_name(std::string &name) {
+static std::string canonicalize_import_name(std::string_view name) {
   // Don't assume that filesystems are case-sensitive.
-  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  std::string canonical(name);
+  for (char &c : canonical) {
+    if (c >= 'A' && c <= 'Z') {
+      c += 'a' - 'A';
+    }
+  }
+
+  return canonical;
 }
 
-static std::optional<std::string> fetch_module_data(qprep_impl_t *obj, const char *name) {
-  if (!obj->m_fetch_module.first) {
-    return std::nullopt;
-  }
+/* Call the fetch function and cache what it returns */
+static ImportCache::Module fetch_uncached(qprep_impl_t *obj, const std::string &name) {
+  auto [fetch, any] = obj->m_fetch_module;
 
   char *module_data = NULL;
   size_t module_size = 0;
 
   // Always put off to tomorrow what can be done today.
-  if (!obj->m_fetch_module.first(obj, name, &module_data, &module_size,
-                                 obj->m_fetch_module.second)) {
-    return std::nullopt;
+  if (!fetch(obj, name.c_str(), &module_data, &module_size, any)) {
+    return nullptr;
   }
 
   std::string data(module_data, module_size);
   free(module_data);
 
-  return data;
+  return ImportCache::insert(fetch, any, name, std::move(data));
+}
+
+static ImportCache::Module fetch_module(qprep_impl_t *obj, const std::string &name) {
+  auto [fetch, any] = obj->m_fetch_module;
+  if (!fetch) {
+    return nullptr;
+  }
+
+  if (auto module = ImportCache::find(fetch, any, name)) {
+    return module;
+  }
+
+  /* Failures are not cached, but the one just seen is not fetched twice */
+  if (obj->m_core->prefetch_failed.erase(name)) {
+    return nullptr;
+  }
+
+  return fetch_uncached(obj, name);
+}
+
+static void prefetch_modules(qprep_impl_t *obj, const std::string &name) {
+  /**
+   * @brief Files tend to start with a run of imports. When the first of them
+   * is expanded, the modules of the whole run are fetched and lexed at once
+   * on a few threads. Each `@import` then expands its module from the cache
+   * in statement order, as it would have otherwise, so the output is the
+   * same; only the fetching and lexing overlap. Only fetch functions the
+   * host registered as safe to call concurrently are run this way.
+   */
+
+  auto [fetch, any] = obj->m_fetch_module;
+  if (!fetch || !obj->m_fetch_concurrent) {
+    return;
+  }
+
+  std::vector<std::string> names = {name};
+  for (auto &next : obj->peek_imports(MAX_PREFETCH_IMPORTS)) {
+    if (!is_valid_import_name(next)) {
+      continue;
+    }
+
+    std::string canonical = canonicalize_import_name(next);
+    if (std::find(names.begin(), names.end(), canonical) == names.end()) {
+      names.push_back(std::move(canonical));
+    }
+  }
+
+  std::erase_if(names,
+                [&](const std::string &n) { return ImportCache::find(fetch, any, n) != nullptr; });
+  if (names.size() < 2) {
+    return;
+  }
+
+  std::vector<ImportCache::Module> modules(names.size());
+  qcore_env_t env = obj->m_env;
+  size_t threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_PREFETCH_THREADS);
+
+  bool done = qcore_run_pool(threads, names.size(), [&](size_t i) {
+    qcore_env_set_current(env);
+
+    /* A fetch that throws has failed, like one that returns false */
+    try {
+      if ((modules[i] = fetch_uncached(obj, names[i]))) {
+        modules[i]->tokens(env);
+      }
+    } catch (...) {
+      modules[i] = nullptr;
+    }
+  });
+
+  /* Short of threads, each `@import` fetches its module when it runs */
+  if (!done) {
+    return;
+  }
+
+  for (size_t i = 0; i < names.size(); i++) {
+    if (!modules[i]) {
+      obj->m_core->prefetch_failed.insert(names[i]);
+    }
+  }
 }
 
 int qcall::sys_fetch(lua_State *L) {
   /**
    * @brief Download a file.
+   *
+   * With a true second argument, the module is expanded in place from its
+   * cached tokens and its size in bytes is returned instead of its text.
    */
 
   qprep_impl_t *obj = get_engine();
 
   int nargs = lua_gettop(L);
-  if (nargs != 1) {
-    return luaL_error(L, "expected 1 argument, got %d", nargs);
+  if (nargs != 1 && nargs != 2) {
+    return luaL_error(L, "expected 1 or 2 arguments, got %d", nargs);
   }
 
   if (!lua_isstring(L, 1)) {
     return luaL_error(L, "expected string, got %s", lua_typename(L, lua_type(L, 1)));
   }
 
-  std::string import_name = lua_tostring(L, 1);
+  size_t len;
+  const char *str = lua_tolstring(L, 1, &len);
+  std::string_view import_name(str, len);
 
   if (!is_valid_import_name(import_name)) {
     return luaL_error(L, "invalid import name");
   }
 
-  canonicalize_import_name(import_name);
+  std::string name = canonicalize_import_name(import_name);
+  bool expand = nargs == 2 && lua_toboolean(L, 2);
 
-  if (auto data = fetch_module_data(obj, import_name.c_str())) {
-    lua_pushstring(L, data->c_str());
-    return 1;
-  } else {
+  if (expand) {
+    prefetch_modules(obj, name);
+  }
+
+  auto module = fetch_module(obj, name);
+  if (!module) {
     return luaL_error(L, "failed to fetch module");
   }
+
+  if (expand) {
+    obj->expand_lexed(module->tokens(obj->m_env));
+    lua_pushinteger(L, (lua_Integer)module->body.size());
+  } else {
+    lua_pushlstring(L, module->body.data(), module->body.size());
+  }
+
+  return 1;
 }
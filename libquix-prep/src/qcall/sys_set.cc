@@ -31,6 +31,7 @@
 
 #include <quix-core/Env.h>
 
+#include <core/Preprocess.hh>
 #include <qcall/List.hh>
 
 extern "C" {
@@ -65,13 +66,19 @@ int qcall::sys_set(lua_State* L) {
     }
   }
 
-  if (lua_isnil(L, 2)) {
-    qcore_env_set(key.data(), nullptr);
-  } else if (lua_isstring(L, 2)) {
-    qcore_env_set(key.data(), lua_tostring(L, 2));
-  } else {
+  const char* value = nullptr;
+  if (lua_isstring(L, 2)) {
+    value = lua_tostring(L, 2);
+  } else if (!lua_isnil(L, 2)) {
     return luaL_error(L, "expected string or nil, got %s", lua_typename(L, lua_type(L, 2)));
   }
 
+  qcore_env_set(key.data(), value);
+
+  /* The preprocessor looks defines up in its own table */
+  if (key.starts_with("def.")) {
+    get_engine()->set_define(key.substr(4), value);
+  }
+
   return 0;
 }
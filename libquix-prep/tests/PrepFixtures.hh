@@ -0,0 +1,51 @@
+#ifndef __QUIX_PREP_TESTS_PREP_FIXTURES_HH__
+#define __QUIX_PREP_TESTS_PREP_FIXTURES_HH__
+
+#include <quix-lexer/Lexer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+#include <string_view>
+
+/* Preprocess `src` in an environment of its own, calling `fn(lexer, tok)` on
+ * every token it expands to */
+template <typename Fn>
+void preprocess_each(std::string_view src, Fn &&fn) {
+  FILE *file = fmemopen((void *)src.data(), src.size(), "r");
+  if (!file) {
+    std::cerr << "fmemopen failed" << std::endl;
+    exit(1);
+  }
+
+  {
+    qcore_env env;
+    qprep lexer(file, nullptr, env.get());
+
+    qlex_tok_t tok;
+    while ((tok = qlex_next(lexer.get())).ty != qEofF) {
+      fn(lexer.get(), tok);
+    }
+  }
+
+  fclose(file);
+}
+
+/* The text of every token `src` expands to, each followed by a space */
+inline std::string preprocess(std::string_view src) {
+  std::string out;
+
+  preprocess_each(src, [&](qlex_t *lexer, qlex_tok_t tok) {
+    size_t len;
+    const char *str = qlex_str(lexer, &tok, &len);
+    out.append(str, len);
+    out += ' ';
+  });
+
+  return out;
+}
+
+#endif  // __QUIX_PREP_TESTS_PREP_FIXTURES_HH__
@@ -0,0 +1,118 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+
+#include <CountedAlloc.hh>
+#include "PrepFixtures.hh"
+
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+#include <vector>
+
+/* What defer handlers let through, and that running them does not allocate
+ * once the preprocessor is warm. */
+
+/* Punctuators are joined to what precedes them, other tokens spaced apart */
+static std::string render(const std::string &src) {
+  std::string out;
+
+  preprocess_each(src, [&](qlex_t *lexer, qlex_tok_t tok) {
+    size_t len;
+    const char *str = qlex_str(lexer, &tok, &len);
+
+    if (tok.ty == qPunc) {
+      out += qlex_punctstr(tok.v.punc);
+    } else {
+      if (!out.empty()) {
+        out += ' ';
+      }
+      out.append(str, len);
+    }
+  });
+
+  return out;
+}
+
+static bool expect(const char *what, const std::string &src, const std::string &expected) {
+  std::string actual = render(src);
+  if (actual != expected) {
+    std::cerr << what << ": expected '" << expected << "', got '" << actual << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  bool ok = true;
+
+  ok &= expect("no handlers", "a b c;", "a b c;");
+
+  ok &= expect("handlers filter independently",
+               "@(quix.defer(function(t) return t.v ~= 'a' end))"
+               "@(quix.defer(function(t) return t.v ~= 'b' end))"
+               "a b c;",
+               "a b c;");
+
+  ok &= expect("a token is kept if any handler keeps it",
+               "@(quix.defer(function(t) return t.v == 'a' end))"
+               "@(quix.defer(function(t) return t.v == 'b' end))"
+               "a b c;",
+               "a b");
+
+  ok &= expect("nil uninstalls the handler",
+               "@(n = 0; quix.defer(function(t) n = n + 1; if n > 2 then return nil end "
+               "return t.v ~= 'x' end))"
+               "x y x y x;",
+               "y y x;");
+
+  ok &= expect("handlers may read ahead",
+               "@(quix.defer(function(t) if t.v == 'pair' then local u = quix.next(); "
+               "quix.emit(u.v .. '_paired') return false end return true end))"
+               "one pair two three;",
+               "one two_paired three;");
+
+  ok &= expect("handlers installed by a handler see the same token",
+               "@(quix.defer(function(t) if t.v == 'arm' then "
+               "quix.defer(function(u) return u.v ~= 'drop' end) return nil end return true end))"
+               "drop arm drop keep;",
+               "drop arm keep;");
+
+  ok &= expect("extra arguments are ignored",
+               "@(quix.defer(function(t) return t.v ~= 'gone' end, 'ignored'))"
+               "here gone there;",
+               "here there;");
+
+  { /* Running handlers allocates nothing per token */
+    std::string src = "@(quix.defer(function(t) return t.v ~= 'skip' end))";
+    for (int i = 0; i < 20000; i++) {
+      src += i % 10 ? " word" : " skip";
+    }
+
+    render(src); /* Warm up the pooled state */
+
+    g_allocs = 0;
+    g_counting = true;
+    render(src);
+    g_counting = false;
+
+    double per_token = (double)g_allocs / 20000;
+    std::cout << "Allocations per token with a defer handler: " << per_token << std::endl;
+
+    if (per_token > 0.05) {
+      std::cerr << "defer handlers allocate per token" << std::endl;
+      ok = false;
+    }
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+
+#include "PrepFixtures.hh"
+
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+
+/* Expansion is bounded by how deeply expansions nest, not by how many tokens
+ * are expanded or skipped in a row. */
+
+static size_t preprocess(const std::string &src, std::string &last) {
+  size_t count = 0;
+
+  preprocess_each(src, [&](qlex_t *lexer, qlex_tok_t tok) {
+    size_t len;
+    const char *str = qlex_str(lexer, &tok, &len);
+    last = std::string(str, len);
+    count++;
+  });
+
+  return count;
+}
+
+static bool expect(const char *what, const std::string &src, size_t count,
+                   const std::string &last) {
+  std::string actual_last;
+  size_t actual = preprocess(src, actual_last);
+
+  if (actual != count || actual_last != last) {
+    std::cerr << what << ": expected " << count << " tokens ending in '" << last << "', got "
+              << actual << " ending in '" << actual_last << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static std::string repeat(const std::string &s, size_t n) {
+  std::string out;
+  for (size_t i = 0; i < n; i++) {
+    out += s;
+  }
+
+  return out;
+}
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  bool ok = true;
+
+  ok &= expect("macro blocks in a row", repeat("@(x = 1) ", 100000) + "end", 1, "end");
+
+  ok &= expect("skipped tokens in a row",
+               "@(quix.defer(function(t) return t.v ~= 's' end)) " + repeat("s ", 100000) + "end",
+               1, "end");
+
+  ok &= expect("defines in a row", "@(quix.set('def.E', '')) " + repeat("E ", 100000) + "end", 1,
+               "end");
+
+  ok &= expect("large macro output", "@(return string.rep('a ', 200000)) end", 200001, "end");
+
+  ok &= expect("nested defines", "@define A = B;\n@define B = C;\n@define C = done;\nA", 1,
+               "done");
+
+  /* Runaway expansion stops the preprocessor */
+  ok &= expect("self-referential define", "before\n@define X = X;\nX after", 1, "before");
+  ok &= expect("doubling define", "before @(quix.set('def.D', 'D D')) D after", 1, "before");
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
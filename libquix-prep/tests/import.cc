@@ -0,0 +1,260 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Modules are fetched once per import name for the whole process, and a
+ * module expanded from its cached tokens reads the same as its text. Only a
+ * fetch function registered as concurrent is called from other threads. */
+
+static std::map<std::string, std::string> g_modules = {
+    {"util::math", "fn square(x: i32) -> i32 { ret x * x; } /* done */ let pi = 3.14;"},
+    {"same_text", "fn square(x: i32) -> i32 { ret x * x; } /* done */ let pi = 3.14;"},
+    {"greeting", "let hello = \"world\"; @(return 'from_macro')"},
+    {"run::a", "let a = 1;"},
+    {"run::b", "@(fn b_macro() { return 'b_expanded' }) let b = 2;"},
+    {"run::c", "let c = @b_macro();"},
+    {"run::d", "/* d */ let d = 4;"},
+    {"throw::ok", "let t = 1;"},
+    {"serial::a", "let sa = 1;"},
+    {"serial::b", "let sb = 2;"},
+};
+
+static std::map<std::string, size_t> g_fetches;
+static size_t g_foreign_fetches;
+static std::thread::id g_main_thread;
+static std::mutex g_fetches_mutex;
+
+static bool fetch(qlex_t *, const char *name, char **content, size_t *size, uintptr_t) {
+  std::lock_guard<std::mutex> lock(g_fetches_mutex);
+  g_fetches[name]++;
+
+  if (std::this_thread::get_id() != g_main_thread) {
+    g_foreign_fetches++;
+
+    if (std::string_view(name) == "throws") {
+      throw std::runtime_error("fetch failed");
+    }
+  }
+
+  auto it = g_modules.find(name);
+  if (it == g_modules.end()) {
+    return false;
+  }
+
+  *content = (char *)malloc(it->second.size());
+  memcpy(*content, it->second.data(), it->second.size());
+  *size = it->second.size();
+
+  return true;
+}
+
+static std::vector<std::string> preprocess(const std::string &src, bool concurrent = true) {
+  FILE *file = fmemopen((void *)src.data(), src.size(), "r");
+  std::vector<std::string> out;
+
+  {
+    qcore_env env;
+    qprep lexer(file, nullptr, env.get());
+    if (concurrent) {
+      qprep_set_fetch_module_concurrent(lexer.get(), fetch, 0);
+    } else {
+      qprep_set_fetch_module(lexer.get(), fetch, 0);
+    }
+
+    qlex_tok_t tok;
+    while ((tok = qlex_next(lexer.get())).ty != qEofF) {
+      std::string s = qlex_ty_str(tok.ty);
+
+      switch (tok.ty) {
+        case qKeyW:
+          s += std::string(" ") + qlex_kwstr(tok.v.key);
+          break;
+        case qOper:
+          s += std::string(" ") + qlex_opstr(tok.v.op);
+          break;
+        case qPunc:
+          s += std::string(" ") + qlex_punctstr(tok.v.punc);
+          break;
+        case qErro:
+          break;
+        default: {
+          size_t len;
+          const char *str = qlex_str(lexer.get(), &tok, &len);
+          s += " " + std::string(str, len);
+          break;
+        }
+      }
+
+      out.push_back(std::move(s));
+    }
+  }
+
+  fclose(file);
+
+  return out;
+}
+
+static size_t fetches(const std::string &name) {
+  auto it = g_fetches.find(name);
+  return it == g_fetches.end() ? 0 : it->second;
+}
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  g_main_thread = std::this_thread::get_id();
+  bool ok = true;
+
+  { /* One fetch however many files import the module */
+    auto first = preprocess("@import Util::Math;\nlet x = 2;\n");
+    if (first.empty()) {
+      std::cerr << "import produced no tokens" << std::endl;
+      ok = false;
+    }
+
+    for (int i = 0; i < 200; i++) {
+      if (preprocess("@import Util::Math;\nlet x = 2;\n") != first) {
+        std::cerr << "file " << i << ": output differs from the first import" << std::endl;
+        ok = false;
+        break;
+      }
+    }
+
+    if (fetches("util::math") != 1) {
+      std::cerr << "module fetched " << fetches("util::math") << " times" << std::endl;
+      ok = false;
+    }
+  }
+
+  /* Cached tokens expand as the text would */
+  for (const char *name : {"util::math", "same_text", "greeting"}) {
+    std::string n(name);
+    auto lexed = preprocess("a @import " + n + "; b");
+    auto text = preprocess("a @(return quix.fetch('" + n + "')) b");
+
+    if (lexed != text) {
+      std::cerr << name << ": cached tokens differ from the module text" << std::endl;
+      ok = false;
+    }
+  }
+
+  { /* Only well-formed names reach the fetch function */
+    const std::vector<std::string> good = {"a", "_a1::b_2", "x::Y::z9"};
+    const std::vector<std::string> bad = {"",      "1a",     "a::", "::a", "a:b",
+                                          "a:::b", "a::::b", "a-b", "a b", "\xc3\xa9"};
+
+    for (const auto &name : good) {
+      preprocess("@(quix.fetch('" + name + "'))");
+    }
+    for (const auto &name : bad) {
+      preprocess("@(quix.fetch('" + name + "'))");
+    }
+
+    for (const auto &fetched : g_fetches) {
+      for (const auto &b : bad) {
+        if (fetched.first == b) {
+          std::cerr << "invalid import name accepted: '" << b << "'" << std::endl;
+          ok = false;
+        }
+      }
+    }
+
+    for (const auto &name : {"a", "_a1::b_2", "x::y::z9"}) {
+      if (fetches(name) != 1) {
+        std::cerr << "valid import name not fetched: " << name << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  { /* Failures are not cached */
+    preprocess("@(quix.fetch('missing'))");
+    preprocess("@(quix.fetch('missing'))");
+
+    if (fetches("missing") != 2) {
+      std::cerr << "failed fetch was cached" << std::endl;
+      ok = false;
+    }
+  }
+
+  { /* A run of imports is fetched at once and expands in statement order. The
+     * failed import becomes an error token, after its module was fetched once,
+     * and the file goes on. */
+    auto run = preprocess(
+        "@import run::a;\n@import \"run::b\"; /* between */ @import run::c;\n"
+        "@import run::missing;\n@import run::d;\nlet x = 5;");
+    auto text = preprocess(
+        "@(return quix.fetch('run::a')) @(return quix.fetch('run::b')) /* between */ "
+        "@(return quix.fetch('run::c'))");
+    auto rest = preprocess("/* d */ let d = 4;\nlet x = 5;");
+
+    text.push_back(qlex_ty_str(qErro));
+    text.insert(text.end(), rest.begin(), rest.end());
+
+    if (run != text) {
+      std::cerr << "imports fetched at once differ from their texts" << std::endl;
+      ok = false;
+    }
+
+    for (const auto &name : {"run::a", "run::b", "run::c", "run::d", "run::missing"}) {
+      if (fetches(name) != 1) {
+        std::cerr << name << ": fetched " << fetches(name) << " times" << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  { /* A fetch that throws on a worker fails its import and nothing else */
+    auto run = preprocess("@import throw::ok;\n@import throws;\nlet y = 6;");
+    auto text = preprocess("let t = 1;");
+    auto rest = preprocess("let y = 6;");
+
+    text.push_back(qlex_ty_str(qErro));
+    text.insert(text.end(), rest.begin(), rest.end());
+
+    if (run != text) {
+      std::cerr << "a throwing fetch was not treated as a failed one" << std::endl;
+      ok = false;
+    }
+  }
+
+  { /* A fetch function not registered as concurrent stays on one thread */
+    size_t foreign = g_foreign_fetches;
+    preprocess("@import serial::a;\n@import serial::b;\n", false);
+
+    if (fetches("serial::a") != 1 || fetches("serial::b") != 1 || g_foreign_fetches != foreign) {
+      std::cerr << "fetch function called from another thread" << std::endl;
+      ok = false;
+    }
+  }
+
+  { /* Clearing the cache fetches anew */
+    qprep_clear_import_cache();
+    preprocess("@import util::math;");
+
+    if (fetches("util::math") != 2) {
+      std::cerr << "module not fetched again after clearing the cache" << std::endl;
+      ok = false;
+    }
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
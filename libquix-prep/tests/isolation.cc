@@ -0,0 +1,59 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+
+#include "PrepFixtures.hh"
+
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+
+/* A file preprocessed on a pooled Lua state sees none of the changes the
+ * files before it made, however deep in the state they were. The package
+ * library is removed from the globals by the prefix, yet still reachable
+ * through `require`, so it is only restored if the whole state is. */
+
+static const char *writer =
+    "@(leak = 'global')\n"
+    "@(string.leak = 'library')\n"
+    "@(require('package').loaded.leak = 'nested')\n"
+    "@(setmetatable(require('package'), {__index = function() return 'meta' end}))\n"
+    "@(getmetatable('').__index = {leak = 'string'})\n";
+
+static const char *reader =
+    "@(return tostring(leak))\n"
+    "@(return tostring(string.leak))\n"
+    "@(return tostring(require('package').loaded.leak))\n"
+    "@(return tostring(require('package').leak))\n"
+    "@(return tostring(('').leak) .. ' ' .. ('x'):rep(2))\n";
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  bool ok = true;
+
+  const std::string fresh = preprocess(reader);
+  if (fresh != "nil nil nil nil nil xx ") {
+    std::cerr << "a fresh state reads back '" << fresh << "'" << std::endl;
+    ok = false;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    preprocess(writer);
+
+    std::string pooled = preprocess(reader);
+    if (pooled != fresh) {
+      std::cerr << "after a writer, expected '" << fresh << "', got '" << pooled << "'"
+                << std::endl;
+      ok = false;
+    }
+  }
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include <quix-core/Cache.h>
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+#include <quix-prep/Preprocess.h>
+
+#include <Fixtures.hh>
+#include "PrepFixtures.hh"
+
+#include <cstring>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+
+/* Pure macros run once per argument text, in one file, across files and,
+ * through a cache provider, across processes; their output does not change.
+ * `calls` counts the times the macro really ran. */
+
+static const char *source =
+    "@(pure fn gen(n) {\n"
+    "  calls = (calls or 0) + 1\n"
+    "  if type(n) == 'table' then n = n.n end\n"
+    "  return string.rep('x ', n) .. n\n"
+    "})\n"
+    "@gen(2) @gen(2) @gen(3) @gen({n = 1}) @(return calls)";
+
+static const char *impure_args =
+    "@(function echo(a) calls = (calls or 0) + 1; return a end)\n"
+    "@(quix.pure('echo')) @(y = 'v') @echo(y) @echo(y) @(return calls)";
+
+/* Whether every token is on the line of the first, as a replayed expansion
+ * takes the location of its call */
+static bool on_one_line(const char *src) {
+  bool same = true, first = true;
+  qlex_size line = 0;
+
+  preprocess_each(src, [&](qlex_t *lexer, qlex_tok_t tok) {
+    qlex_size at = qlex_line(lexer, tok.start);
+    if (first) {
+      line = at;
+      first = false;
+    }
+    same &= at == line;
+  });
+
+  return same;
+}
+
+static bool expect(const char *what, const char *src, const std::string &expected) {
+  std::string actual = preprocess(src);
+
+  if (actual != expected) {
+    std::cerr << what << ": expected '" << expected << "', got '" << actual << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  bool ok = true;
+
+  const std::string tokens = "x x 2 x x 2 x x x 3 x 1 ";
+
+  ok &= expect("first file", source, tokens + "3 ");
+  ok &= expect("second file", source, tokens);
+
+  qprep_clear_memo_cache();
+  ok &= expect("after clearing", source, tokens + "3 ");
+
+  qcore_cache_bind(cache_has, cache_read, cache_write);
+  qprep_clear_memo_cache();
+  ok &= expect("storing", source, tokens + "3 ");
+
+  qprep_clear_memo_cache();
+  ok &= expect("from the provider", source, tokens);
+  qcore_cache_unbind();
+
+  if (g_cache.size() != 3) {
+    std::cerr << "expected 3 stored expansions, got " << g_cache.size() << std::endl;
+    ok = false;
+  }
+
+  /* A stored token of no known type makes the image unusable; the macro runs again */
+  for (auto &[name, image] : g_cache) {
+    qlex_tok_t tok;
+    memcpy(&tok, image.data() + 16, QLEX_TOK_SIZE); /* Past the 16-byte header */
+    tok.ty = (qlex_ty_t)0;
+    memcpy(image.data() + 16, &tok, QLEX_TOK_SIZE);
+  }
+  qcore_cache_bind(cache_has, cache_read, cache_write);
+  qprep_clear_memo_cache();
+  ok &= expect("corrupt stored tokens", source, tokens + "3 ");
+  qcore_cache_unbind();
+
+  ok &= expect("arguments naming globals", impure_args, "v v 2 ");
+
+  const char *far_call = "@(pure fn gen(n) { return string.rep('x ', n) .. n })\n\n\nhere @gen(4)";
+  qcore_cache_bind(cache_has, cache_read, cache_write);
+  on_one_line(far_call);
+  qprep_clear_memo_cache();
+  if (!on_one_line(far_call)) {
+    std::cerr << "replayed tokens are not at their call" << std::endl;
+    ok = false;
+  }
+  qcore_cache_unbind();
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
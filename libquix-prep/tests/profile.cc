@@ -0,0 +1,106 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+#include <quix-prep/Preprocess.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+
+/* The profile counts every expansion and the tokens each one produced, and
+ * records nothing unless it was asked for. */
+
+static const char *source =
+    "@(function pair(x) return x .. ' ' .. x end)\n"
+    "@define N = 123;\n"
+    "@pair('a') @pair('b') @pair('c') N N end";
+
+static const qprep_profile_entry_t *find(const qprep_profile_entry_t *entries, size_t count,
+                                         const char *kind, const char *name) {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(entries[i].kind, kind) == 0 && strcmp(entries[i].name, name) == 0) {
+      return &entries[i];
+    }
+  }
+
+  return nullptr;
+}
+
+static bool expect(const qprep_profile_entry_t *e, const char *what, uint64_t calls,
+                   uint64_t tokens) {
+  if (e == nullptr) {
+    std::cerr << what << ": not in the profile" << std::endl;
+    return false;
+  }
+
+  if (e->calls != calls || e->tokens != tokens) {
+    std::cerr << what << ": expected " << calls << " calls and " << tokens << " tokens, got "
+              << e->calls << " and " << e->tokens << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static bool run(bool profiling) {
+  FILE *file = fmemopen((void *)source, strlen(source), "r");
+  bool ok = true;
+
+  {
+    qcore_env env;
+    qprep lexer(file, nullptr, env.get());
+    qprep_set_profiling(lexer.get(), profiling);
+
+    size_t count = 0;
+    while (qlex_next(lexer.get()).ty != qEofF) {
+      count++;
+    }
+
+    if (count != 9) {
+      std::cerr << "expected 9 tokens, got " << count << std::endl;
+      ok = false;
+    }
+
+    const qprep_profile_entry_t *entries;
+    size_t n = qprep_get_profile(lexer.get(), &entries);
+
+    if (!profiling) {
+      if (n != 0) {
+        std::cerr << "profiled " << n << " entries while off" << std::endl;
+        ok = false;
+      }
+    } else {
+      ok &= expect(find(entries, n, "call", "pair"), "pair", 3, 6);
+      ok &= expect(find(entries, n, "define", "N"), "N", 2, 2);
+
+      for (size_t i = 1; i < n; i++) {
+        if (entries[i - 1].lua_ns + entries[i - 1].lex_ns <
+            entries[i].lua_ns + entries[i].lex_ns) {
+          std::cerr << "entries are not ordered by time" << std::endl;
+          ok = false;
+          break;
+        }
+      }
+    }
+  }
+
+  fclose(file);
+
+  return ok;
+}
+
+int main() {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  bool ok = run(false) && run(true);
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
+
+#include "PrepFixtures.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <quix-core/Classes.hh>
+#include <quix-prep/Classes.hh>
+#include <string>
+#include <vector>
+
+/* Preprocesses many tiny files one after another, the way a build does, to
+ * show what it costs to start a preprocessor rather than to run one. */
+
+using timepoint_t = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+static std::string tiny_source(size_t i) {
+  switch (i % 4) {
+    case 0:
+      return "fn f" + std::to_string(i) + "() -> i32 { ret " + std::to_string(i) + "; }\n";
+    case 1:
+      return "@define N = " + std::to_string(i) + ";\nlet x" + std::to_string(i) + " = N + 1;\n";
+    case 2:
+      return "let y = @(return tostring(" + std::to_string(i % 7) + " * 6));\n";
+    default:
+      return "/* nothing but a comment */\n";
+  }
+}
+
+static size_t preprocess(const std::string &src) {
+  size_t tok_count = 0;
+  preprocess_each(src, [&](qlex_t *, qlex_tok_t) { ++tok_count; });
+
+  return tok_count;
+}
+
+int main(int argc, char **argv) {
+  qlex_lib_init();
+  qprep_lib_init();
+
+  size_t count = argc > 1 ? std::max(1, atoi(argv[1])) : 10000;
+
+  std::vector<std::string> sources;
+  for (size_t i = 0; i < count; i++) {
+    sources.push_back(tiny_source(i));
+  }
+
+  size_t tok_count = 0;
+  std::vector<double> times;
+  times.reserve(count);
+
+  for (const auto &src : sources) {
+    timepoint_t start = std::chrono::high_resolution_clock::now();
+    tok_count += preprocess(src);
+    timepoint_t end = std::chrono::high_resolution_clock::now();
+
+    times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  double total = 0;
+  for (double t : times) {
+    total += t;
+  }
+
+  double first = times.front();
+  std::sort(times.begin(), times.end());
+
+  std::cout << "Files: " << count << std::endl;
+  std::cout << "Tokens: " << tok_count << std::endl;
+  std::cout << "Total time: " << total / 1000 << " ms" << std::endl;
+  std::cout << "First file: " << first << " us" << std::endl;
+  std::cout << "Per file (mean): " << total / count << " us" << std::endl;
+  std::cout << "Per file (median): " << times[count / 2] << " us" << std::endl;
+  std::cout << "Per file (p99): " << times[std::min(count - 1, count * 99 / 100)] << " us"
+            << std::endl;
+
+  qprep_lib_deinit();
+  qlex_lib_deinit();
+
+  return 0;
+}
@@ -44,8 +44,10 @@
 static bool impl_use_json(qlex_t *L, FILE *O) {
   fputc('[', O);
 
+  TokenReader reader(L);
+
   qlex_tok_t tok;
-  while ((tok = qlex_next(L)).ty != qEofF) {
+  while ((tok = reader.next()).ty != qEofF) {
     qlex_size sl = qlex_line(L, tok.start);
     qlex_size sc = qlex_col(L, tok.start);
     qlex_size el = qlex_line(L, tok.end);
@@ -189,8 +191,10 @@ static bool impl_use_msgpack(qlex_t *L, FILE *O) {
   err |= fputc(0, O);
   err |= fputc(0, O);
 
+  TokenReader reader(L);
+
   qlex_tok_t tok;
-  while ((tok = qlex_next(L)).ty != qEofF) {
+  while ((tok = reader.next()).ty != qEofF) {
     qlex_size sl = qlex_line(L, tok.start);
     qlex_size sc = qlex_col(L, tok.start);
     qlex_size el = qlex_line(L, tok.end);
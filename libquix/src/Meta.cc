@@ -31,21 +31,31 @@
 
 #define LIBQUIX_INTERNAL
 
+#include <quix-core/Cache.h>
 #include <quix-core/Lib.h>
+#include <quix-lexer/Lib.h>
+#include <quix-prep/Lib.h>
 #include <quix/code.h>
 
 #include <SerialUtil.hh>
+#include <cinttypes>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <quix-prep/Classes.hh>
+#include <string>
 #include <string_view>
 #include <unordered_set>
 
 static bool impl_use_json(qlex_t *L, FILE *O) {
   fputc('[', O);
 
+  TokenReader reader(L);
+
   qlex_tok_t tok;
-  while ((tok = qlex_next(L)).ty != qEofF) {
+  while ((tok = reader.next()).ty != qEofF) {
     qlex_size sl = qlex_line(L, tok.start);
     qlex_size sc = qlex_col(L, tok.start);
     qlex_size el = qlex_line(L, tok.end);
@@ -189,8 +199,10 @@ static bool impl_use_msgpack(qlex_t *L, FILE *O) {
   err |= fputc(0, O);
   err |= fputc(0, O);
 
+  TokenReader reader(L);
+
   qlex_tok_t tok;
-  while ((tok = qlex_next(L)).ty != qEofF) {
+  while ((tok = reader.next()).ty != qEofF) {
     qlex_size sl = qlex_line(L, tok.start);
     qlex_size sc = qlex_col(L, tok.start);
     qlex_size el = qlex_line(L, tok.end);
@@ -328,16 +340,92 @@ static bool impl_use_msgpack(qlex_t *L, FILE *O) {
   return err != EOF;
 }
 
+/* The key covers the source and the library versions, so that an upgraded
+ * preprocessor never replays tokens produced by an older one. Defines,
+ * imports and anything else a macro reads are not part of it, which is why
+ * caching is only done on request with -fprep-cache=on. */
+static bool impl_cache_key(std::string_view source, qcore_cache_key_t *key) {
+  return qcore_cache_key_digest(
+      {"quix-prep-tokens", qlex_lib_version(), qprep_lib_version(), source}, key);
+}
+
+/* Open the preprocessed token stream of `source` through the bound cache
+ * provider. On a miss the source is preprocessed and the result stored. Both
+ * ways the tokens are replayed from an image, so the output does not depend
+ * on whether the cache was hit. Returns NULL, with `source` rewound, if no
+ * provider is bound or the cache could not be used.
+ *
+ * The caller vouches that the output depends on the source alone: a hit is
+ * replayed even if a define or an imported module has changed since. */
+static qlex_t *impl_open_cached(FILE *source, qcore_env_t env) {
+  long start;
+  if (!qcore_cache_bound() || (start = ftell(source)) < 0) {
+    return nullptr;
+  }
+
+  std::string buffer;
+  char chunk[16384];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), source)) > 0) {
+    buffer.append(chunk, n);
+  }
+
+  qcore_cache_key_t key;
+  if (ferror(source) || !impl_cache_key(buffer, &key)) {
+    fseek(source, start, SEEK_SET);
+    return nullptr;
+  }
+
+  qlex_t *L = qlex_cache_load(&key, nullptr, env);
+
+  if (!L && fseek(source, start, SEEK_SET) == 0) {
+    qprep lexer(source, nullptr, env);
+
+    size_t size;
+    if (void *image = qlex_cache_dump(lexer.get(), key.key, &size)) {
+      qcore_cache_write(&key, image, size);
+
+      if (!(L = qlex_new_replay(image, size, true, key.key, nullptr, env))) {
+        free(image);
+      }
+    }
+  }
+
+  if (!L) {
+    fseek(source, start, SEEK_SET);
+  }
+
+  return L;
+}
+
+static void impl_write_profile(qlex_t *L, FILE *O) {
+  const qprep_profile_entry_t *entries;
+  size_t count = qprep_get_profile(L, &entries);
+
+  fputc('[', O);
+
+  for (size_t i = 0; i < count; i++) {
+    const qprep_profile_entry_t &e = entries[i];
+
+    fprintf(O,
+            "%s{\"name\":%s,\"kind\":\"%s\",\"calls\":%" PRIu64 ",\"lua_ns\":%" PRIu64
+            ",\"lex_ns\":%" PRIu64 ",\"tokens\":%" PRIu64 "}",
+            i ? "," : "", create_json_string(e.name).c_str(), e.kind, e.calls, e.lua_ns, e.lex_ns,
+            e.tokens);
+  }
+
+  fputc(']', O);
+}
+
 bool impl_subsys_meta(FILE *source, FILE *output, std::function<void(const char *)> diag_cb,
                       const std::unordered_set<std::string_view> &opts) {
   (void)diag_cb;
 
-  qprep lexer(source, nullptr, qcore_env_current());
-
   enum class OutMode {
     JSON,
     MsgPack,
   } out_mode = OutMode::JSON;
+  qcore_env_t env = qcore_env_current();
 
   if (opts.contains("-fuse-json") && opts.contains("-fuse-msgpack")) {
     qcore_print(QCORE_ERROR, "Cannot use both JSON and MsgPack output.");
@@ -346,10 +434,46 @@ bool impl_subsys_meta(FILE *source, FILE *output, std::function<void(const char
     out_mode = OutMode::MsgPack;
   }
 
+  /* The profile is written with the tokens as {"tokens": [...], "profile": [...]} */
+  bool profile = opts.contains("-fprep-profile=on");
+  if (profile && out_mode != OutMode::JSON) {
+    qcore_print(QCORE_ERROR, "The macro profile is only available as JSON.");
+    return false;
+  }
+
+  /* Replayed tokens would leave nothing to profile */
+  bool use_cache = opts.contains("-fprep-cache=on");
+  if (use_cache && profile) {
+    qcore_print(QCORE_ERROR, "Cannot use the token cache while profiling macros.");
+    return false;
+  }
+
+  std::unique_ptr<qlex_t, decltype(&qlex_free)> cached(
+      use_cache ? impl_open_cached(source, env) : nullptr, qlex_free);
+  std::optional<qprep> lexer;
+  qlex_t *L;
+
+  if (cached) {
+    L = cached.get();
+  } else {
+    L = lexer.emplace(source, nullptr, env).get();
+    qprep_set_profiling(L, profile);
+  }
+
+  if (profile) {
+    fputs("{\"tokens\":", output);
+    bool ok = impl_use_json(L, output);
+    fputs(",\"profile\":", output);
+    impl_write_profile(L, output);
+    fputc('}', output);
+
+    return ok;
+  }
+
   switch (out_mode) {
     case OutMode::JSON:
-      return impl_use_json(lexer.get(), output);
+      return impl_use_json(L, output);
     case OutMode::MsgPack:
-      return impl_use_msgpack(lexer.get(), output);
+      return impl_use_msgpack(L, output);
   }
 }
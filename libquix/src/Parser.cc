@@ -290,6 +290,14 @@ bool impl_subsys_parser(FILE *source, FILE *output, std::function<void(const cha
     }
   }
 
+  { /* Should the parser split large files between threads? */
+    if (opts.contains("-fparse-parallel=on")) {
+      qparse_conf_setopt(conf.get(), QPK_PARALLEL, QPV_ON);
+    } else if (opts.contains("-fparse-parallel=off")) {
+      qparse_conf_setopt(conf.get(), QPK_PARALLEL, QPV_OFF);
+    }
+  }
+
   { /* Should we implement the default construct attributes? */
     if (opts.contains("-fparse-autoimpl-func=off")) {
       qparse_conf_setopt(conf.get(), QPK_NO_AUTO_IMPL, QPV_FUNCTION);
@@ -29,6 +29,9 @@
 ///                                                                          ///
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <quix-lexer/Lexer.h>
+
+#include <array>
 #include <cstdint>
 #include <cstdio>
 #include <string>
@@ -39,4 +42,23 @@ bool read_json_string(FILE *I, char **str, size_t &len);
 bool msgpack_write_uint(FILE *O, uint64_t x);
 bool msgpack_read_uint(FILE *I, uint64_t &x);
 bool msgpack_write_str(FILE *O, std::string_view str);
-bool msgpack_read_str(FILE *I, char **str, size_t &len);
\ No newline at end of file
+bool msgpack_read_str(FILE *I, char **str, size_t &len);
+
+/* Pulls tokens from a lexer in chunks instead of one call per token */
+class TokenReader {
+  qlex_t *m_lexer;
+  std::array<qlex_tok_t, 512> m_buf;
+  size_t m_pos = 0, m_len = 0;
+
+public:
+  TokenReader(qlex_t *lexer) : m_lexer(lexer) {}
+
+  qlex_tok_t next() {
+    if (m_pos == m_len) {
+      m_len = qlex_next_batch(m_lexer, m_buf.data(), m_buf.size());
+      m_pos = 0;
+    }
+
+    return m_buf[m_pos++];
+  }
+};
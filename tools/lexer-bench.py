@@ -0,0 +1,144 @@
+# Lexer throughput benchmark with regression baselines.
+#
+# Generates one corpus per token mix with quix-gen.py, runs the lexer `bench`
+# program over them and compares the results against a checked-in baseline.
+# Timings are machine dependent: refresh the baseline with --update-baseline
+# on the machine the numbers are compared on.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+MIXES = ['mixed', 'ident', 'comment', 'string', 'numeric', 'macro']
+
+# Metric and the absolute slack allowed instead of the relative tolerance.
+# Lower is better for all of them. Allocation counts are deterministic, so any
+# growth beyond rounding noise counts, however small.
+METRICS = [
+    ('ns_per_token', None),
+    ('peak_rss_kb', None),
+    ('allocs_per_token', 0.001),
+]
+
+
+def read_stamp(path: str) -> str:
+    try:
+        with open(path) as f:
+            return f.read()
+    except OSError:
+        return ''
+
+
+def generate(workdir: str, size: int) -> list:
+    gen = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'quix-gen.py')
+    os.makedirs(workdir, exist_ok=True)
+
+    files = []
+    for mix in MIXES:
+        path = os.path.join(workdir, f'{mix}.q')
+        stamp = path + '.size'
+
+        if not os.path.exists(path) or read_stamp(stamp) != str(size):
+            subprocess.run([sys.executable, gen, '--mix', mix, '--size', str(size), '-o', path],
+                           check=True, stdout=subprocess.DEVNULL)
+            with open(stamp, 'w') as f:
+                f.write(str(size))
+
+        files.append(path)
+
+    return files
+
+
+def compare(baseline: dict, current: dict, tolerance: float) -> bool:
+    base = {r['file']: r for r in baseline['results']}
+    ok = True
+
+
+    print(f'{"file":<12}{"metric":<20}{"baseline":>14}{"current":>14}{"change":>10}')
+
+    for r in current['results']:
+        b = base.get(r['file'])
+        if b is None:
+            print(f'{r["file"]:<12}(not in baseline)')
+            continue
+
+        for metric, slack in METRICS:
+            old, new = b[metric], r[metric]
+
+            change = (new - old) / old if old else 0.0
+            limit = old * (1 + tolerance) if slack is None else old + slack
+
+            verdict = ''
+            if new > limit:
+                verdict = '  REGRESSED'
+                ok = False
+            elif slack is None and new < old * (1 - tolerance):
+                verdict = '  improved'
+
+            print(f'{r["file"]:<12}{metric:<20}{old:>14.3f}{new:>14.3f}{change:>+10.1%}{verdict}')
+
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark the lexer against a baseline.')
+    parser.add_argument('--bench', required=True, help='path to the lexer bench program')
+    parser.add_argument('--baseline', help='baseline JSON to compare against')
+    parser.add_argument('--update-baseline', action='store_true',
+                        help='write the results to the baseline instead of comparing')
+    parser.add_argument('--tolerance', type=float, default=0.15,
+                        help='allowed relative slowdown before failing (default: 0.15)')
+    parser.add_argument('--size', type=int, default=2 * 10**6,
+                        help='approximate size of each corpus in bytes')
+    parser.add_argument('--iterations', type=int, default=10)
+    parser.add_argument('--mapped', action='store_true', help='lex memory-mapped files')
+    parser.add_argument('--workdir', default='lexer-bench', help='where corpora are generated')
+    parser.add_argument('--output', help='also write the results to this file')
+    args = parser.parse_args()
+
+    files = generate(args.workdir, args.size)
+
+    cmd = [args.bench, '--json', '--iterations', str(args.iterations)] + files
+    if args.mapped:
+        cmd.append('--mapped')
+
+    out = subprocess.run(cmd, check=True, stdout=subprocess.PIPE, text=True).stdout
+    current = json.loads(out)
+    current['corpus_size'] = args.size
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(current, f, indent=2)
+            f.write('\n')
+
+    if args.update_baseline:
+        if not args.baseline:
+            parser.error('--update-baseline requires --baseline')
+
+        with open(args.baseline, 'w') as f:
+            json.dump(current, f, indent=2)
+            f.write('\n')
+
+        print(f'Baseline written to {args.baseline}')
+        return 0
+
+    if not args.baseline:
+        print(out)
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    if baseline.get('corpus_size') != args.size or baseline.get('mode') != current['mode']:
+        print('warning: baseline was recorded with a different corpus size or mode')
+
+    ok = compare(baseline, current, args.tolerance)
+    print('PASS' if ok else 'FAIL: lexer performance regressed beyond tolerance')
+
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,14 +1,13 @@
 # A script to generate a random Quix program for benchmarking purposes.
 # It should be somewhat representative Quix program syntax (not just a bunch of declarations).
 
+import argparse
 import random
 import math
 
 target_fsize = 10**7
 step = 4
 
-random.seed(0)
-
 
 def rname(l: int) -> str:
     return ''.join(random.choices('abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ', k=l))
@@ -91,20 +90,147 @@ def rsubsystem(ind: int) -> str:
     return s + '}'
 
 
-with open('quixcc-benchmark.q', 'w') as f:
-    f.write('''# And he said, "Let there be performance!"\n\n''')
+def rexpr() -> str:
+    ops = ['+', '-', '*', '/', '%', '&', '|', '^', '<<', '>>', '==', '!=', '<', '>']
+    s = rident()
+    for _ in range(random.randint(1, 6)):
+        s += f' {random.choice(ops)} {rident()}'
+    return s
+
+
+def rident_line(ind: int) -> str:
+    x = random.randint(0, 2)
+
+    if x == 0:
+        return f'{" " * ind}let {rident()}: {rtype()} = {rexpr()};'
+    elif x == 1:
+        return f'{" " * ind}{rident()}::{rident()}.{rident()}({rident()}, {rident()});'
+    else:
+        return f'{" " * ind}{rident()} = {rexpr()};'
+
+
+def rcomment_line(ind: int) -> str:
+    words = ' '.join(rname(random.randint(2, 9)) for _ in range(random.randint(4, 16)))
+    x = random.randint(0, 3)
+
+    if x == 0:
+        return f'{" " * ind}/* {words}\n{" " * ind} * {words} */'
+    elif x == 1:
+        return f'{" " * ind}// {words}'
+    elif x == 2:
+        return f'{" " * ind}# {words}'
+    else:
+        return f'{" " * ind}~> {words}'
+
+
+def rstring() -> str:
+    escapes = ['\\n', '\\t', '\\"', '\\\\', '\\x41', '\\101', '\\0']
+    s = ''
+    for _ in range(random.randint(1, 8)):
+        s += rname(random.randint(1, 12)) + ' '
+        if random.randint(0, 2) == 0:
+            s += random.choice(escapes)
+    return f'"{s}"'
+
+
+def rstring_line(ind: int) -> str:
+    x = random.randint(0, 2)
+
+    if x == 0:
+        return f'{" " * ind}let {rident()} = {rstring()};'
+    elif x == 1:
+        return f'{" " * ind}{rident()}({rstring()}, {rstring()}, \'{rname(1)}\');'
+    else:
+        return f'{" " * ind}{rstring()} {rstring()} \'\\n\' \'{rname(1)}\''
+
+
+def rnumber() -> str:
+    x = random.randint(0, 6)
+
+    if x == 0:
+        return str(random.randint(0, 10**random.randint(1, 19)))
+    elif x == 1:
+        return hex(random.getrandbits(random.randint(4, 64)))
+    elif x == 2:
+        return bin(random.getrandbits(random.randint(2, 32)))
+    elif x == 3:
+        return oct(random.getrandbits(random.randint(3, 48)))
+    elif x == 4:
+        return f'{random.randint(0, 10**6)}.{random.randint(0, 10**6)}'
+    elif x == 5:
+        return f'{random.randint(1, 9)}.{random.randint(0, 999)}e{random.randint(-30, 30)}'
+    else:
+        return '_'.join(str(random.randint(100, 999)) for _ in range(random.randint(2, 5)))
+
+
+def rnumeric_line(ind: int) -> str:
+    nums = ', '.join(rnumber() for _ in range(random.randint(4, 12)))
+    return f'{" " * ind}let {rident()}: [{rtype()}; {random.randint(1, 64)}] = [{nums}];'
+
+
+def rmacro_line(ind: int) -> str:
+    x = random.randint(0, 2)
+
+    if x == 0:
+        return f'{" " * ind}@{rname(6)}({rident()}, {random.randint(0, 999)})'
+    elif x == 1:
+        return f'{" " * ind}@{rname(8)} {rident()} {rident()}'
+    else:
+        body = ''.join(f'{" " * (ind + step)}local {rname(4)} = {random.randint(0, 99)} -- {rname(8)}\n'
+                       for _ in range(random.randint(1, 6)))
+        return f'{" " * ind}@(\n{body}{" " * ind})'
+
+
+def rfocused(line) -> str:
+    s = f'fn {rident()}(): {rtype()} {{\n'
+    for _ in range(random.randint(10, 30)):
+        s += line(step) + '\n'
+    return s + '}'
+
+
+MIXES = {
+    'ident': rident_line,
+    'comment': rcomment_line,
+    'string': rstring_line,
+    'numeric': rnumeric_line,
+    'macro': rmacro_line,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a random Quix program.')
+    parser.add_argument('--mix', choices=['mixed'] + list(MIXES), default='mixed',
+                        help='kind of tokens that dominate the program')
+    parser.add_argument('--size', type=int, default=target_fsize,
+                        help='approximate size of the program in bytes')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('-o', '--output', default='quixcc-benchmark.q')
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+
+    with open(args.output, 'w') as f:
+        f.write('''# And he said, "Let there be performance!"\n\n''')
+
+        ctr = 0
+
+        bytes_written = 0
 
-    ctr = 0
+        while bytes_written < args.size:
+            if args.mix == 'mixed':
+                s = rsubsystem(0)
+            else:
+                s = rfocused(MIXES[args.mix])
 
-    bytes_written = 0
+            f.write(s + '\n\n')
 
-    while bytes_written < target_fsize:
-        s = rsubsystem(0)
+            bytes_written += len(s)
 
-        f.write(s + '\n\n')
+            ctr += 1
 
-        bytes_written += len(s)
+        print(f'Generated {ctr} {"subsystems" if args.mix == "mixed" else "functions"}, '
+              f'{bytes_written} bytes written.')
 
-        ctr += 1
 
-    print(f'Generated {ctr} subsystems, {bytes_written} bytes written.')
+if __name__ == '__main__':
+    main()